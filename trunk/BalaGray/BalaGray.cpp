@@ -12,157 +12,72 @@
 		02		12dec24	add wrap prediction; improve error handling
 		03		04aug25	add standard deviation
 		04		22aug25	improve portability
+		05		18oct26	make reentrant; add optional logging and incumbent callback
+		06		18oct26	add prefix crawl, frontier enumeration and incumbent seeding
+		07		18oct26	widen numeral to 128-bit vector; add SSE2 kernels
+		08		18oct26	compute span metrics incrementally, as integers
+		09		18oct26	add Pareto front mode
+		10		18oct26	move objectives to template policies
+		11		18oct26	add numeral limit constant
+		12		18oct26	add permutation scoring
+		13		18oct26	add meet-in-the-middle crawl
+		14		18oct26	add balance lookahead
+		15		18oct26	add successor order seed and shared bound
+		16		18oct26	add limited discrepancy search
+		17		18oct26	add beam search
+		18		18oct26	write winners to any stream
+		19		18oct26	add crawl state sampler; move hot kernels inline
+		20		18oct26	add restricted adjacency modes
+		21		18oct26	add lower bound oracle and early termination
+		22		18oct26	add certify mode; proven excludes heuristic cuts
+		23		18oct26	add sliding window balance
+		24		18oct26	add node limit
+		25		18oct26	factor out wrap prediction mask
 
 */
 
-// BalaGray.cpp : Defines the entry point for the console application.
-// This app computes balanced Gray code sequences, for use in music theory.
+// BalaGray.cpp : balanced Gray code crawler engine.
+// This engine computes balanced Gray code sequences, for use in music theory.
 
 #include "stdafx.h"	// precompiled header
-#include <stdint.h>	// standard sizes
-#include <vector>	// growable array
-#include <fstream>	// file I/O
+#include "BalaGray.h"
 #include <assert.h>	// debugging
-#include "WorkerSync.h"	// synchronized worker thread
 #include <iomanip>
-#include <climits>
 #include <cfloat>
 #include <math.h>
+#include <algorithm>
+#include <sstream>
 
-#define MORE_PLACES 1	// set non-zero to use more than four places
-#define DO_PRUNING 1	// set non-zero to do branch pruning and reduce runtime
-#define START_2_DOWN 1	// set non-zero to skip first two levels of crawl
-#define SHOW_STATS 0	// set non-zero to compute and show crawl statistics
-#define PREDICT_WRAP 1	// set non-zero to predict and abandon branches that won't wrap around Gray
-#define OPT_STD_DEV 1	// set non-zero to optimize standard deviation: 1 == standard deviation is
-						// max span tie-breaker; 2 == standard deviation only, ignoring max span
-
-class CBalaGray {
-public:
-// Construction
-	CBalaGray(const char *pszOutPath = NULL);
-
-// Constants
-	enum {
-#if MORE_PLACES
-		MAX_PLACES = 8,
-#else
-		MAX_PLACES = 4,
-#endif
-	};
-
-// Types
-	typedef uint8_t PLACE;	// 8 bits is enough for atonal music theory as bases don't exceed twelve
-	typedef uint32_t SET_CODE;	// specifies a mixed-radix numeral's bases, using one nibble per place
-	union NUMERAL {	// mixed-radix numeral with a variable number of places up to MAX_PLACES
-		PLACE	b[MAX_PLACES];	// array of places; their bases are assumed to be known
-#if MORE_PLACES
-		uint64_t	dw;	// double word containing all places
-#else
-		uint32_t	dw;	// double word containing all places
-#endif
-	};
-	typedef std::vector<NUMERAL> CNumeralArray;
-	class CWinner {	// info about winning permutation
-	public:
-		CWinner();
-		SET_CODE	m_nSetCode;	// set identifier in hexadecimal; specifies base of each place
-		int		m_nPlaces;		// how many places numeral has
-		int		m_nBaseSum;		// sum of numeral's bases
-		int		m_nImbalance;	// difference between minimum and maximum transition counts
-		int		m_nMaxTrans;	// maximum transition count
-		int		m_nMaxSpan;		// maximum span length
-#if OPT_STD_DEV
-		double	m_fStdDev;		// standard deviation of span lengths compared to ideal mean
-#endif
-		bool	m_bIsProven;	// true if all permutations were tried
-		CNumeralArray	m_arrNum;	// array of mixed-radix numerals
-		friend std::ofstream& operator<<(std::ofstream& ofs, const CWinner& winner);
-		friend std::ifstream& operator>>(std::ifstream& ifs, CWinner& winner);
-	};
-	class CWinnerArray : public std::vector<CWinner> {	// array of winners
-	public:
-		void	Read(const char *pszPath);
-		void	Write(const char *pszPath) const;
-		friend std::ofstream& operator<<(std::ofstream& ofs, const CWinnerArray& arrWin);
-		friend std::ifstream& operator>>(std::ifstream& ifs, CWinnerArray& arrWin);
-	};
-
-// Attributes
-	int		GetNumeralCount() const { return static_cast<int>(m_arrNum.size()); }
-	void	SetPruneMaxTrans(int nThreshold) { m_nPruneMaxTrans = nThreshold; }
-	void	SetPruneImbalance(int nThreshold) { m_nPruneImbalance = nThreshold; }
-	static	int		GetBases(SET_CODE nSetCode, NUMERAL& arrBase);
-	bool	IsCanceled() const { return m_bCancel; }
-
-// Operations
-	void	Reset();
-	int		Pack(const NUMERAL& num) const;
-	NUMERAL	Unpack(int iNumeral) const;
-	bool	Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner);
-	bool	CalcFromCode(SET_CODE SetCode, CWinner& seqWinner);
-	void	Cancel() { m_bCancel = true; }
-
-protected:
-// Constants
-	enum {
-		ULONGLONG_BITS = sizeof(uint64_t) * CHAR_BIT,	// number of bits in a long long word
-	};
-	enum {	// pruning thresholds may require manual tuning; see notes in set list
-		PRUNE_MAXTRANS = INT_MAX,	// prune branch if maximum transition count exceeds this value
-		PRUNE_IMBALANCE = 3,	// prune branch if imbalance exceeds this value
-	};
-
-// Types
-	struct STATE {	// crawler stack element
-		PLACE	iNum;		// index into numeral array
-		PLACE	iGray;		// index into Gray successor array
-		NUMERAL	nTrans;		// transition counts, one per place
-	};
-	typedef std::vector<PLACE> CPlaceArray;	// array of places
-	typedef std::vector<STATE> CStateArray;	// array of states
-
-// Member data
-	int		m_nPlaces;	// number of places
-	int		m_nGraySuccessors;	// number of Gray successors a numeral can have
-	int		m_nGrayStrideShift;	// stride of Gray successors array, as a per-row shift in bits
-	int		m_nPruneMaxTrans;	// prune branch if its maximum transition count exceeds this threshold
-	int		m_nPruneImbalance;	// prune branch if its imbalance exceeds this threshold
-	CPlaceArray	m_arrBase;	// array of bases, one for each place of numeral
-	CNumeralArray	m_arrNum;	// array of numerals
-	CPlaceArray	m_arrGraySuccessor;	// 2D table of Gray successors for each numeral
-	CStateArray	m_arrState;	// array of states; crawler stack
-	std::ofstream	m_fOut;	// output file
-	volatile bool	m_bCancel;	// cancel flag
-
-// Helpers
-	bool	MakeNumerals(int nPlaces, const PLACE *parrBase);
-	void	MakeGraySuccessorTable();
-	void	DumpGraySuccessorTable() const;
-	void	DumpNumeral(const NUMERAL& num) const;
-	void	DumpNumerals() const;
-	void	DumpSet() const;
-	void	DumpPermutation() const;
-	void	WriteBalanceToLog(int nImbalance, int nMaxTrans, int nMaxSpan);
-	void	WriteBalanceToLog(int nImbalance, int nMaxTrans, int nMaxSpan, double fStdDev);
-	void	WritePermutationToLog();
-	bool	IsGray(NUMERAL num1, NUMERAL num2) const;
-	int		ComputeBalance(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const;
-	int		ComputeMaxSpan(int iDepth) const;
-	double	ComputeStdDev() const;
-	int		CalcDeviance(int nSamp) const;
-};
-
-CBalaGray::CBalaGray(const char *pszOutPath)
-{
-	if (pszOutPath == NULL)
-		pszOutPath = "BalaGrayIter.txt";
-	m_fOut.open(pszOutPath, std::ios_base::out);	// open output file
-	m_fOut << std::unitbuf; // enable automatic flushing
-	assert(m_fOut.good());
-	if (!m_fOut.good()) {
-		printf("can't open output file '%s'\n", pszOutPath);
-	}
+// Winner files start with a format version. Older files started with the
+// size of CWinner instead, which was 64 bytes in 64-bit builds; their winners
+// are formatted the same, so that header is also accepted.
+#define WINNER_FILE_VERSION 1	// first token of winner file
+#define WINNER_LEGACY_SIZE 64	// legacy header of 64-bit builds
+
+CBalaGray::CBalaGray()
+{
+	m_pLog = NULL;	// logging is disabled until caller specifies a sink
+	m_bVerbose = false;
+	m_bHaveIncumbent = false;
+	m_nFrontierLen = 0;
+	m_parrFrontier = NULL;
+	m_parrParetoFront = NULL;
+	m_nMeetBackLen = 0;
+	m_nSuccessorSeed = 0;
+	m_pSharedBound = NULL;
+	m_nDiscrepancyStep = 0;
+	m_nMaxDiscrepancy = INT_MAX;
+	m_bDiscrepancyCut = false;
+	m_nBeamWidth = 0;
+	m_parrStateSample = NULL;
+	m_nMaxStateSamples = 0;
+	m_nAdjacency = ADJ_ANY;
+	m_bLowerBoundMet = false;
+	m_bCertify = false;
+	m_bHeuristicCut = false;
+	m_nWindowLen = 0;
+	m_nWindowMaxTrans = INT_MAX;
+	m_nNodeLimit = 0;
 	Reset();
 	m_nPruneMaxTrans = PRUNE_MAXTRANS;
 	m_nPruneImbalance = PRUNE_IMBALANCE;
@@ -170,10 +85,39 @@ CBalaGray::CBalaGray(const char *pszOutPath)
 
 void CBalaGray::Reset()
 {
+	ResetCrawl();
+	m_bCancel = false;
+}
+
+void CBalaGray::ResetCrawl()
+{
+	// unlike Reset, preserves cancel flag, so that a cancel
+	// requested before Calc starts isn't silently discarded
 	m_nPlaces = 0;
 	m_arrBase.clear();
 	m_arrState.clear();
-	m_bCancel = false;
+	m_nNodes = 0;
+	m_lbound.nImbalance = INT_MAX;	// no bound until set is known
+	m_lbound.nMaxTrans = INT_MAX;
+	m_lbound.nMaxSpan = INT_MAX;
+	m_lbound.nDevSum = INT_MAX;
+}
+
+bool CBalaGray::OpenLog(const char *pszPath)
+{
+	assert(pszPath != NULL);
+	if (m_fLog.is_open())	// if log file already open
+		m_fLog.close();
+	m_fLog.clear();	// reset stream's error state
+	m_fLog.open(pszPath, std::ios_base::out);	// open log file
+	if (!m_fLog.good()) {
+		printf("can't open output file '%s'\n", pszPath);
+		m_pLog = NULL;	// disable logging
+		return false;
+	}
+	m_fLog << std::unitbuf; // enable automatic flushing
+	m_pLog = &m_fLog;	// log to our file
+	return true;
 }
 
 int CBalaGray::Pack(const NUMERAL& num) const
@@ -189,7 +133,7 @@ int CBalaGray::Pack(const NUMERAL& num) const
 CBalaGray::NUMERAL CBalaGray::Unpack(int iNumeral) const
 {
 	NUMERAL	num;
-	num.dw = 0;
+	num.Zero();
 	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
 		int	nBase = m_arrBase[iPlace];
 		num.b[iPlace] = static_cast<PLACE>(iNumeral % nBase);
@@ -206,7 +150,16 @@ int CBalaGray::GetBases(SET_CODE nSetCode, NUMERAL& arrBase)
 	// its leftmost digit corresponds to the numeral's least significant
 	// place. For example, set code 0x234 produces this base array:
 	// arrBase[0] = 2; arrBase[1] = 3; arrBase[2] = 4;
-	arrBase.dw = 0;
+	// A variant's set code has a variant byte from SET_VARIANT_SHIFT up: its
+	// high nibble is SET_VARIANT_MARK, which can't be a base, and its low
+	// nibble is the adjacency mode. The variant byte is skipped here; codes
+	// without it may use every nibble for bases.
+	arrBase.Zero();
+	if (static_cast<int>(nSetCode >> (SET_VARIANT_SHIFT + 4)) == SET_VARIANT_MARK >> 4) {	// if variant
+		if (GetAdjacency(nSetCode) >= ADJACENCY_MODES)	// if invalid adjacency mode
+			return 0;	// return zero to indicate error
+		nSetCode &= (1ull << SET_VARIANT_SHIFT) - 1;
+	}
 	int	nPlaces = 0;
 	while (nSetCode) {	// while set nibbles remain
 		if (nPlaces >= MAX_PLACES)	// if set has too many places
@@ -238,11 +191,15 @@ bool CBalaGray::MakeNumerals(int nPlaces, const PLACE *parrBase)
 		}
 		m_arrBase[iPlace] = parrBase[iPlace];	// store base in member var
 		nNums *= parrBase[iPlace];	// update range
+		// make array of all numerals representable with the specified bases
+		if (nNums > MAX_NUMERALS) {	// limit is maximum shift, which is 127 bits
+			printf("too many numerals\n");	// checked per place, as range can overflow
+			return false;
+		}
 	}
-	// make array of all numerals representable with the specified bases
-	if (nNums > ULONGLONG_BITS * 2 - 1) {	// limit is maximum shift, which is 127 bits
-		printf("too many numerals\n");
-		return false;
+	m_nUnusedPlaces.Zero();
+	for (int iPlace = nPlaces; iPlace < MAX_PLACES; iPlace++) {	// for each unused place
+		m_nUnusedPlaces.b[iPlace] = 0xff;
 	}
 	m_arrNum.resize(nNums);
 	for (int iNum = 0; iNum < nNums; iNum++) {	// for each numeral
@@ -263,41 +220,220 @@ inline uint32_t BitScanReverse(uint32_t nMask)
 	return 0;
 }
 
-void CBalaGray::MakeGraySuccessorTable()
+bool CBalaGray::MakeGraySuccessorTable()
 {
 	// Build 2D table of possible Gray successors from each numeral.
 	// One row for each numeral, one column for each Gray successor.
 	// Successors are stored not as numerals, but as numeral indices.
-	// Each table element is an index into the numeral array.
+	// Each table element is an index into the numeral array. If the
+	// adjacency mode restricts steps, rows may differ in length; shorter
+	// rows are padded with the row's own numeral, which is always used
+	// on any branch that reaches the row, so padding is never crawled.
 	int	nPlaces = m_nPlaces;
+	int	nNums = GetNumeralCount();
 	int	nGraySuccessors = 0;
-	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
-		nGraySuccessors += m_arrBase[iPlace] - 1;	// one less than place's base
+	for (int iNum = 0; iNum < nNums; iNum++) {	// for each numeral
+		int	nSuccs = 0;
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			int	nVal = m_arrNum[iNum].b[iPlace];
+			for (int iVal = 0; iVal < m_arrBase[iPlace]; iVal++) {	// for each of place's values
+				nSuccs += iVal != nVal && IsStep(iPlace, nVal, iVal);
+			}
+		}
+		if (nSuccs < 2) {	// if numeral can't be entered and left
+			printf("adjacency leaves a state with fewer than two neighbors\n");
+			return false;
+		}
+		nGraySuccessors = std::max(nGraySuccessors, nSuccs);
 	}
 	// Compute stride of Gray successors table; to avoid multiplication,
 	// round up stride to nearest power of two and convert it to a shift.
 	uint32_t	iFirstBitPos = BitScanReverse(nGraySuccessors - 1);
 	int	nStrideShift = 1 << iFirstBitPos;
 	m_arrGraySuccessor.resize(m_arrNum.size() << nStrideShift);
-	int	nNums = GetNumeralCount();
+	m_arrGrayPlace.resize(m_arrGraySuccessor.size());
+	uint32_t	nRandSeed = m_nSuccessorSeed;
 	for (int iNum = 0; iNum < nNums; iNum++) {	// for each numeral
 		int	iCol = 0;
 		NUMERAL	rowNum, colNum;
-		rowNum.dw = m_arrNum[iNum].dw;
+		rowNum = m_arrNum[iNum];
 		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
 			int	nVals = m_arrBase[iPlace];	// number of values is place's base
 			for (int iVal = 0; iVal < nVals; iVal++) {	// for each of place's values
-				if (iVal != rowNum.b[iPlace]) {	// if value differs from row value
-					colNum.dw = rowNum.dw;	// column numeral is same as row numeral
+				// if value differs from row value, and adjacency allows stepping to it
+				if (iVal != rowNum.b[iPlace] && IsStep(iPlace, rowNum.b[iPlace], iVal)) {
+					colNum = rowNum;	// column numeral is same as row numeral
 					colNum.b[iPlace] = static_cast<PLACE>(iVal);	// except one place differs (Gray code)
 					m_arrGraySuccessor[(iNum << nStrideShift) + iCol] = static_cast<PLACE>(Pack(colNum));
+					m_arrGrayPlace[(iNum << nStrideShift) + iCol] = static_cast<PLACE>(iPlace);
 					iCol++;	// next column
 				}
 			}
 		}
+		int	nSuccs = iCol;
+		for (; iCol < nGraySuccessors; iCol++) {	// for each unused column
+			m_arrGraySuccessor[(iNum << nStrideShift) + iCol] = static_cast<PLACE>(iNum);	// pad with self
+			m_arrGrayPlace[(iNum << nStrideShift) + iCol] = 0;
+		}
+		if (m_nSuccessorSeed) {	// if diversifying crawl order, shuffle row's columns, excluding padding
+			PLACE	*pSucc = &m_arrGraySuccessor[iNum << nStrideShift];
+			PLACE	*pPlace = &m_arrGrayPlace[iNum << nStrideShift];
+			for (int iCol = nSuccs - 1; iCol > 0; iCol--) {	// Fisher-Yates shuffle
+				nRandSeed = nRandSeed * 1664525 + 1013904223;	// linear congruential; repeatable results
+				int	iSwap = (nRandSeed >> 16) % (iCol + 1);	// low bits have short periods
+				std::swap(pSucc[iCol], pSucc[iSwap]);
+				std::swap(pPlace[iCol], pPlace[iSwap]);
+			}
+		}
 	}
 	m_nGraySuccessors = nGraySuccessors;	// save successor count in member var
 	m_nGrayStrideShift = nStrideShift;	// save table stride too
+	return true;
+}
+
+bool CBalaGray::MakeGrayWrapMask(uint64_t& nGrayWrapMask) const
+{
+	// Make bitmask of origin's successors, for predicting wraparound: once
+	// a path uses every successor of origin, it can't wrap around Gray. The
+	// mask is tested against the first of the two used numeral masks only,
+	// so every successor must fit in it.
+	nGrayWrapMask = 0;
+	for (int iOrgSucc = 0; iOrgSucc < m_nGraySuccessors; iOrgSucc++) {	// for each successor of origin
+		int	nShift = m_arrGraySuccessor[iOrgSucc];
+		if (!nShift)	// if padding; origin isn't its own successor
+			continue;
+		if (nShift >= ULONGLONG_BITS) {	// if shift too big
+			printf("wrap prediction shift too big\n");
+			return false;
+		}
+		nGrayWrapMask |= 1ull << nShift;	// set successor's corresponding bit in mask
+	}
+	return true;
+}
+
+void CBalaGray::MakeLookaheadTable()
+{
+	// Build table of lower bounds on a complete permutation's imbalance, indexed
+	// by a partial permutation's maximum transition count, including wraparound.
+	// A cycle has exactly one transition per numeral, and a place's count with
+	// wraparound can only grow, as a place that isn't zero must still return
+	// to zero; for a binary place, this also accounts for parity. So if the
+	// busiest place has at least nMax transitions, the other places share at
+	// most nNumerals - nMax, and the least of them can't exceed their mean.
+	int	nNumerals = GetNumeralCount();
+	m_arrImbalanceBound.resize(nNumerals + 1);
+	for (int nMax = 0; nMax <= nNumerals; nMax++) {	// for each possible max transition count
+		m_arrImbalanceBound[nMax] = nMax - (nNumerals - nMax) / (m_nPlaces - 1);
+	}
+}
+
+void CBalaGray::MakeLowerBound()
+{
+	// Compute lower bounds of any cycle's metrics from its places' transition
+	// counts, which sum to the numeral count. A place must visit each of its
+	// values, so its count is at least its base; the other places' values are
+	// grouped into runs, one or more per group of states that differ only in
+	// this place, which limits its count from above. If a place's adjacency
+	// graph is bipartite, e.g. if it's binary, its count must be even, as each
+	// step changes color and the cycle returns to the first color. The least
+	// window of counts that contains a feasible assignment gives the minimum
+	// imbalance, and then the minimum maximum transition count. A place with
+	// t transitions has t spans that sum to the numeral count, so its longest
+	// span is at least their mean, and its deviations are least if the spans
+	// are as equal as possible; as any feasible assignment's least count is
+	// the window's minimum, only the deviations depend on the assignment.
+	int	nNumerals = GetNumeralCount();
+	int	arrMinTrans[MAX_PLACES], arrMaxTrans[MAX_PLACES];
+	bool	arrEven[MAX_PLACES];
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		arrMinTrans[iPlace] = m_arrBase[iPlace];
+		arrMaxTrans[iPlace] = nNumerals - nNumerals / m_arrBase[iPlace];
+		arrEven[iPlace] = IsBipartitePlace(iPlace);
+	}
+	std::vector<int>	arrDevSum(nNumerals + 1), arrNextDevSum(nNumerals + 1);
+	for (int nImbalance = 0; nImbalance < nNumerals; nImbalance++) {	// for each imbalance, least first
+		for (int nLow = 1; nLow <= nNumerals / m_nPlaces; nLow++) {	// for each least count; can't exceed mean
+			// least deviations of counts in window that sum to each total, by dynamic programming over places
+			std::fill(arrDevSum.begin(), arrDevSum.end(), INT_MAX);
+			arrDevSum[0] = 0;
+			for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+				std::fill(arrNextDevSum.begin(), arrNextDevSum.end(), INT_MAX);
+				int	nFirst = std::max(nLow, arrMinTrans[iPlace]);
+				int	nLast = std::min(nLow + nImbalance, arrMaxTrans[iPlace]);
+				for (int nTrans = nFirst; nTrans <= nLast; nTrans++) {	// for each count in window
+					if (arrEven[iPlace] && (nTrans & 1))	// if count has wrong parity
+						continue;
+					int	nSpan = nNumerals / nTrans;	// spans as equal as possible
+					int	nLonger = nNumerals % nTrans;	// number of spans one longer than the rest
+					int	nDev = nSpan - m_nPlaces;
+					int	nPlaceDevSum = (nTrans - nLonger) * nDev * nDev + nLonger * (nDev + 1) * (nDev + 1);
+					for (int nSum = 0; nSum + nTrans <= nNumerals; nSum++) {	// for each total so far
+						if (arrDevSum[nSum] != INT_MAX)	// if total is feasible
+							arrNextDevSum[nSum + nTrans] = std::min(arrNextDevSum[nSum + nTrans], arrDevSum[nSum] + nPlaceDevSum);
+					}
+				}
+				arrDevSum.swap(arrNextDevSum);
+			}
+			if (arrDevSum[nNumerals] != INT_MAX) {	// if window contains a feasible assignment
+				// Smaller imbalances were infeasible, so the assignment's counts
+				// span the whole window; otherwise, an earlier window had it.
+				m_lbound.nImbalance = nImbalance;
+				m_lbound.nMaxTrans = nLow + nImbalance;
+				m_lbound.nMaxSpan = (nNumerals + nLow - 1) / nLow;
+				m_lbound.nDevSum = arrDevSum[nNumerals];
+				return;
+			}
+		}
+	}
+	// no feasible assignment, so no cycle exists; bounds remain infinite
+}
+
+bool CBalaGray::IsBipartitePlace(int iPlace) const
+{
+	// two-color the values of a place's adjacency graph, by depth-first search
+	int	nBase = m_arrBase[iPlace];
+	int	arrColor[ADJACENCY_STRIDE];
+	int	arrStack[ADJACENCY_STRIDE];
+	std::fill(arrColor, arrColor + nBase, -1);	// uncolored
+	for (int iRoot = 0; iRoot < nBase; iRoot++) {	// for each value
+		if (arrColor[iRoot] >= 0)	// if already colored
+			continue;
+		arrColor[iRoot] = 0;
+		int	nStack = 0;
+		arrStack[nStack++] = iRoot;
+		while (nStack) {	// while values remain to be explored
+			int	nFrom = arrStack[--nStack];
+			for (int nTo = 0; nTo < nBase; nTo++) {	// for each value
+				if (nTo == nFrom || !IsStep(iPlace, nFrom, nTo))	// if not adjacent
+					continue;
+				if (arrColor[nTo] < 0) {	// if uncolored
+					arrColor[nTo] = !arrColor[nFrom];	// opposite color
+					arrStack[nStack++] = nTo;
+				} else if (arrColor[nTo] == arrColor[nFrom])	// if same color
+					return false;	// odd cycle
+			}
+		}
+	}
+	return true;
+}
+
+bool CBalaGray::CalcLowerBound(SET_CODE nSetCode, LOWER_BOUND& bound)
+{
+	// compute lower bounds of the given set's metrics, without crawling
+	ResetCrawl();
+	if (!SelectAdjacency(nSetCode))
+		return false;
+	NUMERAL	arrBase;
+	int	nPlaces = GetBases(nSetCode, arrBase);
+	if (nPlaces < 2 || nPlaces > MAX_PLACES) {
+		printf("invalid place count\n");
+		return false;
+	}
+	if (!MakeNumerals(nPlaces, arrBase.b))
+		return false;
+	MakeLowerBound();
+	bound = m_lbound;
+	return true;
 }
 
 void CBalaGray::DumpNumeral(const NUMERAL& num) const
@@ -354,100 +490,364 @@ void CBalaGray::DumpPermutation() const
 	}
 }
 
-void CBalaGray::WriteBalanceToLog(int nImbalance, int nMaxTrans, int nMaxSpan)
+void CBalaGray::WriteBalance(std::ostream& os, const CWinner& winner)
 {
-	m_fOut << "balance = " << nImbalance << ", maxtrans = " << nMaxTrans << ", maxspan = " << nMaxSpan << '\n';
+	// write winner's metrics, including objective policy's columns, without a newline
+	os << "balance = " << winner.m_nImbalance << ", maxtrans = " << winner.m_nMaxTrans;
+	for (int iCol = 0; iCol < CObjective::GetColumnCount(); iCol++) {	// for each of policy's columns
+		std::string	sName(CObjective::GetColumnName(iCol));
+		std::transform(sName.begin(), sName.end(), sName.begin(), ::tolower);
+		os << ", " << sName << " = ";
+		CObjective::WriteColumn(os, winner, iCol);
+	}
 }
 
-void CBalaGray::WriteBalanceToLog(int nImbalance, int nMaxTrans, int nMaxSpan, double fStdDev)
+int CBalaGray::GetWindowMaxTrans(const CWinner& winner, int nWindowLen)
 {
-	m_fOut << "balance = " << nImbalance << ", maxtrans = " << nMaxTrans << ", maxspan = " << nMaxSpan << ", stddev = " << fStdDev << '\n';
+	// Returns the maximum transition count of any place within any window of
+	// the given number of consecutive transitions, including windows that wrap
+	// around from the last numeral to the first. Metrics are recomputed from
+	// the numerals, so this works for winners that were crawled without a window.
+	int	nNumerals = static_cast<int>(winner.m_arrNum.size());
+	if (!nNumerals || nWindowLen < 1)
+		return 0;
+	nWindowLen = std::min(nWindowLen, nNumerals);
+	std::vector<NUMERAL>	arrDiff(nNumerals);	// for each transition, one for each place that changed
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each transition, including wraparound
+		const NUMERAL&	numPrev = winner.m_arrNum[iNum];
+		const NUMERAL&	numCur = winner.m_arrNum[(iNum + 1) % nNumerals];
+		for (int iPlace = 0; iPlace < winner.m_nPlaces; iPlace++) {	// for each place
+			arrDiff[iNum].b[iPlace] = numCur.b[iPlace] != numPrev.b[iPlace];
+		}
+	}
+	int	arrCount[MAX_PLACES] = {0};
+	for (int iNum = 0; iNum < nWindowLen; iNum++) {	// for each transition of first window
+		for (int iPlace = 0; iPlace < winner.m_nPlaces; iPlace++)
+			arrCount[iPlace] += arrDiff[iNum].b[iPlace];
+	}
+	int	nMax = 0;
+	for (int iStart = 0; iStart < nNumerals; iStart++) {	// for each window, sliding it one transition per pass
+		for (int iPlace = 0; iPlace < winner.m_nPlaces; iPlace++) {	// for each place
+			nMax = std::max(nMax, arrCount[iPlace]);
+			arrCount[iPlace] += arrDiff[(iStart + nWindowLen) % nNumerals].b[iPlace] - arrDiff[iStart].b[iPlace];
+		}
+	}
+	return nMax;
 }
 
-void CBalaGray::WritePermutationToLog()
+void CBalaGray::WritePermutationToLog(const CWinner& winner)
 {
-	int	nPerms = GetNumeralCount();
+	int	nPerms = static_cast<int>(winner.m_arrNum.size());
 	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
 		for (int iPerm = 0; iPerm < nPerms; iPerm++) {
-			m_fOut << int(m_arrNum[m_arrState[iPerm].iNum].b[iPlace]) << ' ';
+			*m_pLog << int(winner.m_arrNum[iPerm].b[iPlace]) << ' ';
 		}
-		m_fOut << '\n';
+		*m_pLog << '\n';
 	}
-	m_fOut << '\n';
+	*m_pLog << '\n';
 }
 
-FORCE_INLINE bool CBalaGray::IsGray(NUMERAL num1, NUMERAL num2) const
+void CBalaGray::ReportIncumbent(const CWinner& winner)
 {
-	// Returns true if the given numerals differ by exactly one place.
-	bool	bDiff = false;
-	int	nPlaces = m_nPlaces;
-	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
-		if (num1.b[iPlace] != num2.b[iPlace]) {	// if places differ
-			if (!bDiff) {	// if first difference
-				bDiff = true;	// set flag
-			} else {	// not first difference
-				return false;	// not Gray; early out
-			}
+	// tell console, log and callback about a new incumbent, as applicable
+	if (m_bVerbose) {
+		std::ostringstream	ss;
+		ss << std::fixed;	// same format as printf's %f
+		WriteBalance(ss, winner);
+		printf("%s\n", ss.str().c_str());
+	}
+	if (m_pLog != NULL) {
+		WriteBalance(*m_pLog, winner);
+		*m_pLog << '\n';
+		WritePermutationToLog(winner);
+	}
+	if (m_fnIncumbent)	// if caller wants to hear about new incumbents
+		m_fnIncumbent(winner);
+}
+
+FORCE_INLINE int CBalaGray::GetDiffPlace(const NUMERAL& num1, const NUMERAL& num2) const
+{
+	// returns index of first place in which the given numerals differ
+	int	iPlace = 0;
+	while (iPlace < m_nPlaces - 1 && num1.b[iPlace] == num2.b[iPlace])
+		iPlace++;
+	return iPlace;
+}
+
+bool CBalaGray::IsStep(int iPlace, int nFrom, int nTo) const
+{
+	// Returns true if adjacency mode lets the given place step between the
+	// given values, which are assumed to differ.
+	switch (m_nAdjacency) {
+	case ADJ_CYCLIC:
+		{
+			int	nBase = m_arrBase[iPlace];
+			int	nDiff = nTo - nFrom;
+			if (nDiff < 0)	// wrap difference modulo base
+				nDiff += nBase;
+			return nDiff == 1 || nDiff == nBase - 1;	// next or previous value
 		}
+	case ADJ_CUSTOM:
+		return (m_arrCustomAdjacency[iPlace * ADJACENCY_STRIDE + nFrom] >> nTo) & 1;
 	}
-	return bDiff;
+	return true;	// any value
 }
 
-bool CBalaGray::Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner)
+FORCE_INLINE bool CBalaGray::IsAdjacent(const NUMERAL& num1, const NUMERAL& num2) const
 {
-	assert(parrBase != NULL);
-	if (nPlaces < 2 || nPlaces > MAX_PLACES) {
-		printf("invalid place count\n");
+	// Returns true if the given numerals are Gray, and the place that differs
+	// steps between values that the adjacency mode allows. This is the test
+	// for joining paths and closing cycles; crawling uses successor tables.
+	if (!IsGray(num1, num2))
 		return false;
+	if (m_nAdjacency == ADJ_ANY)	// if unrestricted
+		return true;
+	int	iPlace = GetDiffPlace(num1, num2);
+	return IsStep(iPlace, num1.b[iPlace], num2.b[iPlace]);
+}
+
+bool CBalaGray::IsSecondFixed() const
+{
+	// Returns true if every cycle can start with 0, 1, so that the crawl's
+	// second level is constant too. Custom adjacency may not let the first
+	// place step from 0 to 1, nor make its values interchangeable.
+#if START_2_DOWN
+	return m_nAdjacency != ADJ_CUSTOM;
+#else
+	return false;
+#endif
+}
+
+int CBalaGray::GetTransPlace(int iDepth) const
+{
+	// returns index of place that transitioned between given depth and previous depth
+	return GetDiffPlace(m_arrNum[m_arrState[iDepth - 1].iNum], m_arrNum[m_arrState[iDepth].iNum]);
+}
+
+template<class OBJ> FORCE_INLINE bool IsScoreBetter(const int *parrScore, const int *parrBestScore)
+{
+	// compare policy's keys in lexicographic order; ties aren't better
+	for (int iKey = 0; iKey < OBJ::KEYS; iKey++) {	// for each key
+		if (parrScore[iKey] != parrBestScore[iKey])
+			return parrScore[iKey] < parrBestScore[iKey];
 	}
-	if (!m_fOut.good()) {	// if output file isn't open
-		return false;	// ctor already reported error
-	}
-	Reset();
-	if (!MakeNumerals(nPlaces, parrBase))
+	return false;
+}
+
+template<class OBJ> bool CBalaGray::IsLowerBoundMet(int nImbalance, int nMaxTrans, const int *parrKey) const
+{
+	// true if the given metrics are no worse than the lower bound, and thus optimal
+	if (nImbalance != m_lbound.nImbalance)
+		return nImbalance < m_lbound.nImbalance;
+	if (nMaxTrans != m_lbound.nMaxTrans)
+		return nMaxTrans < m_lbound.nMaxTrans;
+	int	arrBoundKey[OBJ::SCORES];
+	OBJ::MakeScore(m_lbound.nMaxSpan, m_lbound.nDevSum, arrBoundKey);
+	return !IsScoreBetter<OBJ>(arrBoundKey, parrKey);
+}
+
+bool CBalaGray::IsLowerBoundMet(const CWinner& winner) const
+{
+	if (winner.m_arrNum.empty() || m_lbound.nImbalance == INT_MAX)	// if no winner, or no bound
 		return false;
-	MakeGraySuccessorTable();
-//	DumpNumerals();
-//	DumpGraySuccessorTable();
+	int	arrScore[CObjective::SCORES];
+	CObjective::LoadScore(winner, arrScore);
+	return IsLowerBoundMet<CObjective>(winner.m_nImbalance, winner.m_nMaxTrans, arrScore);
+}
+
+template<class OBJ> uint64_t CBalaGray::PackBound(int nImbalance, int nMaxTrans, const int *parrKey)
+{
+	// Pack metrics into one word whose unsigned order is the crawler's order,
+	// so that crawlers can share a bound via a single atomic. A field that's
+	// all ones means no bound; for the numeral limit, real values never are.
+	static_assert(OBJ::KEYS <= 2, "too many keys for packed bound");
+	const int	nKeyBits = BOUND_KEY_BITS / OBJ::KEYS;
+	const uint64_t	nMetricMask = (1ull << BOUND_METRIC_BITS) - 1;
+	const uint64_t	nKeyMask = (1ull << nKeyBits) - 1;
+	uint64_t	nBound = std::min(static_cast<uint64_t>(nImbalance), nMetricMask);
+	nBound = (nBound << BOUND_METRIC_BITS) | std::min(static_cast<uint64_t>(nMaxTrans), nMetricMask);
+	for (int iKey = 0; iKey < OBJ::KEYS; iKey++) {	// for each of policy's keys
+		nBound = (nBound << nKeyBits) | std::min(static_cast<uint64_t>(parrKey[iKey]), nKeyMask);
+	}
+	return nBound << (BOUND_KEY_BITS - nKeyBits * OBJ::KEYS);	// left-justify keys
+}
+
+template<class OBJ> void CBalaGray::UnpackBound(uint64_t nBound, int& nImbalance, int& nMaxTrans, int *parrKey)
+{
+	const int	nKeyBits = BOUND_KEY_BITS / OBJ::KEYS;
+	const uint64_t	nMetricMask = (1ull << BOUND_METRIC_BITS) - 1;
+	const uint64_t	nKeyMask = (1ull << nKeyBits) - 1;
+	nBound >>= BOUND_KEY_BITS - nKeyBits * OBJ::KEYS;
+	for (int iKey = OBJ::KEYS - 1; iKey >= 0; iKey--) {	// for each of policy's keys, last first
+		uint64_t	nKey = nBound & nKeyMask;
+		parrKey[iKey] = nKey == nKeyMask ? INT_MAX : static_cast<int>(nKey);
+		nBound >>= nKeyBits;
+	}
+	uint64_t	nMetric = nBound & nMetricMask;
+	nMaxTrans = nMetric == nMetricMask ? INT_MAX : static_cast<int>(nMetric);
+	nMetric = nBound >> BOUND_METRIC_BITS;
+	nImbalance = nMetric == nMetricMask ? INT_MAX : static_cast<int>(nMetric);
+}
+
+void CBalaGray::PublishBound(uint64_t nBound)
+{
+	// lower shared bound to the given bound, unless another crawler already beat it
+	uint64_t	nShared = m_pSharedBound->load(std::memory_order_relaxed);
+	while (nBound < nShared && !m_pSharedBound->compare_exchange_weak(nShared, nBound, std::memory_order_relaxed)) {
+	}
+}
+
+inline void CBalaGray::PublishNodeCount(uint64_t nNodes)
+{
+	// called periodically from crawl loops; publishes node count, and enforces node limit
+	m_nNodes.store(nNodes, std::memory_order_relaxed);
+	if (m_nNodeLimit && nNodes >= m_nNodeLimit)	// if node budget is spent
+		m_bCancel = true;	// stop crawl; winner isn't proven
+}
+
+template<class OBJ> bool CBalaGray::Crawl(CWinner& seqWinner)
+{
+	OBJ	obj;	// objective policy
 	int	nGraySuccessors = m_nGraySuccessors;
 	int	nGrayStrideShift = m_nGrayStrideShift;
-	DumpSet();
 	int	nNumerals = GetNumeralCount();
-	printf("nPlaces=%d\n", nPlaces);
-	printf("nValues=%d\n", nNumerals);
+	obj.Init(m_nPlaces, nNumerals);
 	int	nBestImbalance = INT_MAX;
 	int	nBestMaxTrans = INT_MAX;
-	int	nBestMaxSpan = INT_MAX;
-	double	fBestStdDev = DBL_MAX;
+	int	arrBestScore[OBJ::SCORES];
+	for (int iScore = 0; iScore < OBJ::SCORES; iScore++) {	// for each of policy's scores
+		arrBestScore[iScore] = INT_MAX;
+	}
 	CPlaceArray	m_arrBestPerm;
 	m_arrBestPerm.resize(nNumerals);
 	m_arrState.resize(nNumerals);
+	if (m_bHaveIncumbent) {	// if caller seeded us with an incumbent
+		if (!ApplyIncumbent<OBJ>(m_arrBestPerm))
+			return false;
+		nBestImbalance = m_winIncumbent.m_nImbalance;	// start pruning from incumbent's metrics
+		nBestMaxTrans = m_winIncumbent.m_nMaxTrans;
+		OBJ::LoadScore(m_winIncumbent, arrBestScore);
+	}
+	// if enumerating frontier, depth at which to store prefixes instead of crawling them
+	int	nFrontierDepth = m_parrFrontier != NULL ? m_nFrontierLen - 1 : INT_MAX;
+	bool	bPareto = m_parrParetoFront != NULL;	// true if keeping Pareto front
+	const int	nParetoScores = OBJ::KEYS + 2;	// imbalance and max transition count precede policy's keys
+	static_assert(nParetoScores <= MAX_PARETO_SCORES, "too many keys for Pareto front");
+	int	arrParetoScore[MAX_PARETO_SCORES];
+	m_arrPareto.clear();
+	if (bPareto && m_bHaveIncumbent) {	// if incumbent specified, it starts the front
+		arrParetoScore[0] = nBestImbalance;
+		arrParetoScore[1] = nBestMaxTrans;
+		memcpy(&arrParetoScore[2], arrBestScore, OBJ::KEYS * sizeof(int));
+		UpdateParetoFront(arrParetoScore, nParetoScores, &m_arrBestPerm);
+	}
+	// If sharing a bound with other crawlers, our best metrics may be adopted
+	// from another crawler, in which case they don't describe our best
+	// permutation, and it must be rescored when we're done. A Pareto front
+	// needs every winner's own scores, so it doesn't share.
+	bool	bShareBound = m_pSharedBound != NULL && !bPareto;
+	bool	bHaveOwnBest = m_bHaveIncumbent;	// true if best permutation is valid
+	bool	bBoundAdopted = false;	// true if best metrics came from another crawler
+	uint64_t	nLocalBound = PackBound<OBJ>(nBestImbalance, nBestMaxTrans, arrBestScore);
+	if (bShareBound && m_bHaveIncumbent)	// if sharing bound, and have an incumbent
+		PublishBound(nLocalBound);
+	// If limiting discrepancies, a branch's discrepancy count is the number of
+	// levels at which it isn't the first child to survive pruning, in the
+	// preferred successor order.
+	bool	bLimitDiscrepancy = m_nMaxDiscrepancy != INT_MAX;
+	std::vector<int>	arrDiscrepancy;	// discrepancy count of branch at each depth
+	std::vector<int>	arrChildren;	// number of children crawled so far at each depth
+	if (bLimitDiscrepancy) {	// if limiting discrepancies
+		arrDiscrepancy.resize(nNumerals);
+		arrChildren.resize(nNumerals);
+	}
+	uint64_t	nNodes = m_nNodes.load(std::memory_order_relaxed);	// non-zero if continuing an iterative crawl
+#if SHOW_STATS
 	uint64_t	nPasses = 0;
 	uint64_t	nGrays = 0;
 	uint64_t	nOptimals = 0;
+	uint64_t	nThresholdCuts = 0;
+	uint64_t	nThresholdRemain = 0;	// sum of numerals remaining at threshold cuts
+	uint64_t	nLookaheadCuts = 0;
+	uint64_t	nLookaheadRemain = 0;	// sum of numerals remaining at lookahead cuts
+#endif
+	// Pruning thresholds are heuristic, as are leaf and lookahead tests that
+	// reject a branch for its max transition count alone, though its imbalance
+	// might beat the best. Any such cut means the crawl isn't a proof. In
+	// certify mode, thresholds are ignored, and those tests are lexicographic,
+	// so every cut is admissible.
+	bool	bLex = m_bCertify;
+	int	nPruneImbalance = m_bCertify ? INT_MAX : m_nPruneImbalance;
+	int	nPruneMaxTrans = m_bCertify ? INT_MAX : m_nPruneMaxTrans;
+	bool	bHeuristicCut = false;	// true if a branch that might beat the best was abandoned
+	bool	bWindow = m_nWindowLen != 0;	// true if bounding transitions per window
+#if BALANCE_LOOKAHEAD
+	// Final balance must fit the pruning threshold, and unless we're keeping
+	// a Pareto front, it mustn't fail the leaf test against the best so far.
+#if DO_PRUNING
+	int	nLookImbalance = nPruneImbalance;
+#else
+	int	nLookImbalance = INT_MAX;
+#endif
+	int	nLookMaxTrans = INT_MAX;
+	if (!bPareto) {	// if single winner
+		nLookImbalance = std::min(nLookImbalance, nBestImbalance);
+		nLookMaxTrans = nBestMaxTrans;
+	}
+#endif
 	uint64_t	nNumeralUsedMask[2] = {0};	// need 128 bits, as number of numerals may exceed 64
 #if PREDICT_WRAP
-	uint64_t	nGrayWrapMask = 0;
-	for (int iOrgSucc = 0; iOrgSucc < m_nGraySuccessors; iOrgSucc++) {	// for each successor of origin
-		int	nShift = m_arrGraySuccessor[iOrgSucc];
-		if (nShift >= ULONGLONG_BITS) {	// if shift too big
-			printf("wrap prediction shift too big\n");
-			return false;
-		}
-		nGrayWrapMask |= 1ull << nShift;	// set successor's corresponding bit in mask
-	}
+	uint64_t	nGrayWrapMask;
+	if (!MakeGrayWrapMask(nGrayWrapMask))
+		return false;
 #endif
-#if START_2_DOWN
-	int	iDepth = 2;	// first two levels are constant to save time; all sequences start with 0, 1
-	m_arrState[1].iNum = 1;
-	m_arrState[1].nTrans.b[0] = 1;
-	nNumeralUsedMask[0] = 0x3;
-#else
 	int	iDepth = 1;	// first level is constant to save time; all sequences start with 0
 	nNumeralUsedMask[0] = 0x1;
-#endif
+	if (IsSecondFixed()) {	// if second level is constant too; all sequences start with 0, 1
+		iDepth = 2;
+		m_arrState[1].iNum = 1;
+		m_arrState[1].nTrans.b[0] = 1;
+		nNumeralUsedMask[0] = 0x3;
+	}
+	if (!m_arrPrefix.empty()) {	// if crawling only the branches below a given prefix
+		if (!ApplyPrefix(iDepth, nNumeralUsedMask))
+			return false;
+	}
 	int	nStartDepth = iDepth;
-	while (!m_bCancel) {	// while cancel not requested
+	for (int iLevel = 1; iLevel < nStartDepth; iLevel++) {	// for each constant level
+		obj.Push(iLevel, GetTransPlace(iLevel));	// update policy's state
+	}
+	m_arrState[iDepth].iGray = 0;	// in case stack is left over from a previous pass
+	m_bDiscrepancyCut = false;
+	// Once the best winner meets the lower bound, it's optimal, so stop. A
+	// Pareto front, a frontier, or state samples need the whole crawl.
+	bool	bStopAtBound = !bPareto && m_parrFrontier == NULL && m_parrStateSample == NULL;
+	bool	bBoundMet = bStopAtBound && IsLowerBoundMet<OBJ>(nBestImbalance, nBestMaxTrans, arrBestScore);
+	while (!bBoundMet && !m_bCancel.load(std::memory_order_relaxed)) {	// while not optimal, and cancel not requested
+		if (!(++nNodes & NODE_COUNT_PERIOD)) {	// if time to publish node count
+			PublishNodeCount(nNodes);
+			if (m_parrStateSample != NULL)	// if sampling crawl states
+				SampleState(iDepth);
+			if (bShareBound) {	// if sharing bound with other crawlers
+				uint64_t	nShared = m_pSharedBound->load(std::memory_order_relaxed);
+				if (nShared < nLocalBound) {	// if another crawler did better, prune with its bound
+					UnpackBound<OBJ>(nShared, nBestImbalance, nBestMaxTrans, arrBestScore);
+					for (int iScore = OBJ::KEYS; iScore < OBJ::SCORES; iScore++) {	// for each reported-only score
+						arrBestScore[iScore] = INT_MAX;	// not shared
+					}
+					nLocalBound = nShared;
+					bBoundAdopted = true;
+#if BALANCE_LOOKAHEAD
+					nLookImbalance = std::min(nLookImbalance, nBestImbalance);
+					nLookMaxTrans = nBestMaxTrans;
+#endif
+					if (bStopAtBound && IsLowerBoundMet<OBJ>(nBestImbalance, nBestMaxTrans, arrBestScore)) {	// if other crawler's best is optimal
+						bBoundMet = true;
+						break;	// stop crawl
+					}
+				}
+			}
+		}
 #if SHOW_STATS
 		nPasses++;
 #endif
@@ -466,15 +866,79 @@ bool CBalaGray::Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner)
 			int	nMaxTrans;
 			NUMERAL	nTransCounts;
 			int	nImbalance = ComputeBalance(iDepth, nMaxTrans, nTransCounts);
+			// if window ending here has too many transitions of the place that just changed;
+			// it's a constraint, not a heuristic, and siblings may change a different place
+			if (bWindow && !IsWindowBalanced(iDepth, nTransCounts, m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + iGray]))
+				goto lblNext;	// try next sibling
 			if (iDepth < nNumerals - 1) {	// if incomplete permutation
 #if DO_PRUNING
-				if (nMaxTrans > m_nPruneMaxTrans || nImbalance > m_nPruneImbalance) {
+				if (nMaxTrans > nPruneMaxTrans || nImbalance > nPruneImbalance) {
+#if SHOW_STATS
+					nThresholdCuts++;
+					nThresholdRemain += nNumerals - iDepth;
+#endif
+					bHeuristicCut = true;
+					goto lblPrune;	// abandon this branch
+				}
+#endif
+#if BALANCE_LOOKAHEAD
+				// if final max transition count or imbalance can't be good enough
+				int	nImbalanceBound = m_arrImbalanceBound[nMaxTrans];
+				if (nImbalanceBound > nLookImbalance
+				|| (nMaxTrans > nLookMaxTrans && (!bLex || nImbalanceBound >= nLookImbalance))) {
+#if SHOW_STATS
+					nLookaheadCuts++;
+					nLookaheadRemain += nNumerals - iDepth;
+#endif
+					// if cut relied on threshold, or on max transition count alone
+					if (bPareto || (nImbalanceBound <= nBestImbalance && (nMaxTrans <= nBestMaxTrans || nImbalanceBound < nBestImbalance)))
+						bHeuristicCut = true;
 					goto lblPrune;	// abandon this branch
 				}
 #endif
+				if (iDepth == nFrontierDepth) {	// if reached frontier depth
+					m_parrFrontier->push_back(CPlaceArray(iDepth + 1));	// store prefix instead of crawling it
+					for (int iNum = 0; iNum <= iDepth; iNum++) {	// for each numeral of prefix
+						m_parrFrontier->back()[iNum] = m_arrState[iNum].iNum;
+					}
+					goto lblNext;	// try next sibling
+				}
+				obj.Push(iDepth, m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + iGray]);	// update policy's state
+				if (OBJ::HAS_BOUND && !nBestImbalance && !bPareto) {	// if policy has bound, and best is perfectly balanced
+					// Completions that could beat best must also be perfectly balanced, and thus
+					// have the same max transition count as best, so only policy's keys matter.
+					int	arrBound[OBJ::KEYS];
+					obj.GetBound(iDepth, arrBound);
+					if (!IsScoreBetter<OBJ>(arrBound, arrBestScore)) {	// if no completion can improve on best
+						obj.Pop(iDepth);	// restore policy's state
+						goto lblNext;	// try next sibling
+					}
+				}
+				if (bPareto) {	// if keeping Pareto front
+					// if front dominates branch's lower bounds; imbalance has no useful
+					// bound, and wraparound adds at most one to max transition count
+					arrParetoScore[0] = 0;
+					arrParetoScore[1] = nMaxTrans - 1;
+					obj.GetBound(iDepth, &arrParetoScore[2]);
+					if (IsParetoDominated(arrParetoScore, nParetoScores)) {
+						obj.Pop(iDepth);	// restore policy's state
+						goto lblNext;	// try next sibling
+					}
+				}
+				if (bLimitDiscrepancy) {	// if limiting discrepancies
+					int	nDiscrepancy = (iDepth > nStartDepth ? arrDiscrepancy[iDepth - 1] : 0) + (arrChildren[iDepth] != 0);
+					if (nDiscrepancy > m_nMaxDiscrepancy) {	// if too many discrepancies
+						obj.Pop(iDepth);	// restore policy's state
+						m_bDiscrepancyCut = true;	// pass isn't exhaustive
+						goto lblPrune;	// remaining siblings are discrepancies too
+					}
+					arrDiscrepancy[iDepth] = nDiscrepancy;
+					arrChildren[iDepth]++;
+					arrChildren[iDepth + 1] = 0;
+				}
 				// crawl one level deeper
 				nNumeralUsedMask[iUsedMask] |= nNumeralMask;	// mark this numeral as used
-				m_arrState[iDepth].nTrans.dw = nTransCounts.dw;	// save current transition counts on stack
+				m_arrState[iDepth].nTrans = nTransCounts;	// save current transition counts on stack
 				iDepth++;	// increment depth to next numeral
 				m_arrState[iDepth].iGray = 0;	// reset index of Gray transitions
 				m_arrState[iDepth].iNum = 0;	// reset numeral index
@@ -482,79 +946,80 @@ bool CBalaGray::Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner)
 			} else {	// reached a leaf: complete permutation, a potential winner
 #if !PREDICT_WRAP	// only need to check for Gray wrap if wrap prediction is disabled
 				// if branch doesn't wrap around Gray (first and last numeral differ by more than one place)
-				if (!IsGray(m_arrNum[m_arrState[0].iNum], m_arrNum[m_arrState[nNumerals - 1].iNum])) {
+				if (!IsAdjacent(m_arrNum[m_arrState[0].iNum], m_arrNum[m_arrState[nNumerals - 1].iNum])) {
 					goto lblPrune;	// abandon this branch
 				}
 #endif
+				if (bWindow && !IsWrapWindowBalanced(iDepth, nTransCounts))	// if a window spanning wraparound is too busy
+					goto lblPrune;	// abandon this branch
 #if SHOW_STATS
 				nGrays++;	// count another Gray permutation
 #endif
+				int	arrScore[OBJ::SCORES];
+				if (bPareto) {	// if keeping Pareto front
+					obj.GetLeafScore(iDepth, m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + iGray], m_arrNum[iNum], arrScore);
+					arrParetoScore[0] = nImbalance;
+					arrParetoScore[1] = nMaxTrans;
+					memcpy(&arrParetoScore[2], arrScore, OBJ::KEYS * sizeof(int));
+					if (!UpdateParetoFront(arrParetoScore, nParetoScores))	// if dominated by front
+						goto lblPrune;	// abandon this branch
+				}	// single winner is still tracked, using usual priorities
 				// if max transition count or imbalance are worse than our current bests
-				if (nMaxTrans > nBestMaxTrans || nImbalance > nBestImbalance) {
+				if (nImbalance > nBestImbalance || (nMaxTrans > nBestMaxTrans && (!bLex || nImbalance == nBestImbalance))) {
+					if (!bPareto && nImbalance < nBestImbalance)	// if rejected for max transition count alone
+						bHeuristicCut = true;
 					goto lblPrune;	// abandon this branch
 				}
-				int	nMaxSpan = ComputeMaxSpan(iDepth);	// compute maximum span length
-#if OPT_STD_DEV == 1	// if standard deviation is max span tie-breaker
-				// if max transition count and imbalance equal our current bests
-				if (nMaxTrans == nBestMaxTrans && nImbalance == nBestImbalance) {
-					if (nMaxSpan > nBestMaxSpan) {	// if max span worsened
-						goto lblPrune;	// abandon this branch
-					}
-				}
-				double fStdDev = ComputeStdDev();	// compute standard deviation
-				if (nMaxTrans == nBestMaxTrans && nImbalance == nBestImbalance && nMaxSpan == nBestMaxSpan) {
-					if (fStdDev >= fBestStdDev) {	// if standard deviation didn't improve
-#if SHOW_STATS
-						if (nMaxSpan == nBestMaxSpan)
-							nOptimals++;
-#endif
-						goto lblPrune;	// abandon this branch
-					}
-				}
-#elif OPT_STD_DEV == 2	// else if standard deviation only, ignoring max span
-				double fStdDev = ComputeStdDev();	// compute standard deviation
-				if (nMaxTrans == nBestMaxTrans && nImbalance == nBestImbalance) {
-					if (fStdDev >= fBestStdDev) {	// if standard deviation didn't improve
-#if SHOW_STATS
-						if (nMaxSpan == nBestMaxSpan)
-							nOptimals++;
-#endif
-						goto lblPrune;	// abandon this branch
-					}
-				}
-#else	// else not optimizing standard deviation; max span only
+				if (!bPareto)	// if leaf scores weren't computed above
+					obj.GetLeafScore(iDepth, m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + iGray], m_arrNum[iNum], arrScore);
 				// if max transition count and imbalance equal our current bests
 				if (nMaxTrans == nBestMaxTrans && nImbalance == nBestImbalance) {
-					if (nMaxSpan >= nBestMaxSpan) {	// if max span didn't improve
+					if (!IsScoreBetter<OBJ>(arrScore, arrBestScore)) {	// if policy's keys didn't improve
 #if SHOW_STATS
-						if (nMaxSpan == nBestMaxSpan)
+						if (!IsScoreBetter<OBJ>(arrBestScore, arrScore))	// if keys are equal
 							nOptimals++;
 #endif
 						goto lblPrune;	// abandon this branch
 					}
 				}
-#endif // OPT_STD_DEV
 				// we have a winner, until a better permutation comes along
 				nBestMaxTrans = nMaxTrans;	// update best max transition count
 				nBestImbalance = nImbalance;	// update best imbalance
-				nBestMaxSpan = nMaxSpan;	// update best maximum span length
-#if OPT_STD_DEV
-				fBestStdDev = fStdDev;
-				printf("balance = %d, maxtrans = %d, maxspan = %d, stddev = %f\n", nImbalance, nMaxTrans, nMaxSpan, fStdDev);
-				WriteBalanceToLog(nImbalance, nMaxTrans, nMaxSpan, fStdDev);
-#else
-				printf("balance = %d, maxtrans = %d, maxspan = %d\n", nImbalance, nMaxTrans, nMaxSpan);
-				WriteBalanceToLog(nImbalance, nMaxTrans, nMaxSpan);
-#endif // OPT_STD_DEV
-				WritePermutationToLog();
+				memcpy(arrBestScore, arrScore, sizeof(arrBestScore));	// update best scores
 				for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
 					m_arrBestPerm[iNum] = m_arrState[iNum].iNum;	// update best permutation's numeral indices
 				}
+				bHaveOwnBest = true;
+				bBoundAdopted = false;	// best metrics are ours again
+				if (bShareBound) {	// if sharing bound with other crawlers
+					nLocalBound = PackBound<OBJ>(nBestImbalance, nBestMaxTrans, arrBestScore);
+					PublishBound(nLocalBound);
+				}
+#if BALANCE_LOOKAHEAD
+				if (!bPareto) {	// if single winner, tighten lookahead limits
+					nLookImbalance = std::min(nLookImbalance, nBestImbalance);
+					nLookMaxTrans = nBestMaxTrans;
+				}
+#endif
+				if (m_bVerbose || m_pLog != NULL || m_fnIncumbent) {	// if anyone wants to hear about new incumbents
+					CWinner	winCur;
+					winCur.m_nImbalance = nImbalance;
+					winCur.m_nMaxTrans = nMaxTrans;
+					MakeWinner(m_arrBestPerm, winCur);
+					OBJ::StoreScore(arrScore, winCur);
+					m_nNodes.store(nNodes, std::memory_order_relaxed);	// so callback sees current count
+					ReportIncumbent(winCur);
+				}
 #if SHOW_STATS
 				nOptimals = 1;	// first instance of new optimality
 #endif
+				if (bStopAtBound && IsLowerBoundMet<OBJ>(nImbalance, nMaxTrans, arrScore)) {	// if winner is optimal
+					bBoundMet = true;
+					break;	// stop crawl
+				}
 			}
 		}
+lblNext:
 		m_arrState[iDepth].iGray++;	// increment Gray transitions index
 		if (m_arrState[iDepth].iGray >= nGraySuccessors) {	// if no Gray successors remain for this numeral
 lblPrune:
@@ -562,6 +1027,7 @@ lblPrune:
 				break;	// exit main loop
 			} else {	// sufficient levels remain above us
 				iDepth--;	// back up a level
+				obj.Pop(iDepth);	// restore policy's state
 				// restore bitmask that keeps track of which numerals we've used on this branch
 				int	iNum = m_arrState[iDepth].iNum;	// number of numerals may exceed 64
 				int	iUsedMask = iNum >= ULONGLONG_BITS;	// index selects one of two 64-bit masks
@@ -576,246 +1042,1249 @@ lblPrune:
 	}
 #if SHOW_STATS
 	printf("nPasses = %lld nGrays = %lld nOptimals = %lld\n", nPasses, nGrays, nOptimals);
+	printf("threshold cuts = %lld, mean remaining = %.2f; lookahead cuts = %lld, mean remaining = %.2f\n",
+		nThresholdCuts, nThresholdCuts ? double(nThresholdRemain) / nThresholdCuts : 0.0,
+		nLookaheadCuts, nLookaheadCuts ? double(nLookaheadRemain) / nLookaheadCuts : 0.0);
 #endif
+	m_nNodes.store(nNodes, std::memory_order_relaxed);	// publish final node count
+	m_bLowerBoundMet = bBoundMet;
+	m_bHeuristicCut = bHeuristicCut;
+	if (bBoundMet && m_bVerbose)
+		printf("lower bound met\n");
 	// pass winning sequence back to caller
-	seqWinner.m_nPlaces = nPlaces;
-	seqWinner.m_nBaseSum = 0;
-	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {
-		seqWinner.m_nBaseSum += parrBase[iPlace];
+	if (bBoundAdopted) {	// if best metrics came from another crawler
+		if (bHaveOwnBest) {	// if we found a winner of our own
+			ScorePermutation<OBJ>(m_arrBestPerm, seqWinner);	// recover its metrics
+			seqWinner.m_bIsProven = bBoundMet || (!m_bCancel && !bHeuristicCut);
+			return true;
+		}
+		nBestImbalance = INT_MAX;	// report no winner, as usual
+		nBestMaxTrans = INT_MAX;
+		for (int iScore = 0; iScore < OBJ::SCORES; iScore++) {	// for each of policy's scores
+			arrBestScore[iScore] = INT_MAX;
+		}
 	}
 	seqWinner.m_nImbalance = nBestImbalance;
 	seqWinner.m_nMaxTrans = nBestMaxTrans;
-	seqWinner.m_nMaxSpan = nBestMaxSpan;
-#if OPT_STD_DEV
-	seqWinner.m_fStdDev = fBestStdDev;
-#endif
-	seqWinner.m_bIsProven = !m_bCancel;
-	seqWinner.m_arrNum.resize(nNumerals);
-	for (int iNum = 0; iNum < nNumerals; iNum++) {
-		seqWinner.m_arrNum[iNum].dw = m_arrNum[m_arrBestPerm[iNum]].dw;
-	}
+	seqWinner.m_bIsProven = bBoundMet || (!m_bCancel && !bHeuristicCut);
+	MakeWinner(m_arrBestPerm, seqWinner);
+	OBJ::StoreScore(arrBestScore, seqWinner);
+	if (bPareto)	// if keeping Pareto front
+		MakeParetoFront<OBJ>(seqWinner.m_bIsProven);
 	return true;
 }
 
-FORCE_INLINE int CBalaGray::ComputeBalance(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const
+template<class OBJ> bool CBalaGray::DiscrepancyCrawl(CWinner& seqWinner)
 {
-	int	nPlaces = m_nPlaces;
-	NUMERAL	nTrans;
-	nTrans.dw = m_arrState[iDepth - 1].nTrans.dw;	// load latest transition counts from stack
-	// compare current state to previous state
-	NUMERAL	sPrev, sCur;
-	sPrev.dw = m_arrNum[m_arrState[iDepth - 1].iNum].dw;
-	sCur.dw = m_arrNum[m_arrState[iDepth].iNum].dw;
-	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
-		if (sCur.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
-			nTrans.b[iPlace]++;	// increment place's transition count
+	// Limited discrepancy search: crawl in passes, allowing each branch to
+	// deviate from the preferred successor order at a limited number of levels,
+	// and raise the limit after each pass. Early passes sample the whole tree
+	// instead of exhausting its first corner. Each pass starts from the best
+	// winner so far, so it prunes as hard as the previous pass ended. A pass
+	// that abandons no branches for exceeding the limit is exhaustive.
+	bool	bHadIncumbent = m_bHaveIncumbent;
+	CWinner	winIncumbent(m_winIncumbent);
+	bool	bResult = true;
+	m_nMaxDiscrepancy = 0;
+	while (1) {
+		if (m_bVerbose)
+			printf("discrepancy limit %d\n", m_nMaxDiscrepancy);
+		if (!Crawl<OBJ>(seqWinner)) {
+			bResult = false;
+			break;
 		}
-	}
-	nTransCounts = nTrans;	// order matters; counts passed back to caller must exclude wraparound
-	// account for wraparound; compare current state to initial state, which is assumed to be zero
-	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
-		if (sCur.b[iPlace]) {	// if place transitioned
-			nTrans.b[iPlace]++;	// increment place's transition count
+		if (seqWinner.m_nImbalance != INT_MAX) {	// if we have a winner
+			m_winIncumbent = seqWinner;	// next pass starts from it
+			m_bHaveIncumbent = true;
 		}
+		if (!m_bDiscrepancyCut || m_bCancel || m_bLowerBoundMet)	// if pass was exhaustive, or canceled, or winner is optimal
+			break;
+		m_nMaxDiscrepancy += m_nDiscrepancyStep;
 	}
-	// now that we have latest transition counts, compute their min and max
-	int	nMin = nTrans.b[0];	// initialize min and max to first transition count
-	int	nMax = nTrans.b[0];
-	for (int iPlace = 1; iPlace < nPlaces; iPlace++) {	// for each transition count, excluding first
-		int	n = nTrans.b[iPlace];
-		if (n < nMin)	// if less than min
-			nMin = n;	// update min
-		if (n > nMax)	// if greater than max
-			nMax = n;	// udpate max
-	}
-	nMaxTrans = nMax;
-	return nMax - nMin;	// return difference
+	seqWinner.m_bIsProven = m_bLowerBoundMet || (!m_bDiscrepancyCut && !m_bCancel && !m_bHeuristicCut);
+	m_nMaxDiscrepancy = INT_MAX;	// restore usual crawl
+	m_bHaveIncumbent = bHadIncumbent;	// restore caller's incumbent
+	m_winIncumbent = winIncumbent;
+	return bResult;
 }
 
-FORCE_INLINE int CBalaGray::ComputeMaxSpan(int iDepth) const
+template<class OBJ> bool CBalaGray::MeetCrawl(CWinner& seqWinner)
 {
-	int	arrSpan[MAX_PLACES];
-	int	arrFirstSpan[MAX_PLACES];
-	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-		arrSpan[iPlace] = 1;	// initial span length is one
-		arrFirstSpan[iPlace] = 0;	// first span length not set
-	}
-	int	nMaxSpan = 1;
-	NUMERAL	sFirst, sPrev;
-	sFirst.dw = m_arrNum[m_arrState[0].iNum].dw;	// store first state
-	sPrev.dw = sFirst.dw;
-	for (int iState = 1; iState <= iDepth; iState++) {	// for each state, excluding first
-		NUMERAL	s;
-		s.dw = m_arrNum[m_arrState[iState].iNum].dw;	// compare this state to previous state
-		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-			if (s.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
-				if (arrSpan[iPlace] > nMaxSpan)	// if span length exceeds max
-					nMaxSpan = arrSpan[iPlace];	// update max span length
-				if (!arrFirstSpan[iPlace])	// if first span length hasn't been set
-					arrFirstSpan[iPlace] = arrSpan[iPlace];	// save first span length
-				arrSpan[iPlace] = 1;	// reset span length
-			} else {	// place didn't transition
-				arrSpan[iPlace]++;	// increment span length
-			}
-		}
-		sPrev = s;	// update previous state
+	// Meet-in-the-middle crawl. Every cycle ends at a Gray neighbor of the
+	// origin, so a cycle read backward from the origin is also a path. First
+	// enumerate all backward halves: paths of the given length that start at
+	// each of the origin's successors, indexed by the set of numerals they
+	// use. Then crawl forward halves from the usual start, and at the meeting
+	// depth, join each forward half to every backward half that uses exactly
+	// the numerals the forward half doesn't, and starts Gray to its end. The
+	// same pruning applies to both halves, as either one is a prefix of some
+	// cycle, read in one direction or the other.
+	int	nGraySuccessors = m_nGraySuccessors;
+	int	nGrayStrideShift = m_nGrayStrideShift;
+	int	nNumerals = GetNumeralCount();
+	int	nStartDepth = IsSecondFixed() ? 2 : 1;	// all sequences start with 0, and maybe 1
+	int	nBackLen = m_nMeetBackLen;
+	int	nMeetDepth = nNumerals - nBackLen;	// depth of first numeral of backward half
+	if (nBackLen < 1 || nMeetDepth < nStartDepth + 1) {
+		printf("invalid meet length\n");
+		return false;
 	}
-	// wrap around from last to first state
-	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-		if (sFirst.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
-			if (arrSpan[iPlace] > nMaxSpan)	// if span length exceeds max
-				nMaxSpan = arrSpan[iPlace];	// update max span length
-		} else {	// place didn't transition
-			arrSpan[iPlace] += arrFirstSpan[iPlace];	// compute wrapped span length
-			if (arrSpan[iPlace] > nMaxSpan)	// if span length exceeds max
-				nMaxSpan = arrSpan[iPlace];	// update max span length
-		}
+	if (!m_arrPrefix.empty() || m_parrFrontier != NULL || m_parrParetoFront != NULL) {
+		printf("meet-in-the-middle doesn't support prefix, frontier or Pareto modes\n");
+		return false;
 	}
-	return nMaxSpan;
-}
-
-FORCE_INLINE int CBalaGray::CalcDeviance(int nSamp) const
-{
-	int	nDev = nSamp - m_nPlaces;	// deviation from mean
-	return nDev * nDev;	// squared
-}
-
-double CBalaGray::ComputeStdDev() const
-{
-	int	arrSpan[MAX_PLACES];
-	int	arrFirstSpan[MAX_PLACES];
-	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-		arrSpan[iPlace] = 1;	// initial span length is one
-		arrFirstSpan[iPlace] = 0;	// first span length not set
-	}
-	NUMERAL	sFirst, sPrev;
-	sFirst.dw = m_arrNum[m_arrState[0].iNum].dw;	// store first state
-	sPrev.dw = sFirst.dw;
-	double	fDevSum = 0;
-	int nPerms = int(m_arrState.size());
-	for (int iPerm = 1; iPerm < nPerms; iPerm++) {	// for each permutation, excluding first
-		NUMERAL	s;
-		s.dw = m_arrNum[m_arrState[iPerm].iNum].dw;	// compare this state to previous state
-		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-			if (s.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
-				if (!arrFirstSpan[iPlace]) {	// if first span length hasn't been set
-					arrFirstSpan[iPlace] = arrSpan[iPlace];	// save first span length
-				} else {
-					fDevSum += CalcDeviance(arrSpan[iPlace]);
+	OBJ	obj;	// objective policy
+	obj.Init(m_nPlaces, nNumerals);
+	int	nBestImbalance = INT_MAX;
+	int	nBestMaxTrans = INT_MAX;
+	int	arrBestScore[OBJ::SCORES];
+	for (int iScore = 0; iScore < OBJ::SCORES; iScore++) {	// for each of policy's scores
+		arrBestScore[iScore] = INT_MAX;
+	}
+	CPlaceArray	arrBestPerm(nNumerals);
+	m_arrState.resize(nNumerals);
+	if (m_bHaveIncumbent) {	// if caller seeded us with an incumbent
+		if (!ApplyIncumbent<OBJ>(arrBestPerm))
+			return false;
+		nBestImbalance = m_winIncumbent.m_nImbalance;	// start pruning from incumbent's metrics
+		nBestMaxTrans = m_winIncumbent.m_nMaxTrans;
+		OBJ::LoadScore(m_winIncumbent, arrBestScore);
+	}
+	uint64_t	nNodes = 0;
+	bool	bHeuristicCut = false;	// true if a branch that might beat the best was abandoned; see Crawl
+	uint64_t	nConstUsedMask[2] = {0};	// numerals used by constant levels of forward crawl
+	m_arrState[0].iNum = 0;
+	m_arrState[0].nTrans.Zero();
+	for (int iLevel = 1; iLevel < nStartDepth; iLevel++) {	// for each constant level after origin
+		m_arrState[iLevel].iNum = static_cast<PLACE>(iLevel);
+		m_arrState[iLevel].nTrans = m_arrState[iLevel - 1].nTrans;
+		m_arrState[iLevel].nTrans.b[GetTransPlace(iLevel)]++;
+	}
+	for (int iLevel = 0; iLevel < nStartDepth; iLevel++) {	// for each constant level
+		nConstUsedMask[0] |= 1ull << m_arrState[iLevel].iNum;
+	}
+	// enumerate backward halves; each one is stored in forward order
+	CMeetMap	mapHalf;
+	CMeetHalfArray	arrHalf;
+	CPlaceArray	arrHalfNum;	// numerals of all halves, concatenated
+	CPlaceArray	arrBack(nBackLen);	// current backward path, starting from origin's successor
+	CPlaceArray	arrBackGray(nBackLen);	// index of Gray successor at each level of backward path
+	CNumeralArray	arrBackTrans(nBackLen);	// transition counts at each level, including origin's
+	MEET_KEY	keyUsed = {{nConstUsedMask[0], nConstUsedMask[1]}};
+	int	iLevel = 0;
+	arrBackGray[0] = 0;
+	while (!m_bCancel.load(std::memory_order_relaxed)) {	// while cancel not requested
+		if (!(++nNodes & NODE_COUNT_PERIOD))	// if time to publish node count
+			PublishNodeCount(nNodes);
+		int	iPrevNum = iLevel ? arrBack[iLevel - 1] : 0;
+		int	iNum = m_arrGraySuccessor[(iPrevNum << nGrayStrideShift) + arrBackGray[iLevel]];
+		int	iUsedMask = iNum >= ULONGLONG_BITS;	// index selects one of two 64-bit masks
+		uint64_t	nNumeralMask = 1ull << (iNum & (ULONGLONG_BITS - 1));
+		if (!(keyUsed.arrMask[iUsedMask] & nNumeralMask)) {	// if numeral hasn't been used yet on this branch
+			NUMERAL	nTrans;
+			if (iLevel)
+				nTrans = arrBackTrans[iLevel - 1];
+			else
+				nTrans.Zero();
+			nTrans.b[m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + arrBackGray[iLevel]]]++;
+#if DO_PRUNING
+			int	nMaxTrans;
+			int	nImbalance = ComputeWrapBalance(nTrans, m_arrNum[iNum], nMaxTrans);
+			if (nMaxTrans > m_nPruneMaxTrans || nImbalance > m_nPruneImbalance) {
+				bHeuristicCut = true;
+				goto lblBackNext;	// abandon this branch
+			}
+#endif
+			arrBack[iLevel] = static_cast<PLACE>(iNum);
+			if (iLevel < nBackLen - 1) {	// if incomplete half
+				arrBackTrans[iLevel] = nTrans;
+				keyUsed.arrMask[iUsedMask] |= nNumeralMask;	// mark this numeral as used
+				iLevel++;
+				arrBackGray[iLevel] = 0;
+				continue;	// equivalent to recursion
+			}
+			// complete half; index it by the numerals it uses, excluding constant levels
+			if (static_cast<int>(arrHalf.size()) >= MAX_MEET_HALVES) {
+				printf("too many half paths; shorten backward halves\n");
+				return false;
+			}
+			MEET_KEY	keyHalf = keyUsed;
+			keyHalf.arrMask[iUsedMask] |= nNumeralMask;
+			keyHalf.arrMask[0] &= ~nConstUsedMask[0];
+			keyHalf.arrMask[1] &= ~nConstUsedMask[1];
+			MEET_HALF	half;
+			half.nTrans = nTrans;
+			half.iNum = static_cast<int>(arrHalfNum.size());
+			std::pair<CMeetMap::iterator, bool>	res = mapHalf.insert(CMeetMap::value_type(keyHalf, -1));
+			half.iNext = res.first->second;	// chain to previous halves with same key
+			res.first->second = static_cast<int>(arrHalf.size());
+			arrHalf.push_back(half);
+			for (int iBack = nBackLen - 1; iBack >= 0; iBack--) {	// reverse path into forward order
+				arrHalfNum.push_back(arrBack[iBack]);
+			}
+		}
+lblBackNext:
+		arrBackGray[iLevel]++;
+		while (arrBackGray[iLevel] >= nGraySuccessors) {	// while no Gray successors remain
+			if (!iLevel)	// if at top level
+				goto lblBackDone;
+			iLevel--;	// back up a level
+			int	iNum = arrBack[iLevel];
+			keyUsed.arrMask[iNum >= ULONGLONG_BITS] &= ~(1ull << (iNum & (ULONGLONG_BITS - 1)));
+			arrBackGray[iLevel]++;
+		}
+	}
+lblBackDone:
+	if (m_bVerbose)
+		printf("%d backward halves of length %d, %d distinct\n", static_cast<int>(arrHalf.size()), nBackLen, static_cast<int>(mapHalf.size()));
+	// crawl forward halves, joining them to backward halves at meeting depth
+	uint64_t	nAllMask[2] = {0};
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
+		nAllMask[iNum >= ULONGLONG_BITS] |= 1ull << (iNum & (ULONGLONG_BITS - 1));
+	}
+	uint64_t	nNumeralUsedMask[2] = {nConstUsedMask[0], nConstUsedMask[1]};
+	int	iDepth = nStartDepth;
+	for (int iLevel = 1; iLevel < nStartDepth; iLevel++) {	// for each constant level
+		obj.Push(iLevel, GetTransPlace(iLevel));	// update policy's state
+	}
+	m_arrState[iDepth].iGray = 0;
+	int	nLastDepth = nMeetDepth - 1;	// depth of forward half's last numeral
+	while (!m_bCancel.load(std::memory_order_relaxed)) {	// while cancel not requested
+		if (!(++nNodes & NODE_COUNT_PERIOD))	// if time to publish node count
+			PublishNodeCount(nNodes);
+		int	iPrevNum = m_arrState[iDepth - 1].iNum;
+		int	iGray = m_arrState[iDepth].iGray;
+		int	iNum = m_arrGraySuccessor[(iPrevNum << nGrayStrideShift) + iGray];
+		int	iUsedMask = iNum >= ULONGLONG_BITS;	// index selects one of two 64-bit masks
+		uint64_t	nNumeralMask = 1ull << (iNum & (ULONGLONG_BITS - 1));
+		if (!(nNumeralUsedMask[iUsedMask] & nNumeralMask)) {	// if numeral hasn't been used yet on this branch
+			m_arrState[iDepth].iNum = static_cast<PLACE>(iNum);	// save numeral index on stack
+			int	nMaxTrans;
+			NUMERAL	nTransCounts;
+			int	nImbalance = ComputeBalance(iDepth, nMaxTrans, nTransCounts);
+#if DO_PRUNING
+			if (nMaxTrans > m_nPruneMaxTrans || nImbalance > m_nPruneImbalance) {
+				bHeuristicCut = true;
+				goto lblNext;	// abandon this branch
+			}
+#endif
+#if BALANCE_LOOKAHEAD
+			if (nMaxTrans > nBestMaxTrans || m_arrImbalanceBound[nMaxTrans] > nBestImbalance) {	// if final balance can't beat best
+				if (m_arrImbalanceBound[nMaxTrans] < nBestImbalance)	// if rejected for max transition count alone
+					bHeuristicCut = true;
+				goto lblNext;	// abandon this branch
+			}
+#if DO_PRUNING
+			if (m_arrImbalanceBound[nMaxTrans] > m_nPruneImbalance) {	// if final imbalance can't fit threshold
+				bHeuristicCut = true;
+				goto lblNext;	// abandon this branch
+			}
+#endif
+#endif
+			obj.Push(iDepth, m_arrGrayPlace[(iPrevNum << nGrayStrideShift) + iGray]);	// update policy's state
+			if (OBJ::HAS_BOUND && !nBestImbalance) {	// if policy has bound, and best is perfectly balanced
+				int	arrBound[OBJ::KEYS];
+				obj.GetBound(iDepth, arrBound);
+				if (!IsScoreBetter<OBJ>(arrBound, arrBestScore)) {	// if no completion can improve on best
+					obj.Pop(iDepth);	// restore policy's state
+					goto lblNext;	// try next sibling
+				}
+			}
+			if (iDepth < nLastDepth) {	// if incomplete forward half
+				nNumeralUsedMask[iUsedMask] |= nNumeralMask;	// mark this numeral as used
+				m_arrState[iDepth].nTrans = nTransCounts;	// save current transition counts on stack
+				iDepth++;	// increment depth to next numeral
+				m_arrState[iDepth].iGray = 0;	// reset index of Gray transitions
+				continue;	// equivalent to recursion
+			}
+			// complete forward half; look up backward halves that use the remaining numerals
+			MEET_KEY	keyRest = {{nAllMask[0] & ~nNumeralUsedMask[0], nAllMask[1] & ~nNumeralUsedMask[1]}};
+			keyRest.arrMask[iUsedMask] &= ~nNumeralMask;
+			CMeetMap::const_iterator	iter = mapHalf.find(keyRest);
+			if (iter != mapHalf.end()) {	// if any backward halves complement this forward half
+				const NUMERAL&	numEnd = m_arrNum[iNum];
+				for (int iHalf = iter->second; iHalf >= 0; iHalf = arrHalf[iHalf].iNext) {	// for each such half
+					const MEET_HALF&	half = arrHalf[iHalf];
+					const PLACE	*pHalfNum = &arrHalfNum[half.iNum];
+					const NUMERAL&	numStart = m_arrNum[pHalfNum[0]];
+					if (!IsAdjacent(numEnd, numStart))	// if halves don't meet
+						continue;
+					// total transition counts are forward's, plus backward's, plus the join's
+					NUMERAL	nTrans = nTransCounts;
+					int	nJoinPlace = GetDiffPlace(numEnd, numStart);
+					nTrans.b[nJoinPlace]++;
+					int	nMin = INT_MAX;
+					int	nMax = 0;
+					for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+						int	n = nTrans.b[iPlace] + half.nTrans.b[iPlace];
+						nMin = std::min(nMin, n);
+						nMax = std::max(nMax, n);
+					}
+					int	nJoinImbalance = nMax - nMin;
+					// same leaf rules as crawler
+					if (nMax > nBestMaxTrans || nJoinImbalance > nBestImbalance) {
+						if (nJoinImbalance < nBestImbalance)	// if rejected for max transition count alone
+							bHeuristicCut = true;
+						continue;
+					}
+					int	arrScore[OBJ::SCORES];
+					int	iPlace = nJoinPlace;
+					for (int iBack = 0; iBack < nBackLen; iBack++) {	// for each numeral of backward half
+						int	iCurDepth = nMeetDepth + iBack;
+						if (iBack)
+							iPlace = GetDiffPlace(m_arrNum[pHalfNum[iBack - 1]], m_arrNum[pHalfNum[iBack]]);
+						if (iCurDepth < nNumerals - 1)	// if not last numeral
+							obj.Push(iCurDepth, iPlace);
+						else	// last numeral; compute leaf scores
+							obj.GetLeafScore(iCurDepth, iPlace, m_arrNum[pHalfNum[iBack]], arrScore);
+					}
+					for (int iCurDepth = nNumerals - 2; iCurDepth >= nMeetDepth; iCurDepth--) {	// for each pushed depth
+						obj.Pop(iCurDepth);	// restore policy's state
+					}
+					if (nMax == nBestMaxTrans && nJoinImbalance == nBestImbalance
+					&& !IsScoreBetter<OBJ>(arrScore, arrBestScore))	// if policy's keys didn't improve
+						continue;
+					// we have a winner, until a better permutation comes along
+					nBestMaxTrans = nMax;
+					nBestImbalance = nJoinImbalance;
+					memcpy(arrBestScore, arrScore, sizeof(arrBestScore));
+					for (int iPerm = 0; iPerm < nMeetDepth; iPerm++) {	// for each numeral of forward half
+						arrBestPerm[iPerm] = m_arrState[iPerm].iNum;
+					}
+					for (int iBack = 0; iBack < nBackLen; iBack++) {	// for each numeral of backward half
+						arrBestPerm[nMeetDepth + iBack] = pHalfNum[iBack];
+					}
+					if (m_bVerbose || m_pLog != NULL || m_fnIncumbent) {	// if anyone wants to hear about new incumbents
+						CWinner	winCur;
+						winCur.m_nImbalance = nJoinImbalance;
+						winCur.m_nMaxTrans = nMax;
+						MakeWinner(arrBestPerm, winCur);
+						OBJ::StoreScore(arrScore, winCur);
+						m_nNodes.store(nNodes, std::memory_order_relaxed);	// so callback sees current count
+						ReportIncumbent(winCur);
+					}
+				}
+			}
+			obj.Pop(iDepth);	// restore policy's state
+		}
+lblNext:
+		m_arrState[iDepth].iGray++;	// increment Gray transitions index
+		while (m_arrState[iDepth].iGray >= nGraySuccessors) {	// while no Gray successors remain
+			if (iDepth <= nStartDepth)	// if we're at same level where we started
+				goto lblDone;
+			iDepth--;	// back up a level
+			obj.Pop(iDepth);	// restore policy's state
+			int	iNum = m_arrState[iDepth].iNum;
+			nNumeralUsedMask[iNum >= ULONGLONG_BITS] &= ~(1ull << (iNum & (ULONGLONG_BITS - 1)));
+			m_arrState[iDepth].iGray++;
+		}
+	}
+lblDone:
+	m_nNodes.store(nNodes, std::memory_order_relaxed);	// publish final node count
+	seqWinner.m_nImbalance = nBestImbalance;
+	seqWinner.m_nMaxTrans = nBestMaxTrans;
+	seqWinner.m_bIsProven = !m_bCancel && !bHeuristicCut;
+	MakeWinner(arrBestPerm, seqWinner);
+	OBJ::StoreScore(arrBestScore, seqWinner);
+	return true;
+}
+
+template<class OBJ> bool CBalaGray::BeamCrawl(CWinner& seqWinner)
+{
+	// Beam search: a fast approximation for sets too big to crawl. Instead of
+	// crawling depth first, extend every kept partial path by each of its Gray
+	// successors at once, score all of a depth's candidates in one batch, and
+	// keep only the best few for the next depth. The used numerals and wrap
+	// prediction are hard filters, as in the crawler. So is a degree test: a
+	// cycle enters and leaves each unused numeral, so each one needs at least
+	// two neighbors that are unused, the path's end, or the origin. Only the
+	// old end's neighbors can fail it when the path grows, as the old end is
+	// no longer available to them. Without it, a narrow beam tends to be
+	// filled with dead ends that are all discovered too late. Ranking is by
+	// imbalance, maximum transition count, a lower bound on maximum span length
+	// that includes the spans still open, and the sum of squared deviations of
+	// closed spans plus the excess of open spans. Once only a few numerals
+	// remain, each kept path is completed exhaustively and scored exactly, as
+	// the last few levels decide whether a path closes at all. If no depth had
+	// more candidates than the beam width, every path was kept, so the winner
+	// is proven.
+	int	nNumerals = GetNumeralCount();
+	int	nGraySuccessors = m_nGraySuccessors;
+	int	nGrayStrideShift = m_nGrayStrideShift;
+	int	nWidth = m_nBeamWidth;
+	if (nWidth < 1) {
+		printf("invalid beam width\n");
+		return false;
+	}
+	if (!m_arrPrefix.empty() || m_parrFrontier != NULL || m_parrParetoFront != NULL) {
+		printf("beam search doesn't support prefix, frontier or Pareto modes\n");
+		return false;
+	}
+	if (m_bHaveIncumbent) {	// if caller seeded us with an incumbent
+		CPlaceArray	arrIncumbentPerm(nNumerals);
+		if (!ApplyIncumbent<OBJ>(arrIncumbentPerm))	// validate and rescore it
+			return false;
+	}
+	std::vector<MEET_KEY>	arrNeighbor(nNumerals);	// Gray successors of each numeral, as a bitmask
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
+		MEET_KEY&	key = arrNeighbor[iNum];
+		key.arrMask[0] = 0;
+		key.arrMask[1] = 0;
+		for (int iGray = 0; iGray < nGraySuccessors; iGray++) {	// for each Gray successor
+			int	iSucc = m_arrGraySuccessor[(iNum << nGrayStrideShift) + iGray];
+			if (iSucc == iNum)	// if padding
+				continue;
+			key.arrMask[iSucc >= ULONGLONG_BITS] |= 1ull << (iSucc & (ULONGLONG_BITS - 1));
+		}
+	}
+	const uint64_t	*parrWrapMask = arrNeighbor[0].arrMask;	// last numeral must be one of origin's successors
+	std::vector<CBeamLinkArray>	arrHistory(nNumerals);	// beam at each depth, for recovering paths
+	CBeamNodeArray	arrNode(1);	// current beam
+	CBeamNodeArray	arrNext;	// next depth's beam
+	CBeamCandArray	arrCand;	// current depth's candidates
+	std::vector<uint64_t>	arrKey;	// packed score of each candidate; lower is better
+	std::vector<int>	arrRank;	// indices of candidates, best first after selection
+	CBeamEndMap	mapKeptEnds;	// for each set of used numerals, ends of kept paths that use it
+	BEAM_NODE&	nodeOrigin = arrNode[0];
+	memset(&nodeOrigin, 0, sizeof(nodeOrigin));
+	nodeOrigin.arrUsedMask[0] = 0x1;
+	BEAM_LINK	linkOrigin = {-1, 0};
+	arrHistory[0].push_back(linkOrigin);
+	int	nStartDepth = 1;	// all sequences start with 0
+	if (IsSecondFixed()) {	// if all sequences start with 0, 1
+		nStartDepth = 2;
+		nodeOrigin.iNum = 1;
+		nodeOrigin.nTrans.b[0] = 1;
+		nodeOrigin.nLastTrans.b[0] = 1;
+		nodeOrigin.nMaxSpan = 1;
+		nodeOrigin.arrUsedMask[0] = 0x3;
+		BEAM_LINK	linkSecond = {0, 1};
+		arrHistory[1].push_back(linkSecond);
+	}
+	CWinner	winBest;	// best complete path; empty if none
+	CPlaceArray	arrPerm(nNumerals);
+	bool	bTruncated = false;	// true if any depth had more candidates than the beam width
+	uint64_t	nNodes = 0;
+	for (int iDepth = nStartDepth; iDepth < nNumerals; iDepth++) {	// for each depth
+		if (m_bCancel.load(std::memory_order_relaxed))	// if cancel requested
+			break;
+		int	nNodesInBeam = static_cast<int>(arrNode.size());
+		if (nNumerals - iDepth <= BEAM_FINISH_LEN) {	// if few numerals remain, complete each path exhaustively
+			for (int iNode = 0; iNode < nNodesInBeam; iNode++) {	// for each node in beam
+				int	iParent = iNode;
+				for (int iLevel = iDepth - 1; iLevel >= 0; iLevel--) {	// for each level, walking back to origin
+					const BEAM_LINK&	link = arrHistory[iLevel][iParent];
+					arrPerm[iLevel] = link.iNum;
+					iParent = link.iParent;
 				}
-				arrSpan[iPlace] = 1;	// reset span length
-			} else {	// place didn't transition
-				arrSpan[iPlace]++;	// increment span length
+				uint64_t	arrUsed[2] = {arrNode[iNode].arrUsedMask[0], arrNode[iNode].arrUsedMask[1]};
+				FinishBeamPath<OBJ>(iDepth, arrPerm, arrUsed, winBest, nNodes);
+				m_nNodes.store(nNodes, std::memory_order_relaxed);
+			}
+			break;
+		}
+		arrCand.clear();
+		for (int iNode = 0; iNode < nNodesInBeam; iNode++) {	// for each node in beam
+			const BEAM_NODE&	node = arrNode[iNode];
+			int	iRow = node.iNum << nGrayStrideShift;
+			for (int iGray = 0; iGray < nGraySuccessors; iGray++) {	// for each Gray successor
+				int	iNum = m_arrGraySuccessor[iRow + iGray];
+				int	iUsedMask = iNum >= ULONGLONG_BITS;
+				uint64_t	nNumeralMask = 1ull << (iNum & (ULONGLONG_BITS - 1));
+				if (node.arrUsedMask[iUsedMask] & nNumeralMask)	// if numeral already used
+					continue;
+				uint64_t	arrUsed[2] = {node.arrUsedMask[0], node.arrUsedMask[1]};
+				arrUsed[iUsedMask] |= nNumeralMask;
+				// at least one of origin's successors must remain unused
+				if ((arrUsed[0] & parrWrapMask[0]) == parrWrapMask[0]
+				&& (arrUsed[1] & parrWrapMask[1]) == parrWrapMask[1])
+					continue;
+				if (!IsBeamDegreeOK(arrNeighbor, arrUsed, node.iNum, iNum))	// if some numeral can't be entered and left
+					continue;
+				BEAM_CAND	cand = {iNode, static_cast<PLACE>(iNum), m_arrGrayPlace[iRow + iGray]};
+				arrCand.push_back(cand);
+			}
+		}
+		int	nCands = static_cast<int>(arrCand.size());
+		nNodes += nCands;
+		PublishNodeCount(nNodes);
+		if (!nCands)	// if every path is a dead end
+			break;
+		ScoreBeamBatch(iDepth, arrNode, arrCand, arrKey);
+		arrRank.resize(nCands);
+		for (int iCand = 0; iCand < nCands; iCand++) {	// for each candidate
+			arrRank[iCand] = iCand;
+		}
+		if (nCands > nWidth) {	// if too many candidates, keep the best ones
+			// break ties by index, so that results don't depend on the library
+			std::sort(arrRank.begin(), arrRank.end(),
+				[&arrKey](int a, int b) { return arrKey[a] < arrKey[b] || (arrKey[a] == arrKey[b] && a < b); });
+			// Paths that use the same numerals and end at the same numeral have the
+			// same completions, so keep only the best of them, to keep the beam diverse.
+			mapKeptEnds.clear();
+			int	nKept = 0;
+			for (int iRank = 0; iRank < nCands && nKept < nWidth; iRank++) {	// for each candidate, best first
+				const BEAM_CAND&	cand = arrCand[arrRank[iRank]];
+				const BEAM_NODE&	node = arrNode[cand.iParent];
+				int	iUsedMask = cand.iNum >= ULONGLONG_BITS;
+				uint64_t	nNumeralMask = 1ull << (cand.iNum & (ULONGLONG_BITS - 1));
+				MEET_KEY	keyUsed = {{node.arrUsedMask[0], node.arrUsedMask[1]}};
+				keyUsed.arrMask[iUsedMask] |= nNumeralMask;
+				MEET_KEY&	keyEnds = mapKeptEnds.emplace(keyUsed, MEET_KEY()).first->second;	// value-initialized
+				if (keyEnds.arrMask[iUsedMask] & nNumeralMask)	// if a better path has the same numerals and end
+					continue;
+				keyEnds.arrMask[iUsedMask] |= nNumeralMask;
+				arrRank[nKept] = arrRank[iRank];
+				nKept++;
+			}
+			arrRank.resize(nKept);
+			bTruncated = true;
+		}
+		int	nKept = static_cast<int>(arrRank.size());
+		arrNext.resize(nKept);
+		CBeamLinkArray&	arrLink = arrHistory[iDepth];
+		arrLink.resize(nKept);
+		for (int iKept = 0; iKept < nKept; iKept++) {	// for each kept candidate
+			const BEAM_CAND&	cand = arrCand[arrRank[iKept]];
+			const BEAM_NODE&	node = arrNode[cand.iParent];
+			BEAM_NODE&	next = arrNext[iKept];
+			int	iLast = node.nLastTrans.b[cand.iPlace];
+			int	nSpan = iDepth - iLast;	// length of span closed by this transition
+			next = node;
+			next.iNum = cand.iNum;
+			next.nTrans.b[cand.iPlace]++;
+			next.nLastTrans.b[cand.iPlace] = static_cast<PLACE>(iDepth);
+			next.nMaxSpan = static_cast<PLACE>(std::max(static_cast<int>(node.nMaxSpan), nSpan));
+			if (iLast) {	// if not place's first transition, whose span is scored on wraparound
+				int	nDev = nSpan - m_nPlaces;
+				next.nDevSum += nDev * nDev;
 			}
+			next.arrUsedMask[cand.iNum >= ULONGLONG_BITS] |= 1ull << (cand.iNum & (ULONGLONG_BITS - 1));
+			arrLink[iKept].iParent = cand.iParent;
+			arrLink[iKept].iNum = cand.iNum;
 		}
-		sPrev = s;	// update previous state
+		arrNode.swap(arrNext);
 	}
-	// wrap around from last to first state
+	m_nNodes.store(nNodes, std::memory_order_relaxed);	// publish final node count
+	if (m_bHaveIncumbent && !winBest.IsBetterThan(m_winIncumbent)) {	// if caller's incumbent is at least as good
+		seqWinner = m_winIncumbent;
+		seqWinner.m_bIsProven = !bTruncated && !m_bCancel;
+		return true;
+	}
+	if (winBest.m_arrNum.empty()) {	// if no complete path; report no winner, as crawler does
+		std::fill(arrPerm.begin(), arrPerm.end(), 0);
+		seqWinner.m_nImbalance = INT_MAX;
+		seqWinner.m_nMaxTrans = INT_MAX;
+		int	arrScore[OBJ::SCORES];
+		for (int iScore = 0; iScore < OBJ::SCORES; iScore++) {	// for each of policy's scores
+			arrScore[iScore] = INT_MAX;
+		}
+		MakeWinner(arrPerm, seqWinner);
+		OBJ::StoreScore(arrScore, seqWinner);
+		seqWinner.m_bIsProven = !bTruncated && !m_bCancel;
+		return true;
+	}
+	seqWinner = winBest;
+	seqWinner.m_bIsProven = !bTruncated && !m_bCancel;
+	if (m_bVerbose || m_pLog != NULL || m_fnIncumbent)	// if anyone wants to hear about new incumbents
+		ReportIncumbent(seqWinner);
+	return true;
+}
+
+template<class OBJ> void CBalaGray::FinishBeamPath(int iDepth, CPlaceArray& arrPerm, uint64_t *parrUsedMask, CWinner& winBest, uint64_t& nNodes)
+{
+	// Crawl every completion of a beam path whose numerals are set up to the
+	// given depth, and keep the best complete cycle. Only a few levels remain,
+	// so recursion is cheap enough here.
+	int	nNumerals = GetNumeralCount();
+	int	iRow = arrPerm[iDepth - 1] << m_nGrayStrideShift;
+	for (int iGray = 0; iGray < m_nGraySuccessors; iGray++) {	// for each Gray successor
+		int	iNum = m_arrGraySuccessor[iRow + iGray];
+		int	iUsedMask = iNum >= ULONGLONG_BITS;
+		uint64_t	nNumeralMask = 1ull << (iNum & (ULONGLONG_BITS - 1));
+		if (parrUsedMask[iUsedMask] & nNumeralMask)	// if numeral already used
+			continue;
+		nNodes++;
+		arrPerm[iDepth] = static_cast<PLACE>(iNum);
+		if (iDepth < nNumerals - 1) {	// if incomplete permutation
+			parrUsedMask[iUsedMask] |= nNumeralMask;
+			FinishBeamPath<OBJ>(iDepth + 1, arrPerm, parrUsedMask, winBest, nNodes);
+			parrUsedMask[iUsedMask] &= ~nNumeralMask;
+		} else if (IsAdjacent(m_arrNum[0], m_arrNum[iNum])) {	// if complete, and wraps around Gray
+			CWinner	winCur;
+			ScorePermutation<OBJ>(arrPerm, winCur);
+			if (winCur.IsBetterThan(winBest))
+				winBest = winCur;
+		}
+	}
+}
+
+bool CBalaGray::IsBeamDegreeOK(const std::vector<MEET_KEY>& arrNeighbor, const uint64_t *parrUsedMask, int iOldEnd, int iNewEnd) const
+{
+	// Returns true if each unused neighbor of the path's old end still has at
+	// least two available neighbors: unused numerals, the new end, or the origin.
+	uint64_t	arrAvail[2] = {~parrUsedMask[0], ~parrUsedMask[1]};
+	arrAvail[0] |= 0x1;	// origin
+	arrAvail[iNewEnd >= ULONGLONG_BITS] |= 1ull << (iNewEnd & (ULONGLONG_BITS - 1));
+	int	iRow = iOldEnd << m_nGrayStrideShift;
+	for (int iGray = 0; iGray < m_nGraySuccessors; iGray++) {	// for each of old end's successors
+		int	iNum = m_arrGraySuccessor[iRow + iGray];
+		if (parrUsedMask[iNum >= ULONGLONG_BITS] & (1ull << (iNum & (ULONGLONG_BITS - 1))))	// if used, or new end
+			continue;
+		const MEET_KEY&	key = arrNeighbor[iNum];
+		uint64_t	nLo = key.arrMask[0] & arrAvail[0];
+		uint64_t	nHi = key.arrMask[1] & arrAvail[1];
+		// at least two bits are set if either word has two, or both have one
+		if (!(nLo & (nLo - 1)) && !(nHi & (nHi - 1)) && !(nLo && nHi))
+			return false;
+	}
+	return true;
+}
+
+void CBalaGray::ScoreBeamBatch(int iDepth, const CBeamNodeArray& arrNode, const CBeamCandArray& arrCand, std::vector<uint64_t>& arrKey) const
+{
+	// Score all of a depth's candidates in one pass. Each candidate's score is
+	// packed into a 64-bit key, most significant first: imbalance, maximum
+	// transition count, maximum span bound, and span deviation cost, so that
+	// candidates can be ranked by comparing keys. An open span will be at least
+	// one longer than it is now, so it bounds the final maximum span length,
+	// and its excess over the ideal mean span length bounds its deviation.
+	int	nCands = static_cast<int>(arrCand.size());
+	arrKey.resize(nCands);
+	int	nPlaces = m_nPlaces;
+#if NUMERAL_SSE2
+	// same as the scalar loop below, but processes all places at once
+	const __m128i	vOne = _mm_set1_epi8(1);
+	const __m128i	vDepth = _mm_set1_epi8(static_cast<char>(iDepth));
+	const __m128i	vOpenEnd = _mm_set1_epi8(static_cast<char>(iDepth + 1));
+	const __m128i	vIdeal = _mm_set1_epi8(static_cast<char>(nPlaces));
+	const __m128i	vUsedPlaces = _mm_andnot_si128(m_nUnusedPlaces.v, _mm_set1_epi8(-1));
+#endif
+	for (int iCand = 0; iCand < nCands; iCand++) {	// for each candidate
+		const BEAM_CAND&	cand = arrCand[iCand];
+		const BEAM_NODE&	node = arrNode[cand.iParent];
+		int	iLast = node.nLastTrans.b[cand.iPlace];
+		int	nSpan = iDepth - iLast;	// length of span closed by this transition
+		int	nMaxSpan = std::max(static_cast<int>(node.nMaxSpan), nSpan);
+		int	nDevCost = node.nDevSum;
+		if (iLast) {	// if not place's first transition, whose span is scored on wraparound
+			int	nDev = nSpan - nPlaces;
+			nDevCost += nDev * nDev;
+		}
+		int	nMin, nMax, nMaxOpen;
+#if NUMERAL_SSE2
+		__m128i	vPrev = m_arrNum[node.iNum].v;
+		__m128i	vCur = m_arrNum[cand.iNum].v;
+		__m128i	vSame = _mm_cmpeq_epi8(vCur, vPrev);	// all places but the transitioned one
+		__m128i	vTrans = _mm_add_epi8(node.nTrans.v, _mm_andnot_si128(vSame, vOne));
+		// account for wraparound to initial state, which is zero
+		vTrans = _mm_add_epi8(vTrans, _mm_andnot_si128(_mm_cmpeq_epi8(vCur, _mm_setzero_si128()), vOne));
+		__m128i	vMin = _mm_or_si128(vTrans, m_nUnusedPlaces.v);
+		__m128i	vMax = vTrans;
+		// open spans; transitioned place's span starts here, and unused places have none
+		__m128i	vLast = _mm_or_si128(_mm_and_si128(vSame, node.nLastTrans.v), _mm_andnot_si128(vSame, vDepth));
+		__m128i	vOpen = _mm_and_si128(_mm_sub_epi8(vOpenEnd, vLast), vUsedPlaces);
+		__m128i	vExcess = _mm_subs_epu8(vOpen, vIdeal);
+		__m128i	vOpenMax = vOpen;
+		vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 8));
+		vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 8));
+		vOpenMax = _mm_max_epu8(vOpenMax, _mm_srli_si128(vOpenMax, 8));
+		vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 4));
+		vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 4));
+		vOpenMax = _mm_max_epu8(vOpenMax, _mm_srli_si128(vOpenMax, 4));
+		vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 2));
+		vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 2));
+		vOpenMax = _mm_max_epu8(vOpenMax, _mm_srli_si128(vOpenMax, 2));
+		vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 1));
+		vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 1));
+		vOpenMax = _mm_max_epu8(vOpenMax, _mm_srli_si128(vOpenMax, 1));
+		nMin = _mm_cvtsi128_si32(vMin) & 0xff;
+		nMax = _mm_cvtsi128_si32(vMax) & 0xff;
+		nMaxOpen = _mm_cvtsi128_si32(vOpenMax) & 0xff;
+		// sum of squared excesses: widen to 16 bits, then multiply and add pairs to 32 bits
+		__m128i	vLo = _mm_unpacklo_epi8(vExcess, _mm_setzero_si128());
+		__m128i	vHi = _mm_unpackhi_epi8(vExcess, _mm_setzero_si128());
+		__m128i	vSum = _mm_add_epi32(_mm_madd_epi16(vLo, vLo), _mm_madd_epi16(vHi, vHi));
+		vSum = _mm_add_epi32(vSum, _mm_srli_si128(vSum, 8));
+		vSum = _mm_add_epi32(vSum, _mm_srli_si128(vSum, 4));
+		nDevCost += _mm_cvtsi128_si32(vSum);
+#else
+		const NUMERAL&	numCur = m_arrNum[cand.iNum];
+		nMin = INT_MAX;
+		nMax = 0;
+		nMaxOpen = 0;
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			bool	bTransPlace = iPlace == cand.iPlace;
+			int	nTrans = node.nTrans.b[iPlace] + bTransPlace + (numCur.b[iPlace] != 0);	// including wraparound
+			nMin = std::min(nMin, nTrans);
+			nMax = std::max(nMax, nTrans);
+			int	nOpen = iDepth + 1 - (bTransPlace ? iDepth : node.nLastTrans.b[iPlace]);
+			nMaxOpen = std::max(nMaxOpen, nOpen);
+			int	nExcess = std::max(nOpen - nPlaces, 0);
+			nDevCost += nExcess * nExcess;
+		}
+#endif
+		uint64_t	nKey = static_cast<uint64_t>(nMax - nMin) << 56;
+		nKey |= static_cast<uint64_t>(nMax) << 48;
+		nKey |= static_cast<uint64_t>(std::max(nMaxSpan, nMaxOpen)) << 40;
+		nKey |= std::min(static_cast<uint64_t>(nDevCost), static_cast<uint64_t>((1ull << 40) - 1));
+		arrKey[iCand] = nKey;
+	}
+}
+
+bool CBalaGray::Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner)
+{
+	assert(parrBase != NULL);
+	if (nPlaces < 2 || nPlaces > MAX_PLACES) {
+		printf("invalid place count\n");
+		return false;
+	}
+	ResetCrawl();
+	if (!MakeNumerals(nPlaces, parrBase))
+		return false;
+	if (!MakeGraySuccessorTable())
+		return false;
+	MakeLookaheadTable();
+	MakeLowerBound();
+//	DumpNumerals();
+//	DumpGraySuccessorTable();
+	if (m_bVerbose) {
+		DumpSet();
+		printf("nPlaces=%d\n", nPlaces);
+		printf("nValues=%d\n", GetNumeralCount());
+		printf("lower bound: imbalance=%d maxtrans=%d maxspan=%d devsum=%d\n",
+			m_lbound.nImbalance, m_lbound.nMaxTrans, m_lbound.nMaxSpan, m_lbound.nDevSum);
+	}
+	m_bLowerBoundMet = false;
+	if (m_nWindowLen) {	// if bounding transitions per window
+		if (m_nWindowLen < 1 || m_nWindowLen >= GetNumeralCount() || m_nWindowMaxTrans < 1) {
+			printf("invalid balance window\n");
+			return false;
+		}
+		if (m_nMeetBackLen || m_nBeamWidth) {
+			printf("meet-in-the-middle and beam search don't support balance window\n");
+			return false;
+		}
+	}
+	bool	bResult;
+	if (m_nMeetBackLen)	// if meet-in-the-middle crawl
+		bResult = MeetCrawl<CObjective>(seqWinner);
+	else if (m_nBeamWidth)	// if beam search
+		bResult = BeamCrawl<CObjective>(seqWinner);
+	else if (m_nDiscrepancyStep && m_parrParetoFront == NULL)	// if limited discrepancy search; Pareto front needs one pass
+		bResult = DiscrepancyCrawl<CObjective>(seqWinner);
+	else
+		bResult = Crawl<CObjective>(seqWinner);
+	// A winner that meets the lower bound is optimal, however it was found,
+	// but that doesn't make a Pareto front complete.
+	if (bResult && m_parrParetoFront == NULL && IsLowerBoundMet(seqWinner))
+		seqWinner.m_bIsProven = true;
+	return bResult;
+}
+
+void CBalaGray::MakeWinner(const CPlaceArray& arrPerm, CWinner& seqWinner) const
+{
+	// fill in winner's set description and numerals; caller is responsible for metrics
+	SET_CODE	nSetCode = 0;
+	seqWinner.m_nPlaces = m_nPlaces;
+	seqWinner.m_nBaseSum = 0;
 	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
-		if (sFirst.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
-			fDevSum += CalcDeviance(arrSpan[iPlace]);
-		} else {	// place didn't transition
-			arrFirstSpan[iPlace] += arrSpan[iPlace];	// compute wrapped span length
+		seqWinner.m_nBaseSum += m_arrBase[iPlace];
+		nSetCode = (nSetCode << 4) | m_arrBase[iPlace];	// first place is leftmost nibble
+	}
+	seqWinner.m_nSetCode = MakeVariant(nSetCode, m_nAdjacency);
+	int	nNumerals = static_cast<int>(arrPerm.size());
+	seqWinner.m_arrNum.resize(nNumerals);
+	for (int iNum = 0; iNum < nNumerals; iNum++) {
+		seqWinner.m_arrNum[iNum] = m_arrNum[arrPerm[iNum]];
+	}
+}
+
+bool CBalaGray::IsWrapWindowBalanced(int iDepth, const NUMERAL& nTransCounts) const
+{
+	// Returns true if every window that contains the wraparound transition,
+	// from the last numeral back to the origin, is within the window limit.
+	// Such windows end with the wraparound or continue into the cycle's first
+	// transitions, so they can only be checked at a leaf. The given counts are
+	// the leaf's, excluding wraparound; all shallower counts are on the stack.
+	int	nNumerals = iDepth + 1;
+	NUMERAL	nTotal = nTransCounts;	// counts of whole cycle, including wraparound
+	const NUMERAL&	numLast = m_arrNum[m_arrState[iDepth].iNum];
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		if (numLast.b[iPlace])	// if place transitions back to initial state, which is zero
+			nTotal.b[iPlace]++;
+	}
+	// for each window, identified by the depth just before its first transition
+	for (int iBefore = nNumerals - m_nWindowLen; iBefore < nNumerals; iBefore++) {
+		const NUMERAL&	nBefore = iBefore == iDepth ? nTransCounts : m_arrState[iBefore].nTrans;
+		int	nHead = iBefore + m_nWindowLen - nNumerals;	// number of transitions after wraparound
+		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+			int	nCount = nTotal.b[iPlace] - nBefore.b[iPlace];
+			if (nHead)	// if window continues into cycle's first transitions
+				nCount += m_arrState[nHead].nTrans.b[iPlace];
+			if (nCount > m_nWindowMaxTrans)
+				return false;
 		}
-		fDevSum += CalcDeviance(arrFirstSpan[iPlace]);
 	}
-	double	fVar = fDevSum / nPerms;
-	double	fStdDev = sqrt(fVar);
-	return fStdDev;
+	return true;
+}
+
+int CBalaGray::ComputeWrapBalance(const NUMERAL& nTrans, const NUMERAL& numCur, int& nMaxTrans) const
+{
+	// Same as ComputeBalanceScalar, but for the given transition counts, which
+	// needn't be on the crawler stack, and numeral, which is assumed to wrap
+	// around to the initial state.
+	int	nMin = INT_MAX;
+	int	nMax = 0;
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		int	n = nTrans.b[iPlace] + (numCur.b[iPlace] != 0);	// account for wraparound
+		if (n < nMin)
+			nMin = n;
+		if (n > nMax)
+			nMax = n;
+	}
+	nMaxTrans = nMax;
+	return nMax - nMin;
+}
+
+size_t CBalaGray::MEET_KEY_HASH::operator()(const MEET_KEY& key) const
+{
+	uint64_t	nHash = key.arrMask[0] * 0x9e3779b97f4a7c15ull ^ key.arrMask[1];	// golden ratio multiplier
+	nHash ^= nHash >> 31;	// mix high bits into low bits, which select buckets
+	nHash *= 0xbf58476d1ce4e5b9ull;
+	return static_cast<size_t>(nHash ^ (nHash >> 29));
 }
 
 bool CBalaGray::CalcFromCode(SET_CODE nSetCode, CWinner& seqWinner)
 {
 	seqWinner.m_nSetCode = nSetCode;
+	if (!SelectAdjacency(nSetCode))
+		return false;
 	NUMERAL	arrBase;
 	int	nPlaces = GetBases(nSetCode, arrBase);
 	return Calc(nPlaces, arrBase.b, seqWinner);
 }
 
-void TestCalc()
-{
-	CBalaGray::SET_CODE nSetCode = 
-//
-// All cases want PRUNE_IMBALANCE = 3 unless specified otherwise below.
-// Pruning greatly reduces runtime, but the results may not be optimal.
-// Proven means exited normally with pruning disabled (DO_PRUNING = 0).
-// Only ONE of the following set codes may be uncommented at a time.
-//
-//	0x22	// proven
-//	0x23	// proven
-//	0x24	// proven
-//	0x33	// proven
-//	0x25	// proven
-//	0x34	// proven
-//	0x26	// proven
-//	0x35	// proven
-//	0x44	// proven
-//	0x27	// proven
-//	0x36	// proven
-//	0x45	// proven
-//	0x28	// proven
-//	0x37
-//	0x46
-//	0x55
-//	0x29	// proven
-//	0x38
-//	0x47
-//	0x56
-//	0x2A	// proven
-//	0x39
-//	0x48
-//	0x57
-//	0x66
-//	0x222	// proven
-//	0x223	// proven
-//	0x224	// proven
-//	0x233	// proven
-//	0x225	// proven
-	0x234	// proven
-//	0x333
-//	0x226	// proven
-//	0x235
-//	0x244
-//	0x334
-//	0x227
-//	0x236
-//	0x245
-//	0x335
-//	0x344
-//	0x228
-//	0x237
-//	0x246
-//	0x255
-//	0x336
-//	0x345
-//	0x444
-//	0x2222	// proven
-//	0x2223	// proven
-//	0x2224
-//	0x2233
-//	0x2225
-//	0x2234
-//	0x2333
-//	0x2226
-//	0x2235	// slow
-//	0x2244
-//	0x2334	// slow; wants PRUNE_IMBALANCE = 4
-//	0x3333	// slow
-//
-// *** following cases require MORE_PLACES to be non-zero ***
-//
-//	0x22222
-//	0x22223	// wants PRUNE_IMBALANCE = 2
-//	0x22224	// wants PRUNE_IMBALANCE = 2
-//	0x22233	// wants PRUNE_IMBALANCE = 4
-//	0x222222
-//
-	;	// if a set code isn't uncommented above, compiler error here
-	CBalaGray	bg;
-	CBalaGray::CWinner	seqWinner;
-	bg.CalcFromCode(nSetCode, seqWinner);
-	printf("done\npress Enter to continue\n");
-	fgetc(stdin);
+bool CBalaGray::SelectAdjacency(SET_CODE nSetCode)
+{
+	// select adjacency mode specified by set code's variant bits
+	int	nAdjacency = GetAdjacency(nSetCode);
+	if (nAdjacency >= ADJACENCY_MODES) {
+		printf("invalid adjacency mode\n");
+		return false;
+	}
+	if (nAdjacency == ADJ_CUSTOM && m_arrCustomAdjacency.size() != MAX_PLACES * ADJACENCY_STRIDE) {
+		printf("custom adjacency not specified\n");
+		return false;
+	}
+	m_nAdjacency = nAdjacency;
+	return true;
+}
+
+int CBalaGray::GetAdjacency(SET_CODE nSetCode)
+{
+	// returns adjacency mode specified by set code's variant byte, if any
+	int	nVariant = static_cast<int>(nSetCode >> SET_VARIANT_SHIFT);
+	if ((nVariant & 0xf0) != SET_VARIANT_MARK)	// if not a variant
+		return ADJ_ANY;
+	return nVariant & 0xf;
+}
+
+CBalaGray::SET_CODE CBalaGray::MakeVariant(SET_CODE nSetCode, int nAdjacency)
+{
+	// Replace set code's adjacency mode. Unrestricted sets have no variant
+	// byte, and a restricted one needs room for it below its bases; if it
+	// has too many places, returns zero, which is an invalid set code.
+	if (GetAdjacency(nSetCode) != ADJ_ANY)	// if already a variant
+		nSetCode &= (1ull << SET_VARIANT_SHIFT) - 1;	// remove variant byte
+	if (nAdjacency == ADJ_ANY)	// if unrestricted
+		return nSetCode;
+	if (nSetCode >> SET_VARIANT_SHIFT)	// if bases reach variant byte
+		return 0;
+	return nSetCode | (static_cast<SET_CODE>(SET_VARIANT_MARK | nAdjacency) << SET_VARIANT_SHIFT);
+}
+
+bool CBalaGray::ParseAdjacency(const char *pszGraph, CAdjacencyArray& arrAdjacency)
+{
+	// Parse a custom adjacency graph. Places are separated by slashes, in the
+	// same order as the set code's nibbles; each place is a comma-separated
+	// list of edges, and each edge is a pair of hex digits, which are values
+	// that may step to each other. Edges are undirected. A place that's empty
+	// or missing is unrestricted. For example, "01,12,20/01" makes the first
+	// place of a 0x32 set a triangle and leaves its second place binary.
+	assert(pszGraph != NULL);
+	arrAdjacency.assign(MAX_PLACES * ADJACENCY_STRIDE, 0);
+	int	iPlace = 0;
+	const char	*pszPos = pszGraph;
+	while (1) {
+		if (iPlace >= MAX_PLACES)	// if too many places
+			return false;
+		uint16_t	*pMask = &arrAdjacency[iPlace * ADJACENCY_STRIDE];
+		bool	bEmpty = true;
+		while (*pszPos && *pszPos != '/') {	// until end of place
+			int	nVal1, nVal2;
+			if (sscanf(pszPos, "%1x%1x", &nVal1, &nVal2) != 2 || nVal1 == nVal2)	// if edge isn't two distinct values
+				return false;
+			pMask[nVal1] |= 1 << nVal2;
+			pMask[nVal2] |= 1 << nVal1;
+			bEmpty = false;
+			pszPos += 2;
+			if (*pszPos == ',')	// if another edge follows
+				pszPos++;
+			else if (*pszPos && *pszPos != '/')	// if junk follows edge
+				return false;
+		}
+		if (bEmpty) {	// if place is unrestricted
+			for (int iVal = 0; iVal < ADJACENCY_STRIDE; iVal++) {	// for each value
+				pMask[iVal] = static_cast<uint16_t>(~(1 << iVal));	// adjacent to every other value
+			}
+		}
+		iPlace++;
+		if (!*pszPos)	// if end of graph
+			break;
+		pszPos++;	// skip slash
+	}
+	for (; iPlace < MAX_PLACES; iPlace++) {	// for each missing place
+		for (int iVal = 0; iVal < ADJACENCY_STRIDE; iVal++) {	// for each value
+			arrAdjacency[iPlace * ADJACENCY_STRIDE + iVal] = static_cast<uint16_t>(~(1 << iVal));
+		}
+	}
+	return true;
+}
+
+void CBalaGray::SetIncumbent(const CWinner& winner)
+{
+	m_winIncumbent = winner;
+	m_bHaveIncumbent = true;
+}
+
+void CBalaGray::ClearIncumbent()
+{
+	m_winIncumbent = CWinner();
+	m_bHaveIncumbent = false;
+}
+
+void CBalaGray::SetStateSampler(CPrefixArray *parrSample, int nMaxSamples)
+{
+	m_parrStateSample = parrSample;
+	m_nMaxStateSamples = nMaxSamples;
+}
+
+void CBalaGray::SampleState(int iDepth)
+{
+	// Store the committed part of the crawl stack, i.e. the numerals of the
+	// branch being extended, excluding the candidate at the current depth.
+	// Called only when node count is published, so sampling is periodic and
+	// costs nothing in the crawl's inner loop.
+	m_parrStateSample->push_back(CPlaceArray(iDepth));
+	CPlaceArray&	arrPrefix = m_parrStateSample->back();
+	for (int iNum = 0; iNum < iDepth; iNum++) {	// for each committed numeral
+		arrPrefix[iNum] = m_arrState[iNum].iNum;
+	}
+	if (static_cast<int>(m_parrStateSample->size()) >= m_nMaxStateSamples)	// if enough samples
+		m_bCancel = true;	// stop crawl
+}
+
+template<class OBJ> bool CBalaGray::ApplyIncumbent(CPlaceArray& arrBestPerm)
+{
+	// Convert incumbent's numerals to numeral indices, verifying that they
+	// belong to the current set and form a Gray cycle that starts at zero.
+	// Its metrics are recomputed, as pruning and proofs rely on them, and a
+	// seed read from a file could claim anything.
+	const CWinner&	win = m_winIncumbent;
+	int	nNumerals = GetNumeralCount();
+	if (win.m_nPlaces != m_nPlaces || static_cast<int>(win.m_arrNum.size()) != nNumerals) {
+		printf("incumbent doesn't match set\n");
+		return false;
+	}
+	std::vector<bool>	arrUsed(nNumerals);
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each of incumbent's numerals
+		const NUMERAL&	num = win.m_arrNum[iNum];
+		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+			if (num.b[iPlace] >= m_arrBase[iPlace]) {	// if place out of range
+				printf("incumbent doesn't match set\n");
+				return false;
+			}
+		}
+		int	iPacked = Pack(num);
+		if (arrUsed[iPacked] || (!iNum && iPacked)) {	// if duplicate numeral, or doesn't start at zero
+			printf("incumbent isn't a valid permutation\n");
+			return false;
+		}
+		if (!IsAdjacent(num, win.m_arrNum[(iNum + 1) % nNumerals])) {	// if successor isn't Gray, including wraparound
+			printf("incumbent isn't a Gray cycle\n");
+			return false;
+		}
+		arrUsed[iPacked] = true;
+		arrBestPerm[iNum] = static_cast<PLACE>(iPacked);
+	}
+	ScorePermutation<OBJ>(arrBestPerm, m_winIncumbent);
+	return true;
+}
+
+bool CBalaGray::ApplyPrefix(int& iDepth, uint64_t *parrUsedMask)
+{
+	// Push caller's prefix onto crawler stack, so that only the branches
+	// below the prefix are crawled. The prefix must start where the crawl
+	// would normally start, and its numerals must be unique and Gray.
+	int	nPrefixLen = static_cast<int>(m_arrPrefix.size());
+	int	nNumerals = GetNumeralCount();
+	if (nPrefixLen < iDepth || nPrefixLen >= nNumerals) {
+		printf("invalid prefix length\n");
+		return false;
+	}
+	for (int iNum = 0; iNum < iDepth; iNum++) {	// for each level that's normally constant
+		if (m_arrPrefix[iNum] != m_arrState[iNum].iNum) {	// if prefix differs from usual start
+			printf("invalid prefix start\n");
+			return false;
+		}
+	}
+	for (int iPrefix = iDepth; iPrefix < nPrefixLen; iPrefix++) {	// for each of prefix's remaining levels
+		int	iNum = m_arrPrefix[iPrefix];
+		if (iNum >= nNumerals || !IsAdjacent(m_arrNum[m_arrState[iPrefix - 1].iNum], m_arrNum[iNum])) {
+			printf("invalid prefix numeral\n");
+			return false;
+		}
+		int	iUsedMask = iNum >= ULONGLONG_BITS;	// index selects one of two 64-bit masks
+		uint64_t	nNumeralMask = 1ull << (iNum & (ULONGLONG_BITS - 1));
+		if (parrUsedMask[iUsedMask] & nNumeralMask) {	// if numeral already used
+			printf("invalid prefix numeral\n");
+			return false;
+		}
+		parrUsedMask[iUsedMask] |= nNumeralMask;	// mark this numeral as used
+		m_arrState[iPrefix].iNum = static_cast<PLACE>(iNum);
+		int	nMaxTrans;
+		NUMERAL	nTransCounts;
+		ComputeBalance(iPrefix, nMaxTrans, nTransCounts);
+		if (m_nWindowLen && !IsWindowBalanced(iPrefix, nTransCounts, GetTransPlace(iPrefix))) {
+			printf("prefix exceeds balance window\n");
+			return false;
+		}
+		m_arrState[iPrefix].nTrans = nTransCounts;
+	}
+	iDepth = nPrefixLen;	// crawl starts below prefix
+	m_arrState[iDepth].iGray = 0;
+	m_arrState[iDepth].iNum = 0;
+	return true;
+}
+
+bool CBalaGray::IsParetoDominated(const int *parrScore, int nScores) const
+{
+	// Returns true if any member of the Pareto front is at least as good as the
+	// given scores in every respect. Ties count as dominated, so the front keeps
+	// only the first permutation found for each vector of scores.
+	int	nPoints = static_cast<int>(m_arrPareto.size());
+	for (int iPoint = 0; iPoint < nPoints; iPoint++) {	// for each member of front
+		const int	*pPtScore = m_arrPareto[iPoint].arrScore;
+		int	iScore;
+		for (iScore = 0; iScore < nScores; iScore++) {	// for each score
+			if (pPtScore[iScore] > parrScore[iScore])	// if member is worse
+				break;
+		}
+		if (iScore == nScores)	// if member is at least as good in every respect
+			return true;
+	}
+	return false;
+}
+
+bool CBalaGray::UpdateParetoFront(const int *parrScore, int nScores, const CPlaceArray *parrPerm)
+{
+	// Add the given permutation to the Pareto front, unless the front dominates
+	// it, and remove any members it dominates. If permutation isn't specified,
+	// it's read from the crawler stack. Returns true if the front changed.
+	if (IsParetoDominated(parrScore, nScores))
+		return false;
+	int	nPoints = static_cast<int>(m_arrPareto.size());
+	for (int iPoint = nPoints - 1; iPoint >= 0; iPoint--) {	// for each member of front, in reverse order
+		const int	*pPtScore = m_arrPareto[iPoint].arrScore;
+		int	iScore;
+		for (iScore = 0; iScore < nScores; iScore++) {	// for each score
+			if (parrScore[iScore] > pPtScore[iScore])	// if new point is worse
+				break;
+		}
+		if (iScore == nScores)	// if new point dominates member
+			m_arrPareto.erase(m_arrPareto.begin() + iPoint);
+	}
+	m_arrPareto.push_back(PARETO_POINT());
+	PARETO_POINT&	pt = m_arrPareto.back();
+	memcpy(pt.arrScore, parrScore, nScores * sizeof(int));
+	if (parrPerm != NULL) {	// if permutation specified
+		pt.arrPerm = *parrPerm;
+	} else {	// copy permutation from stack
+		int	nNumerals = GetNumeralCount();
+		pt.arrPerm.resize(nNumerals);
+		for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
+			pt.arrPerm[iNum] = m_arrState[iNum].iNum;
+		}
+	}
+	return true;
+}
+
+template<class OBJ> void CBalaGray::MakeParetoFront(bool bIsProven)
+{
+	// convert Pareto front to winners, sorted from best to worst using usual priorities
+	CWinnerArray&	arrFront = *m_parrParetoFront;
+	int	nPoints = static_cast<int>(m_arrPareto.size());
+	arrFront.resize(nPoints);
+	for (int iPoint = 0; iPoint < nPoints; iPoint++) {	// for each member of front
+		const PARETO_POINT&	pt = m_arrPareto[iPoint];
+		CWinner&	win = arrFront[iPoint];
+		ScorePermutation<OBJ>(pt.arrPerm, win);	// front kept only keys, so rescore to recover reported scores
+		win.m_bIsProven = bIsProven;
+	}
+	std::sort(arrFront.begin(), arrFront.end(),
+		[](const CWinner& a, const CWinner& b) { return a.IsBetterThan(b); });
+}
+
+bool CBalaGray::EnumerateFrontier(SET_CODE nSetCode, int nPrefixLen, CPrefixArray& arrPrefix)
+{
+	// Enumerate all prefixes of the given length that survive the crawler's
+	// usual pruning. Crawling each prefix separately covers the same search
+	// as crawling the whole set, so the prefixes can be distributed as jobs.
+	arrPrefix.clear();
+	m_nFrontierLen = nPrefixLen;
+	m_parrFrontier = &arrPrefix;
+	CWinner	winner;
+	bool	bResult = CalcFromCode(nSetCode, winner);
+	m_parrFrontier = NULL;
+	m_nFrontierLen = 0;
+	return bResult && !m_bCancel;
+}
+
+template<class OBJ> void CBalaGray::ScorePermutation(const CPlaceArray& arrPerm, CWinner& winner)
+{
+	// Compute the metrics of a complete permutation the same way the crawler
+	// does, including the wraparound from the last numeral to the first.
+	OBJ	obj;
+	int	nNumerals = static_cast<int>(arrPerm.size());
+	obj.Init(m_nPlaces, nNumerals);
+	int	arrTrans[MAX_PLACES] = {0};
+	int	iPlace = 0;
+	for (int iDepth = 1; iDepth < nNumerals; iDepth++) {	// for each numeral after first
+		const NUMERAL&	numPrev = m_arrNum[arrPerm[iDepth - 1]];
+		const NUMERAL&	numCur = m_arrNum[arrPerm[iDepth]];
+		iPlace = 0;
+		while (iPlace < m_nPlaces - 1 && numCur.b[iPlace] == numPrev.b[iPlace])
+			iPlace++;
+		arrTrans[iPlace]++;
+		if (iDepth < nNumerals - 1)	// if not last numeral, which is scored as a leaf below
+			obj.Push(iDepth, iPlace);
+	}
+	const NUMERAL&	numLast = m_arrNum[arrPerm[nNumerals - 1]];
+	for (int iPl = 0; iPl < m_nPlaces; iPl++) {	// for each place
+		if (numLast.b[iPl])	// if place transitions on wraparound; first numeral is zero
+			arrTrans[iPl]++;
+	}
+	int	nMin = *std::min_element(arrTrans, arrTrans + m_nPlaces);
+	int	nMax = *std::max_element(arrTrans, arrTrans + m_nPlaces);
+	winner.m_nImbalance = nMax - nMin;
+	winner.m_nMaxTrans = nMax;
+	int	arrScore[OBJ::SCORES];
+	obj.GetLeafScore(nNumerals - 1, iPlace, numLast, arrScore);
+	MakeWinner(arrPerm, winner);
+	OBJ::StoreScore(arrScore, winner);
+}
+
+bool CBalaGray::Score(CWinner& winner)
+{
+	// Fill in the metrics of a winner whose set code and numerals are already
+	// set, e.g. a candidate built outside the crawler. The numerals must form a
+	// Gray cycle of the set; they're rotated so that the cycle starts at zero,
+	// as the crawler's do. Returns false if the numerals aren't a Gray cycle.
+	NUMERAL	arrBase;
+	int	nPlaces = GetBases(winner.m_nSetCode, arrBase);
+	if (nPlaces < 2) {
+		printf("invalid place count\n");
+		return false;
+	}
+	if (!SelectAdjacency(winner.m_nSetCode))
+		return false;
+	ResetCrawl();
+	if (!MakeNumerals(nPlaces, arrBase.b))
+		return false;
+	int	nNumerals = GetNumeralCount();
+	if (static_cast<int>(winner.m_arrNum.size()) != nNumerals)
+		return false;
+	CPlaceArray	arrPerm(nNumerals);
+	std::vector<bool>	arrUsed(nNumerals);
+	int	iStart = 0;
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each of winner's numerals
+		const NUMERAL&	num = winner.m_arrNum[iNum];
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			if (num.b[iPlace] >= m_arrBase[iPlace])	// if place out of range
+				return false;
+		}
+		if (!IsAdjacent(num, winner.m_arrNum[(iNum + 1) % nNumerals]))	// if successor isn't Gray, including wraparound
+			return false;
+		int	iPacked = Pack(num);
+		if (arrUsed[iPacked])	// if duplicate numeral
+			return false;
+		arrUsed[iPacked] = true;
+		if (!iPacked)	// if zero numeral
+			iStart = iNum;	// cycle starts here
+	}
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral, starting from zero
+		arrPerm[iNum] = static_cast<PLACE>(Pack(winner.m_arrNum[(iStart + iNum) % nNumerals]));
+	}
+	winner.m_bIsProven = false;
+	ScorePermutation<CObjective>(arrPerm, winner);
+	return true;
+}
+
+bool CBalaGray::CWinner::IsBetterThan(const CWinner& winner) const
+{
+	// Uses same priorities as crawler. An empty winner is worse than any other.
+	if (m_arrNum.empty())
+		return false;
+	if (winner.m_arrNum.empty())
+		return true;
+	if (m_nImbalance != winner.m_nImbalance)
+		return m_nImbalance < winner.m_nImbalance;
+	if (m_nMaxTrans != winner.m_nMaxTrans)
+		return m_nMaxTrans < winner.m_nMaxTrans;
+	int	arrScore[CObjective::SCORES];
+	int	arrOtherScore[CObjective::SCORES];
+	CObjective::LoadScore(*this, arrScore);
+	CObjective::LoadScore(winner, arrOtherScore);
+	return IsScoreBetter<CObjective>(arrScore, arrOtherScore);
+}
+
+int CBalaGray::CWinner::GetDevSum() const
+{
+	// Recover exact sum of squared deviations from standard deviation, so that
+	// comparisons are exact even if standard deviation was rounded in a file.
+	// A no-cycle winner's standard deviation is DBL_MAX, but a file rounds
+	// it, so it's recognized by its imbalance, or by a sum that won't fit.
+	if (m_nImbalance == INT_MAX || m_arrNum.empty())	// if no winner
+		return INT_MAX;
+	double	fDevSum = floor(m_fStdDev * m_fStdDev * m_arrNum.size() + 0.5);
+	if (!(fDevSum < INT_MAX))	// if too big to be a real winner's, or not a number
+		return INT_MAX;
+	return static_cast<int>(fDevSum);
+}
+
+void CBalaGray::CWinner::SetDevSum(int nDevSum)
+{
+	// convert sum of squared deviations to standard deviation; mean span length is place count
+	if (nDevSum == INT_MAX || m_arrNum.empty())	// if no winner
+		m_fStdDev = DBL_MAX;
+	else
+		m_fStdDev = sqrt(static_cast<double>(nDevSum) / m_arrNum.size());
+}
+
+int CBalaGray::CWinner::GetObjective(int iObjective) const
+{
+	switch (iObjective) {
+	case OBJ_IMBALANCE:
+		return m_nImbalance;
+	case OBJ_MAXTRANS:
+		return m_nMaxTrans;
+	case OBJ_MAXSPAN:
+		return m_nMaxSpan;
+	case OBJ_STDDEV:
+		return GetDevSum();
+	}
+	return 0;
 }
 
 CBalaGray::CWinner::CWinner()
@@ -826,30 +2295,29 @@ CBalaGray::CWinner::CWinner()
 	m_nImbalance = 0;
 	m_nMaxTrans = 0;
 	m_nMaxSpan = 0;
-#if OPT_STD_DEV
 	m_fStdDev = 0;
-#endif
 	m_bIsProven = false;
 }
 
-std::ofstream& operator<<(std::ofstream& ofs, const CBalaGray::CWinner& winner)
+std::ostream& operator<<(std::ostream& os, const CBalaGray::CWinner& winner)
 {
-	ofs << std::hex << winner.m_nSetCode << std::dec;
-	ofs << ' ' << winner.m_nPlaces;
-	ofs << ' ' << winner.m_nBaseSum;
-	ofs << ' ' << winner.m_nImbalance;
-	ofs << ' ' << winner.m_nMaxTrans;
-	ofs << ' ' << winner.m_nMaxSpan;
-#if OPT_STD_DEV
-	ofs << ' ' << winner.m_fStdDev;
-#endif
-	ofs << ' ' << winner.m_bIsProven;
+	os << std::hex << winner.m_nSetCode << std::dec;
+	os << ' ' << winner.m_nPlaces;
+	os << ' ' << winner.m_nBaseSum;
+	os << ' ' << winner.m_nImbalance;
+	os << ' ' << winner.m_nMaxTrans;
+	os << ' ' << winner.m_nMaxSpan;
+	os << ' ' << winner.m_fStdDev;
+	os << ' ' << winner.m_bIsProven;
 	int	nNums = static_cast<int>(winner.m_arrNum.size());
-	ofs << ' ' << nNums << std::hex;
+	int	nQuads = (winner.m_nPlaces + 7) / 8;	// sets of up to eight places need only one word per numeral
+	os << ' ' << nNums << std::hex;
 	for (int i = 0; i < nNums; i++) {
-		ofs << ' ' << winner.m_arrNum[i].dw;
+		for (int iQuad = 0; iQuad < nQuads; iQuad++) {
+			os << ' ' << winner.m_arrNum[i].GetQuad(iQuad);
+		}
 	}
-	return ofs;
+	return os;
 }
 
 std::ifstream& operator>>(std::ifstream& ifs, CBalaGray::CWinner& winner)
@@ -860,257 +2328,98 @@ std::ifstream& operator>>(std::ifstream& ifs, CBalaGray::CWinner& winner)
 	ifs >> winner.m_nImbalance;
 	ifs >> winner.m_nMaxTrans;
 	ifs >> winner.m_nMaxSpan;
-#if OPT_STD_DEV
 	ifs >> winner.m_fStdDev;
-#endif
 	ifs >> winner.m_bIsProven;
 	int	nNums;
 	ifs >> nNums >> std::hex;
+	int	nQuads = (winner.m_nPlaces + 7) / 8;
+	if (nQuads > CBalaGray::NUMERAL_QUADS) {	// if too many places for this build
+		ifs.setstate(std::ios_base::failbit);
+		return ifs;
+	}
 	winner.m_arrNum.resize(nNums);
-	for (int i = 0; i < winner.m_arrNum.size(); i++) {
-		ifs >> winner.m_arrNum[i].dw;
+	for (int i = 0; i < nNums; i++) {
+		winner.m_arrNum[i].Zero();
+		for (int iQuad = 0; iQuad < nQuads; iQuad++) {
+			uint64_t	nQuad;
+			ifs >> nQuad;
+			winner.m_arrNum[i].SetQuad(iQuad, nQuad);
+		}
 	}
 	return ifs;
 }
 
-std::ofstream& operator<<(std::ofstream& ofs, const CBalaGray::CWinnerArray& arrWin)
+std::ostream& operator<<(std::ostream& os, const CBalaGray::CWinnerArray& arrWin)
 {
-	int	nElemSize = sizeof(CBalaGray::CWinner);
 	int	nElems = static_cast<int>(arrWin.size());
-	ofs << nElemSize;
-	ofs << ' ' << nElems << std::endl;
+	os << WINNER_FILE_VERSION;
+	os << ' ' << nElems << std::endl;
 	for (int iElem = 0; iElem < nElems; iElem++) {
-		ofs << arrWin[iElem] << std::endl;
+		os << arrWin[iElem] << std::endl;
 	}
-	return ofs;
+	return os;
 }
 
 std::ifstream& operator>>(std::ifstream& ifs, CBalaGray::CWinnerArray& arrWin)
 {
-	int	nElemSize;
+	int	nVersion;
 	int	nElems;
-	ifs >> nElemSize;
+	ifs >> nVersion;
 	ifs >> nElems;
-	if (nElemSize == sizeof(CBalaGray::CWinner)) {	// sanity check
-		arrWin.resize(nElems);
-		for (int iElem = 0; iElem < nElems; iElem++) {
-			ifs >> arrWin[iElem];
-		}
+	if (ifs.fail() || nElems < 0
+	|| (nVersion != WINNER_FILE_VERSION && nVersion != WINNER_LEGACY_SIZE)) {	// if unknown format
+		ifs.setstate(std::ios_base::failbit);	// so caller knows nothing was read
+		return ifs;
+	}
+	arrWin.resize(nElems);
+	for (int iElem = 0; iElem < nElems; iElem++) {
+		ifs >> arrWin[iElem];
 	}
 	return ifs;
 }
 
-void CBalaGray::CWinnerArray::Read(const char *pszPath)
+bool CBalaGray::CWinnerArray::Read(const char *pszPath)
 {
 	std::ifstream	fIn(pszPath, std::ios_base::binary);
-	assert(fIn.good());
+	if (!fIn.good())
+		return false;
 	fIn >> *this;
+	return !fIn.fail();
 }
 
-void CBalaGray::CWinnerArray::Write(const char *pszPath) const
-{
-	std::ofstream	fOut(pszPath, std::ios_base::trunc | std::ios_base::binary);
-	assert(fOut.good());
-	fOut << *this;
-}
-
-CBalaGray::CWinnerArray	arrSeq;
-
-void ThreadFunc(CBalaGray *pBG, CBalaGray::SET_CODE nSetCode, CWorkerSync *psync)
-{
-	CBalaGray::CWinner	seqWinner;
-	pBG->CalcFromCode(nSetCode, seqWinner);
-	arrSeq.push_back(seqWinner);
-	psync->NotifyDone();
-}
-
-void CalcWithTimeout(CBalaGray::SET_CODE nSetCode)
-{
-	int nTimeoutMillis = 30 * 1000;	// default maximum runtime
-	char	szCode[16];
-	sprintf(szCode, "%X", nSetCode);
-	std::string	sOutPath;
-	sOutPath += "BalaGray ";
-	sOutPath += szCode;
-	sOutPath += ".txt";
-	CBalaGray	bg(sOutPath.c_str());
-	switch (nSetCode) {
-	case 0x37:
-	case 0x46:
-	case 0x234:
-	case 0x22222:
-		// the above sets benefit from longer runtimes
-		nTimeoutMillis = std::max(nTimeoutMillis, 120 * 1000);
-		break;
-	case 0x2224:
-		nTimeoutMillis = std::max(nTimeoutMillis, 60 * 1000);
-		break;
-	case 0x2225:
-		nTimeoutMillis = std::max(nTimeoutMillis, 180 * 1000);
-		break;
-	case 0x336:
-	case 0x2334:
-	case 0x22233:
-		bg.SetPruneImbalance(4);
-		break;
-	case 0x22224:
-	case 0x22223:
-		bg.SetPruneImbalance(2);
-		break;
-	}
-#if OPT_STD_DEV
-	nTimeoutMillis *= 2;	// standard deviation needs longer timeout
-#endif
-	CWorkerSync	sync;
-	std::thread thrWorker(ThreadFunc, &bg, nSetCode, &sync);
-	bool	bIsDone = sync.WaitForDone(nTimeoutMillis);
-	if (bIsDone) {	// if worker finished normally
-		printf("done\n");
-	} else {	// timeout waiting for worker to finish
-		printf("timeout\n");
-	}
-	bg.Cancel();	// request worker to exit
-    thrWorker.join();
-}
-
-CBalaGray::SET_CODE arrSetCode[] = {
-#define INTERVAL_SET(s) 0x##s,
-#include "IntervalSetsList.h"
-};
-
-void MakeHTMLTable(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
-{
-	static const char	arrBoolChar[2] = {'N', 'Y'};
-	assert(pszPath != NULL);
-	std::ofstream	fOut(pszPath, std::ios_base::trunc);
-	if (!fOut.good()) {
-		printf("can't create file '%s'\n", pszPath);
-		return;
-	}
-	int	nSeqs = static_cast<int>(arrSeq.size());
-	fOut << "<!DOCTYPE html>\n<html>\n<head>\n";
-	fOut << "<title>Balanced Gray Interval Sets</title>\n";
-	fOut << "<meta name=\"author\" content=\"Chris Korda\">\n"
-		"<meta name=\"description\" content=\"Interval sets derived from balanced Gray code.\">\n"
-		"<link href=\"../style.css\" rel=stylesheet title=default type=text/css>\n"
-		"</head>\n<body style=\"text-size-adjust: none; -webkit-text-size-adjust: none;\">\n"	// need this for mobile, else text size varies
-		"<table border=1 cellpadding=2 cellspacing=0>\n"
-#if OPT_STD_DEV
-		"<tr><th>Name</th><th>Size</th><th>Range</th><th>States</th><th>Imbalance</th><th>MaxSpan</th><th>StdDev</th><th>Proven</th><th>Set</th></tr>\n";
-#else
-		"<tr><th>Name</th><th>Size</th><th>Range</th><th>States</th><th>Imbalance</th><th>MaxSpan</th><th>Proven</th><th>Set</th></tr>\n";
-#endif
-	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
-		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
-		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
-		fOut << "<tr><td>" << std::hex << std::uppercase << seq.m_nSetCode << std::dec
-			<< "</td><td>" << seq.m_nPlaces
-			<< "</td><td>" << seq.m_nBaseSum
-			<< "</td><td>" << nNumerals
-			<< "</td><td>" << seq.m_nImbalance
-			<< "</td><td>" << seq.m_nMaxSpan
-#if OPT_STD_DEV
-			<< "</td><td>" << std::setprecision(3) << seq.m_fStdDev
-#endif
-			<< "</td><td>" << arrBoolChar[seq.m_bIsProven] << "</td><td>\n";
-		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
-			if (iPlace)
-				fOut << "\n<br>";
-			for (int iNum = 0; iNum < nNumerals; iNum++) {
-				if (iNum)
-					fOut << "&nbsp;";
-				fOut << int(seq.m_arrNum[iNum].b[iPlace]);
-			}
-		}
-		fOut << "\n</td></tr>\n";
-	}
-	fOut << "</table>\n</body>\n</html>\n";
-}
-
-void MakeCSVTable(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
+int CBalaGray::CWinnerArray::FindBest(const int *parrObjective, int nObjectives) const
 {
-	assert(pszPath != NULL);
-	std::ofstream	fOut(pszPath, std::ios_base::trunc);
-	if (!fOut.good()) {
-		printf("can't create file '%s'\n", pszPath);
-		return;
-	}
-	int	nSeqs = static_cast<int>(arrSeq.size());
-#if OPT_STD_DEV
-	fOut << "Name,Digit,Digits,Range,States,Imbalance,MaxSpan,StdDev,Proven\n";
-#else
-	fOut << "Name,Digit,Digits,Range,States,Imbalance,MaxSpan,Proven\n";
-#endif
-	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
-		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
-		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
-		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
-			fOut << '[' << std::hex << std::uppercase << seq.m_nSetCode << std::dec << ']'
-				<< ',' << iPlace
-				<< ',' << seq.m_nPlaces
-				<< ',' << seq.m_nBaseSum
-				<< ',' << nNumerals
-				<< ',' << seq.m_nImbalance
-				<< ',' << seq.m_nMaxSpan
-#if OPT_STD_DEV
-				<< ',' << seq.m_fStdDev
-#endif
-				<< ',' << seq.m_bIsProven;
-			for (int iNum = 0; iNum < nNumerals; iNum++) {
-				fOut << ',' << int(seq.m_arrNum[iNum].b[iPlace]);
-			}
-			fOut << '\n';
+	// Returns index of best winner according to the given objectives, which are
+	// in descending order of priority, or -1 if array is empty. Applied to a
+	// Pareto front, any priority order selects a winner with the same metrics
+	// as a crawl using that order would have found, without crawling again.
+	assert(parrObjective != NULL);
+	int	iBest = -1;
+	int	nWins = static_cast<int>(size());
+	for (int iWin = 0; iWin < nWins; iWin++) {	// for each winner
+		if (iBest < 0) {	// if first winner
+			iBest = iWin;
+			continue;
 		}
-	}
-}
-
-void MakePolymeterImportTracksCSV(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
-{
-	assert(pszPath != NULL);
-	std::ofstream	fOut(pszPath, std::ios_base::trunc);
-	if (!fOut.good()) {
-		printf("can't create file '%s'\n", pszPath);
-		return;
-	}
-	int	nSeqs = static_cast<int>(arrSeq.size());
-	fOut << "Name,Type,Steps\n";
-	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
-		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
-		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
-		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
-			fOut << "\"BG [" << std::hex << std::uppercase << seq.m_nSetCode << std::dec << "] " << iPlace + 1 << "\",7,\"";
-			for (int iNum = 0; iNum < nNumerals; iNum++) {
-				if (iNum)
-					fOut << ',';
-				fOut << int(seq.m_arrNum[iNum].b[iPlace]) + 64;	// convert to signed step value
+		for (int iObj = 0; iObj < nObjectives; iObj++) {	// for each objective, in priority order
+			int	nVal = at(iWin).GetObjective(parrObjective[iObj]);
+			int	nBestVal = at(iBest).GetObjective(parrObjective[iObj]);
+			if (nVal != nBestVal) {	// if objectives differ
+				if (nVal < nBestVal)	// if better
+					iBest = iWin;
+				break;	// lower priorities don't matter
 			}
-			fOut << "\"\n";
-		}
-	}
-}
-
-void CalcAllSets()
-{
-	bool	bReadSavedData = false;	// set true to read back previously saved data
-	const char *pszDataPath = "BalaGrayTable.dat";
-	if (bReadSavedData) {
-		arrSeq.Read(pszDataPath);
-	} else {	// not reading saved data, so calculate interval sets
-		int	nSets = _countof(arrSetCode);
-		for (int iSet = 0; iSet < nSets; iSet++) {
-			CalcWithTimeout(arrSetCode[iSet]);
 		}
-		arrSeq.Write(pszDataPath);	// save data
 	}
-	MakeHTMLTable(arrSeq, "BalaGraySetsTable.htm");
-	MakeCSVTable(arrSeq, "BalaGraySetsTable.csv");
-	MakePolymeterImportTracksCSV(arrSeq, "BalaGraySetsAsPolymeterTracks.csv");
+	return iBest;
 }
 
-int main(int argc, const char* argv[])
+bool CBalaGray::CWinnerArray::Write(const char *pszPath) const
 {
-//	TestCalc();
-//	CalcWithTimeout(0x444);
-	CalcAllSets();
-	return 0;
+	std::ofstream	fOut(pszPath, std::ios_base::trunc | std::ios_base::binary);
+	if (!fOut.good())
+		return false;
+	fOut << *this;
+	fOut.close();
+	return !fOut.fail();
 }
@@ -0,0 +1,518 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version; split from BalaGray.cpp
+		01		18oct26	add prefix crawl, frontier enumeration and incumbent seeding
+		02		18oct26	widen numeral to 128-bit vector; widen set code
+		03		18oct26	compute span metrics incrementally
+		04		18oct26	add Pareto front mode
+		05		18oct26	add objective policies
+		06		18oct26	add numeral limit constant
+		07		18oct26	add permutation scoring
+		08		18oct26	add meet-in-the-middle crawl
+		09		18oct26	add balance lookahead
+		10		18oct26	add successor order seed and shared bound
+		11		18oct26	add limited discrepancy search
+		12		18oct26	add beam search
+		13		18oct26	write winners to any stream
+		14		18oct26	add crawl state sampler; move hot kernels inline
+		15		18oct26	add restricted adjacency modes
+		16		18oct26	add lower bound oracle and early termination
+		17		18oct26	add certify mode
+		18		18oct26	add sliding window balance
+		19		18oct26	add node limit
+		20		18oct26	befriend best-first search; add wrap mask helper
+
+*/
+
+// BalaGray.h : balanced Gray code crawler engine.
+// The engine is reentrant: it has no global state, so any number of
+// instances may crawl concurrently, each on its own thread.
+
+#pragma once
+
+#include <stdint.h>	// standard sizes
+#include <vector>	// growable array
+#include <fstream>	// file I/O
+#include <climits>
+#include <atomic>
+#include <unordered_map>
+#include <functional>
+#include <string.h>
+
+#define MORE_PLACES 2	// set non-zero to use more than four places: 1 == eight places, stored in a
+						// 64-bit word; 2 == sixteen places, stored in a 128-bit vector
+#define DO_PRUNING 1	// set non-zero to do branch pruning and reduce runtime
+#define START_2_DOWN 1	// set non-zero to skip first two levels of crawl; only first level under custom adjacency
+#define SHOW_STATS 0	// set non-zero to compute and show crawl statistics
+#define PREDICT_WRAP 1	// set non-zero to predict and abandon branches that won't wrap around Gray
+#define BALANCE_LOOKAHEAD 1	// set non-zero to abandon branches whose final balance can't be good enough
+#define OPT_STD_DEV 1	// selects default objective policy: 0 == max span only; 1 == standard deviation
+						// is max span tie-breaker; 2 == standard deviation only, ignoring max span
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define NUMERAL_SSE2 (MORE_PLACES > 1)	// byte-parallel numeral kernels use SSE2 vector operations
+#include <emmintrin.h>	// SSE2 intrinsics
+#else
+#define NUMERAL_SSE2 0	// byte-parallel numeral kernels use scalar loops
+#endif
+
+class CObjMaxSpan;	// objective policies; see BalaGrayObjective.h
+class CObjStdDev;
+class CObjMaxSpanStdDev;
+class CBalaGrayBench;	// kernel benchmarks; see BalaGrayBench.h
+class CBalaGrayBest;	// memory-bounded best-first search; see BalaGrayBest.h
+
+class CBalaGray {
+public:
+// Construction
+	CBalaGray();
+
+// Constants
+	enum {
+#if MORE_PLACES > 1
+		MAX_PLACES = 16,
+#elif MORE_PLACES
+		MAX_PLACES = 8,
+#else
+		MAX_PLACES = 4,
+#endif
+		NUMERAL_QUADS = (MAX_PLACES + 7) / 8,	// number of 64-bit words needed to serialize a numeral
+		MAX_NUMERALS = 127,	// limited by crawler's 128-bit used mask and wrap prediction
+	};
+	enum {	// objectives, all of which are minimized
+		OBJ_IMBALANCE,	// difference between minimum and maximum transition counts
+		OBJ_MAXTRANS,	// maximum transition count
+		OBJ_MAXSPAN,	// maximum span length
+		OBJ_STDDEV,		// standard deviation of span lengths, as sum of squared deviations
+		OBJECTIVES
+	};
+	enum {	// adjacency modes, which restrict the values a place may step to
+		ADJ_ANY,		// any other value; the usual Gray code
+		ADJ_CYCLIC,		// next or previous value, modulo base; a cyclic Gray code in each place
+		ADJ_CUSTOM,		// caller's adjacency graph for each place; see ParseAdjacency
+		ADJACENCY_MODES
+	};
+	enum {
+		SET_VARIANT_SHIFT = 56,	// in a variant's set code, bits from here up are its variant byte; see GetBases
+		SET_VARIANT_MARK = 0x10,	// variant byte's high nibble; no set's leading base can be one
+		MAX_VARIANT_PLACES = SET_VARIANT_SHIFT / 4,	// a variant's bases must fit below its variant byte
+		ADJACENCY_STRIDE = 16,	// values per place in custom adjacency array; enough for any nibble
+	};
+
+// Types
+	typedef uint8_t PLACE;	// 8 bits is enough for atonal music theory as bases don't exceed twelve
+	typedef uint64_t SET_CODE;	// specifies a mixed-radix numeral's bases, using one nibble per place
+	union NUMERAL {	// mixed-radix numeral with a variable number of places up to MAX_PLACES
+		PLACE	b[MAX_PLACES];	// array of places; their bases are assumed to be known
+#if MORE_PLACES > 1
+		uint64_t	qw[2];	// quad words containing all places
+#if NUMERAL_SSE2
+		__m128i	v;	// vector containing all places
+#endif
+#elif MORE_PLACES
+		uint64_t	dw;	// double word containing all places
+#else
+		uint32_t	dw;	// double word containing all places
+#endif
+		void	Zero() { memset(b, 0, sizeof(b)); }
+		uint64_t	GetQuad(int iQuad) const;
+		void	SetQuad(int iQuad, uint64_t nQuad);
+	};
+	typedef std::vector<NUMERAL> CNumeralArray;
+	typedef std::vector<PLACE> CPlaceArray;	// array of places, or of numeral indices
+	typedef std::vector<CPlaceArray> CPrefixArray;	// array of crawl prefixes
+	typedef std::vector<uint16_t> CAdjacencyArray;	// for each place and value, bitmask of adjacent values
+	class CWinner {	// info about winning permutation
+	public:
+		CWinner();
+		SET_CODE	m_nSetCode;	// set identifier in hexadecimal; specifies base of each place
+		int		m_nPlaces;		// how many places numeral has
+		int		m_nBaseSum;		// sum of numeral's bases
+		int		m_nImbalance;	// difference between minimum and maximum transition counts
+		int		m_nMaxTrans;	// maximum transition count
+		int		m_nMaxSpan;		// maximum span length
+		double	m_fStdDev;		// standard deviation of span lengths compared to ideal mean
+		bool	m_bIsProven;	// true if all permutations were tried
+		CNumeralArray	m_arrNum;	// array of mixed-radix numerals
+		bool	IsBetterThan(const CWinner& winner) const;
+		int		GetDevSum() const;
+		void	SetDevSum(int nDevSum);
+		int		GetObjective(int iObjective) const;
+		friend std::ostream& operator<<(std::ostream& os, const CWinner& winner);
+		friend std::ifstream& operator>>(std::ifstream& ifs, CWinner& winner);
+	};
+	class CWinnerArray : public std::vector<CWinner> {	// array of winners
+	public:
+		bool	Read(const char *pszPath);
+		bool	Write(const char *pszPath) const;
+		int		FindBest(const int *parrObjective, int nObjectives) const;
+		friend std::ostream& operator<<(std::ostream& os, const CWinnerArray& arrWin);
+		friend std::ifstream& operator>>(std::ifstream& ifs, CWinnerArray& arrWin);
+	};
+	struct LOWER_BOUND {	// lower bounds of any cycle's metrics; each assumes the preceding bounds are met
+		int		nImbalance;		// imbalance
+		int		nMaxTrans;		// maximum transition count
+		int		nMaxSpan;		// maximum span length
+		int		nDevSum;		// sum of squared deviations of span lengths
+	};
+	typedef std::function<void(const CWinner& winner)> CIncumbentFunc;	// called from crawler's thread
+	typedef std::atomic<uint64_t> CSharedBound;	// packed metrics of best winner found by any of several crawlers
+#if OPT_STD_DEV == 1
+	typedef CObjMaxSpanStdDev CObjective;	// objective policy used by crawler
+#elif OPT_STD_DEV == 2
+	typedef CObjStdDev CObjective;
+#else
+	typedef CObjMaxSpan CObjective;
+#endif
+
+// Attributes
+	int		GetNumeralCount() const { return static_cast<int>(m_arrNum.size()); }
+	void	SetPruneMaxTrans(int nThreshold) { m_nPruneMaxTrans = nThreshold; }
+	void	SetPruneImbalance(int nThreshold) { m_nPruneImbalance = nThreshold; }
+	static	int		GetBases(SET_CODE nSetCode, NUMERAL& arrBase);
+	static	int		GetAdjacency(SET_CODE nSetCode);
+	static	SET_CODE	MakeVariant(SET_CODE nSetCode, int nAdjacency);
+	void	SetCustomAdjacency(const CAdjacencyArray& arrAdjacency) { m_arrCustomAdjacency = arrAdjacency; }	// must be symmetric
+	bool	IsCanceled() const { return m_bCancel; }
+	void	SetLog(std::ostream *pLog) { m_pLog = pLog; }
+	bool	OpenLog(const char *pszPath);
+	void	SetVerbose(bool bEnable) { m_bVerbose = bEnable; }
+	void	SetIncumbentFunc(CIncumbentFunc fnIncumbent) { m_fnIncumbent = fnIncumbent; }
+	uint64_t	GetNodeCount() const { return m_nNodes.load(std::memory_order_relaxed); }
+	void	SetPrefix(const CPlaceArray& arrPrefix) { m_arrPrefix = arrPrefix; }	// empty for whole crawl
+	void	SetIncumbent(const CWinner& winner);
+	void	ClearIncumbent();
+	void	SetParetoFront(CWinnerArray *parrFront) { m_parrParetoFront = parrFront; }	// NULL for single winner
+	void	SetMeetLength(int nBackLen) { m_nMeetBackLen = nBackLen; }	// zero for usual crawl
+	void	SetSuccessorSeed(uint32_t nSeed) { m_nSuccessorSeed = nSeed; }	// zero for natural successor order
+	void	SetSharedBound(CSharedBound *pBound) { m_pSharedBound = pBound; }	// NULL for private bound
+	void	SetDiscrepancyStep(int nStep) { m_nDiscrepancyStep = nStep; }	// zero for usual crawl
+	void	SetBeamWidth(int nWidth) { m_nBeamWidth = nWidth; }	// zero for usual crawl
+	void	SetStateSampler(CPrefixArray *parrSample, int nMaxSamples);	// NULL for no sampling
+	void	SetCertify(bool bEnable) { m_bCertify = bEnable; }	// if true, crawl prunes admissibly only
+	void	SetWindowBalance(int nWindowLen, int nMaxTrans) { m_nWindowLen = nWindowLen; m_nWindowMaxTrans = nMaxTrans; }	// zero length for none
+	void	SetNodeLimit(uint64_t nLimit) { m_nNodeLimit = nLimit; }	// zero for none
+	const LOWER_BOUND&	GetLowerBound() const { return m_lbound; }	// valid after Calc
+	bool	IsLowerBoundMet(const CWinner& winner) const;
+
+// Operations
+	void	Reset();
+	int		Pack(const NUMERAL& num) const;
+	NUMERAL	Unpack(int iNumeral) const;
+	bool	Calc(int nPlaces, const PLACE *parrBase, CWinner& seqWinner);
+	bool	CalcFromCode(SET_CODE SetCode, CWinner& seqWinner);
+	static	bool	ParseAdjacency(const char *pszGraph, CAdjacencyArray& arrAdjacency);
+	void	Cancel() { m_bCancel = true; }
+	bool	EnumerateFrontier(SET_CODE nSetCode, int nPrefixLen, CPrefixArray& arrPrefix);
+	bool	Score(CWinner& winner);
+	bool	CalcLowerBound(SET_CODE nSetCode, LOWER_BOUND& bound);
+	static	void	WriteBalance(std::ostream& os, const CWinner& winner);
+	static	int		GetWindowMaxTrans(const CWinner& winner, int nWindowLen);
+
+protected:
+	friend class CBalaGrayBench;	// measures protected kernels on sampled states
+	friend class CBalaGrayBest;	// searches best-first with our tables
+
+// Constants
+	enum {
+		ULONGLONG_BITS = sizeof(uint64_t) * CHAR_BIT,	// number of bits in a long long word
+	};
+	enum {	// pruning thresholds may require manual tuning; see notes in set list
+		PRUNE_MAXTRANS = INT_MAX,	// prune branch if maximum transition count exceeds this value
+		PRUNE_IMBALANCE = 3,	// prune branch if imbalance exceeds this value
+	};
+	enum {
+		NODE_COUNT_PERIOD = 0xffff,	// node count is published when these bits of the count are zero
+		MAX_PARETO_SCORES = 6,	// imbalance, maximum transition count, and up to four policy keys
+		MAX_MEET_HALVES = 1 << 22,	// maximum number of backward halves in meet-in-the-middle crawl
+		BEAM_FINISH_LEN = 8,	// number of last numerals that beam search crawls exhaustively
+	};
+	enum {	// packed bound fields, most significant first: imbalance, max transition count, policy's keys
+		BOUND_METRIC_BITS = 8,	// width of imbalance and max transition count fields
+		BOUND_KEY_BITS = 64 - BOUND_METRIC_BITS * 2,	// width of all policy key fields together
+	};
+
+// Types
+	struct STATE {	// crawler stack element
+		PLACE	iNum;		// index into numeral array
+		PLACE	iGray;		// index into Gray successor array
+		NUMERAL	nTrans;		// transition counts, one per place
+	};
+	typedef std::vector<STATE> CStateArray;	// array of states
+	struct PARETO_POINT {	// member of Pareto front
+		int		arrScore[MAX_PARETO_SCORES];	// imbalance, maximum transition count, then policy's keys
+		CPlaceArray	arrPerm;	// permutation, as numeral indices
+	};
+	typedef std::vector<PARETO_POINT> CParetoArray;
+	struct MEET_KEY {	// set of numerals used by a half path, as a bitmask
+		uint64_t	arrMask[2];	// need 128 bits, as number of numerals may exceed 64
+		bool	operator==(const MEET_KEY& key) const { return arrMask[0] == key.arrMask[0] && arrMask[1] == key.arrMask[1]; }
+	};
+	struct MEET_KEY_HASH {	// hash function for numeral sets
+		size_t	operator()(const MEET_KEY& key) const;
+	};
+	struct MEET_HALF {	// backward half path of meet-in-the-middle crawl
+		NUMERAL	nTrans;		// transition counts, including wraparound to origin
+		int		iNum;		// index of half's first numeral in array of concatenated halves
+		int		iNext;		// index of next half that uses the same numerals, or -1 if none
+	};
+	typedef std::unordered_map<MEET_KEY, int, MEET_KEY_HASH> CMeetMap;	// maps numeral set to first half using it
+	typedef std::vector<MEET_HALF> CMeetHalfArray;
+	struct BEAM_NODE {	// partial path kept by beam search
+		NUMERAL	nTrans;		// transition counts, excluding wraparound
+		NUMERAL	nLastTrans;	// depth of each place's latest transition, or zero if none
+		uint64_t	arrUsedMask[2];	// numerals used by path; need 128 bits
+		int		nDevSum;	// sum of squared deviations of spans closed so far, excluding first spans
+		PLACE	nMaxSpan;	// maximum length of spans closed so far
+		PLACE	iNum;		// index of path's last numeral
+	};
+	struct BEAM_CAND {	// candidate extension of a beam node
+		int		iParent;	// index of extended node in current beam
+		PLACE	iNum;		// index of appended numeral
+		PLACE	iPlace;		// place that differs from node's last numeral
+	};
+	struct BEAM_LINK {	// beam history entry, for recovering complete paths
+		int		iParent;	// index of parent in previous depth's beam
+		PLACE	iNum;		// index of numeral at this depth
+	};
+	typedef std::vector<BEAM_NODE> CBeamNodeArray;
+	typedef std::vector<BEAM_CAND> CBeamCandArray;
+	typedef std::vector<BEAM_LINK> CBeamLinkArray;
+	typedef std::unordered_map<MEET_KEY, MEET_KEY, MEET_KEY_HASH> CBeamEndMap;	// maps numeral set to bitmask of path ends
+
+// Member data
+	int		m_nPlaces;	// number of places
+	int		m_nGraySuccessors;	// number of Gray successors a numeral can have
+	int		m_nGrayStrideShift;	// stride of Gray successors array, as a per-row shift in bits
+	int		m_nPruneMaxTrans;	// prune branch if its maximum transition count exceeds this threshold
+	int		m_nPruneImbalance;	// prune branch if its imbalance exceeds this threshold
+	CPlaceArray	m_arrBase;	// array of bases, one for each place of numeral
+	NUMERAL	m_nUnusedPlaces;	// 0xff in places beyond m_nPlaces, else zero; for vector kernels
+	CNumeralArray	m_arrNum;	// array of numerals
+	CPlaceArray	m_arrGraySuccessor;	// 2D table of Gray successors for each numeral
+	CPlaceArray	m_arrGrayPlace;	// 2D table of place that differs, for each Gray successor
+	std::vector<int>	m_arrImbalanceBound;	// lower bound on final imbalance, for each max transition count
+	CStateArray	m_arrState;	// array of states; crawler stack
+	std::ofstream	m_fLog;	// log file, if we opened one
+	std::ostream	*m_pLog;	// log stream, or NULL if logging is disabled
+	bool	m_bVerbose;	// true if progress is written to console
+	CIncumbentFunc	m_fnIncumbent;	// optional callback for each new incumbent
+	std::atomic<bool>	m_bCancel;	// cancel flag
+	std::atomic<uint64_t>	m_nNodes;	// number of nodes crawled, published periodically
+	CPlaceArray	m_arrPrefix;	// if non-empty, only branches below this prefix are crawled
+	CWinner	m_winIncumbent;	// initial incumbent, if any
+	bool	m_bHaveIncumbent;	// true if initial incumbent was specified
+	int		m_nFrontierLen;	// length of prefixes to enumerate
+	CPrefixArray	*m_parrFrontier;	// if non-NULL, receives frontier prefixes instead of crawling them
+	CWinnerArray	*m_parrParetoFront;	// if non-NULL, receives Pareto front of non-dominated winners
+	CParetoArray	m_arrPareto;	// Pareto front during crawl
+	int		m_nMeetBackLen;	// if non-zero, length of backward halves in meet-in-the-middle crawl
+	uint32_t	m_nSuccessorSeed;	// if non-zero, seeds shuffle of each numeral's Gray successors
+	CSharedBound	*m_pSharedBound;	// if non-NULL, bound shared with other crawlers; initially UINT64_MAX
+	int		m_nDiscrepancyStep;	// if non-zero, limited discrepancy search raises its limit by this much per pass
+	int		m_nMaxDiscrepancy;	// maximum discrepancies per branch during limited discrepancy pass
+	bool	m_bDiscrepancyCut;	// true if current pass abandoned any branch for exceeding discrepancy limit
+	int		m_nBeamWidth;	// if non-zero, number of partial paths kept at each depth by beam search
+	CPrefixArray	*m_parrStateSample;	// if non-NULL, receives crawl stack snapshots
+	int		m_nMaxStateSamples;	// crawl is canceled once this many snapshots are taken
+	int		m_nAdjacency;		// adjacency mode; see enum
+	CAdjacencyArray	m_arrCustomAdjacency;	// custom adjacency graph, indexed by place * ADJACENCY_STRIDE + value
+	LOWER_BOUND	m_lbound;	// lower bounds of current set's metrics
+	bool	m_bLowerBoundMet;	// true if crawl stopped because best winner met lower bound
+	bool	m_bCertify;			// true if crawl may only abandon branches that can't beat the best winner
+	bool	m_bHeuristicCut;	// true if crawl abandoned a branch that might have beaten the best winner
+	int		m_nWindowLen;		// if non-zero, number of consecutive transitions in each balance window
+	int		m_nWindowMaxTrans;	// maximum transition count of any place within any balance window
+	uint64_t	m_nNodeLimit;	// if non-zero, crawl is canceled once it crawls this many nodes
+
+// Helpers
+	void	ResetCrawl();
+	bool	MakeNumerals(int nPlaces, const PLACE *parrBase);
+	bool	MakeGraySuccessorTable();
+	bool	MakeGrayWrapMask(uint64_t& nGrayWrapMask) const;
+	bool	SelectAdjacency(SET_CODE nSetCode);
+	void	MakeLookaheadTable();
+	void	MakeLowerBound();
+	bool	IsBipartitePlace(int iPlace) const;
+	template<class OBJ> bool IsLowerBoundMet(int nImbalance, int nMaxTrans, const int *parrKey) const;
+	void	DumpGraySuccessorTable() const;
+	void	DumpNumeral(const NUMERAL& num) const;
+	void	DumpNumerals() const;
+	void	DumpSet() const;
+	void	DumpPermutation() const;
+	void	WritePermutationToLog(const CWinner& winner);
+	void	ReportIncumbent(const CWinner& winner);
+	void	SampleState(int iDepth);
+	template<class OBJ> bool	Crawl(CWinner& seqWinner);
+	template<class OBJ> bool	MeetCrawl(CWinner& seqWinner);
+	template<class OBJ> bool	DiscrepancyCrawl(CWinner& seqWinner);
+	template<class OBJ> bool	BeamCrawl(CWinner& seqWinner);
+	template<class OBJ> void	FinishBeamPath(int iDepth, CPlaceArray& arrPerm, uint64_t *parrUsedMask, CWinner& winBest, uint64_t& nNodes);
+	bool	IsBeamDegreeOK(const std::vector<MEET_KEY>& arrNeighbor, const uint64_t *parrUsedMask, int iOldEnd, int iNewEnd) const;
+	void	ScoreBeamBatch(int iDepth, const CBeamNodeArray& arrNode, const CBeamCandArray& arrCand, std::vector<uint64_t>& arrKey) const;
+	void	MakeWinner(const CPlaceArray& arrPerm, CWinner& seqWinner) const;
+	template<class OBJ> bool	ApplyIncumbent(CPlaceArray& arrBestPerm);
+	bool	ApplyPrefix(int& iDepth, uint64_t *parrUsedMask);
+	bool	IsParetoDominated(const int *parrScore, int nScores) const;
+	bool	UpdateParetoFront(const int *parrScore, int nScores, const CPlaceArray *parrPerm = NULL);
+	template<class OBJ> void	MakeParetoFront(bool bIsProven);
+	template<class OBJ> void	ScorePermutation(const CPlaceArray& arrPerm, CWinner& winner);
+	template<class OBJ> static	uint64_t	PackBound(int nImbalance, int nMaxTrans, const int *parrKey);
+	template<class OBJ> static	void	UnpackBound(uint64_t nBound, int& nImbalance, int& nMaxTrans, int *parrKey);
+	void	PublishBound(uint64_t nBound);
+	void	PublishNodeCount(uint64_t nNodes);
+	bool	IsGray(NUMERAL num1, NUMERAL num2) const;
+	bool	IsGrayScalar(NUMERAL num1, NUMERAL num2) const;
+	bool	IsStep(int iPlace, int nFrom, int nTo) const;
+	bool	IsAdjacent(const NUMERAL& num1, const NUMERAL& num2) const;
+	bool	IsSecondFixed() const;
+	int		GetTransPlace(int iDepth) const;
+	int		GetDiffPlace(const NUMERAL& num1, const NUMERAL& num2) const;
+	int		ComputeBalance(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const;
+	int		ComputeBalanceScalar(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const;
+	int		ComputeWrapBalance(const NUMERAL& nTrans, const NUMERAL& numCur, int& nMaxTrans) const;
+	bool	IsWindowBalanced(int iDepth, const NUMERAL& nTransCounts, int iPlace) const;
+	bool	IsWrapWindowBalanced(int iDepth, const NUMERAL& nTransCounts) const;
+};
+
+inline uint64_t CBalaGray::NUMERAL::GetQuad(int iQuad) const
+{
+	// returns the given group of eight places as a 64-bit word, least significant place in low byte
+	uint64_t	nQuad = 0;
+	int	iFirst = iQuad * 8;
+	for (int iPlace = iFirst + 7; iPlace >= iFirst; iPlace--) {	// for each place in group, in descending order
+		nQuad <<= 8;
+		if (iPlace < MAX_PLACES)
+			nQuad |= b[iPlace];
+	}
+	return nQuad;
+}
+
+inline void CBalaGray::NUMERAL::SetQuad(int iQuad, uint64_t nQuad)
+{
+	int	iFirst = iQuad * 8;
+	for (int iPlace = iFirst; iPlace < iFirst + 8 && iPlace < MAX_PLACES; iPlace++) {	// for each place in group
+		b[iPlace] = static_cast<PLACE>(nQuad);
+		nQuad >>= 8;
+	}
+}
+
+// The crawl's innermost kernels are defined here rather than in BalaGray.cpp,
+// so that the kernel benchmarks inline them exactly as the crawl does.
+
+FORCE_INLINE bool CBalaGray::IsGray(NUMERAL num1, NUMERAL num2) const
+{
+	// Returns true if the given numerals differ by exactly one place.
+#if NUMERAL_SSE2
+	// compare all places at once; unused places are zero in both numerals, so they never differ
+	unsigned int	nDiffMask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(num1.v, num2.v)) & 0xffff;
+	return nDiffMask && !(nDiffMask & (nDiffMask - 1));	// exactly one bit set
+#else
+	return IsGrayScalar(num1, num2);
+#endif
+}
+
+inline bool CBalaGray::IsGrayScalar(NUMERAL num1, NUMERAL num2) const
+{
+	bool	bDiff = false;
+	int	nPlaces = m_nPlaces;
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		if (num1.b[iPlace] != num2.b[iPlace]) {	// if places differ
+			if (!bDiff) {	// if first difference
+				bDiff = true;	// set flag
+			} else {	// not first difference
+				return false;	// not Gray; early out
+			}
+		}
+	}
+	return bDiff;
+}
+
+FORCE_INLINE int CBalaGray::ComputeBalance(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const
+{
+#if NUMERAL_SSE2
+	// Same as ComputeBalanceScalar, but updates all places at once. Unused
+	// places are zero in both numerals, so their counts remain zero.
+	const __m128i	vOne = _mm_set1_epi8(1);
+	__m128i	vTrans = m_arrState[iDepth - 1].nTrans.v;	// load latest transition counts from stack
+	__m128i	vPrev = m_arrNum[m_arrState[iDepth - 1].iNum].v;
+	__m128i	vCur = m_arrNum[m_arrState[iDepth].iNum].v;
+	// increment transition count of each place that differs from previous state
+	vTrans = _mm_add_epi8(vTrans, _mm_andnot_si128(_mm_cmpeq_epi8(vCur, vPrev), vOne));
+	nTransCounts.v = vTrans;	// order matters; counts passed back to caller must exclude wraparound
+	// account for wraparound; compare current state to initial state, which is assumed to be zero
+	vTrans = _mm_add_epi8(vTrans, _mm_andnot_si128(_mm_cmpeq_epi8(vCur, _mm_setzero_si128()), vOne));
+	// horizontal min and max; unused places are forced to 0xff for min, and are already zero for max
+	__m128i	vMin = _mm_or_si128(vTrans, m_nUnusedPlaces.v);
+	__m128i	vMax = vTrans;
+	vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 8));
+	vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 8));
+	vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 4));
+	vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 4));
+	vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 2));
+	vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 2));
+	vMin = _mm_min_epu8(vMin, _mm_srli_si128(vMin, 1));
+	vMax = _mm_max_epu8(vMax, _mm_srli_si128(vMax, 1));
+	int	nMin = _mm_cvtsi128_si32(vMin) & 0xff;
+	int	nMax = _mm_cvtsi128_si32(vMax) & 0xff;
+	nMaxTrans = nMax;
+	return nMax - nMin;	// return difference
+#else
+	return ComputeBalanceScalar(iDepth, nMaxTrans, nTransCounts);
+#endif
+}
+
+inline int CBalaGray::ComputeBalanceScalar(int iDepth, int& nMaxTrans, NUMERAL& nTransCounts) const
+{
+	int	nPlaces = m_nPlaces;
+	NUMERAL	nTrans;
+	nTrans = m_arrState[iDepth - 1].nTrans;	// load latest transition counts from stack
+	// compare current state to previous state
+	NUMERAL	sPrev, sCur;
+	sPrev = m_arrNum[m_arrState[iDepth - 1].iNum];
+	sCur = m_arrNum[m_arrState[iDepth].iNum];
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		if (sCur.b[iPlace] != sPrev.b[iPlace]) {	// if place transitioned
+			nTrans.b[iPlace]++;	// increment place's transition count
+		}
+	}
+	nTransCounts = nTrans;	// order matters; counts passed back to caller must exclude wraparound
+	// account for wraparound; compare current state to initial state, which is assumed to be zero
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		if (sCur.b[iPlace]) {	// if place transitioned
+			nTrans.b[iPlace]++;	// increment place's transition count
+		}
+	}
+	// now that we have latest transition counts, compute their min and max
+	int	nMin = nTrans.b[0];	// initialize min and max to first transition count
+	int	nMax = nTrans.b[0];
+	for (int iPlace = 1; iPlace < nPlaces; iPlace++) {	// for each transition count, excluding first
+		int	n = nTrans.b[iPlace];
+		if (n < nMin)	// if less than min
+			nMin = n;	// update min
+		if (n > nMax)	// if greater than max
+			nMax = n;	// udpate max
+	}
+	nMaxTrans = nMax;
+	return nMax - nMin;	// return difference
+}
+
+FORCE_INLINE bool CBalaGray::IsWindowBalanced(int iDepth, const NUMERAL& nTransCounts, int iPlace) const
+{
+	// Returns true if the given place, which just transitioned, doesn't exceed
+	// the window limit within the window of transitions ending at this depth.
+	// The stack's counts are cumulative, so a window's count is a difference.
+	int	nCount = nTransCounts.b[iPlace];
+	if (iDepth > m_nWindowLen)	// if window doesn't reach back to origin
+		nCount -= m_arrState[iDepth - m_nWindowLen].nTrans.b[iPlace];
+	return nCount <= m_nWindowMaxTrans;
+}
+
+#include "BalaGrayObjective.h"	// needs complete crawler class
@@ -0,0 +1,1228 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+ 
+		revision history:
+		rev		date	comments
+        00      26jan23	initial version
+		01		05may24	fix wrongly named member var (cosmetic)
+		02		12dec24	add wrap prediction; improve error handling
+		03		04aug25	add standard deviation
+		04		22aug25	improve portability
+		05		18oct26	move crawler to its own module; use job queue
+		06		18oct26	add command line and sharded crawl commands
+		07		18oct26	widen set code
+		08		18oct26	add Pareto front commands
+		09		18oct26	get score columns from objective policy
+		10		18oct26	generate interval sets for any range
+		11		18oct26	seed sets from winners of their sub-sets
+		12		18oct26	add meet-in-the-middle command
+		13		18oct26	add global time budget
+		14		18oct26	add verifier
+		15		18oct26	add portfolio command
+		16		18oct26	add limited discrepancy command
+		17		18oct26	add beam search command
+		18		18oct26	add solve server command
+		19		18oct26	add kernel benchmark command
+		20		18oct26	add restricted adjacency command
+		21		18oct26	add lower bound command
+		22		18oct26	add certify command
+		23		18oct26	add balance window command
+		24		18oct26	add parameter sweep command
+		25		18oct26	add cycle cover merge command
+		26		18oct26	add best-first search command
+
+*/
+
+// BalaGrayApp.cpp : Defines the entry point for the console application.
+// This app computes balanced Gray code sequences, for use in music theory.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGray.h"	// crawler engine
+#include "BalaGrayJobs.h"	// concurrent job queue
+#include "BalaGrayShard.h"	// multi-process sharded crawl
+#include "BalaGraySets.h"	// interval set generator
+#include "BalaGrayCompose.h"	// candidate cycles from sub-sets
+#include "BalaGrayBudget.h"	// global time budget
+#include "BalaGrayVerify.h"	// independent winner verifier
+#include "BalaGrayPortfolio.h"	// parallel portfolio solver
+#include "BalaGrayServer.h"	// local solve server
+#include "BalaGrayBench.h"	// kernel microbenchmarks
+#include "BalaGrayCertify.h"	// certifies pruned winners
+#include "BalaGraySweep.h"	// parameter sweep
+#include "BalaGrayMerge.h"	// cycle cover merge engine
+#include "BalaGrayBest.h"	// memory-bounded best-first search
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>	// debugging
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <chrono>
+#include <math.h>
+
+void TestCalc()
+{
+	CBalaGray::SET_CODE nSetCode = 
+//
+// All cases want PRUNE_IMBALANCE = 3 unless specified otherwise below.
+// Pruning greatly reduces runtime, but the results may not be optimal.
+// Proven means exited normally with pruning disabled (DO_PRUNING = 0).
+// Only ONE of the following set codes may be uncommented at a time.
+//
+//	0x22	// proven
+//	0x23	// proven
+//	0x24	// proven
+//	0x33	// proven
+//	0x25	// proven
+//	0x34	// proven
+//	0x26	// proven
+//	0x35	// proven
+//	0x44	// proven
+//	0x27	// proven
+//	0x36	// proven
+//	0x45	// proven
+//	0x28	// proven
+//	0x37
+//	0x46
+//	0x55
+//	0x29	// proven
+//	0x38
+//	0x47
+//	0x56
+//	0x2A	// proven
+//	0x39
+//	0x48
+//	0x57
+//	0x66
+//	0x222	// proven
+//	0x223	// proven
+//	0x224	// proven
+//	0x233	// proven
+//	0x225	// proven
+	0x234	// proven
+//	0x333
+//	0x226	// proven
+//	0x235
+//	0x244
+//	0x334
+//	0x227
+//	0x236
+//	0x245
+//	0x335
+//	0x344
+//	0x228
+//	0x237
+//	0x246
+//	0x255
+//	0x336
+//	0x345
+//	0x444
+//	0x2222	// proven
+//	0x2223	// proven
+//	0x2224
+//	0x2233
+//	0x2225
+//	0x2234
+//	0x2333
+//	0x2226
+//	0x2235	// slow
+//	0x2244
+//	0x2334	// slow; wants PRUNE_IMBALANCE = 4
+//	0x3333	// slow
+//
+// *** following cases require MORE_PLACES to be non-zero ***
+//
+//	0x22222
+//	0x22223	// wants PRUNE_IMBALANCE = 2
+//	0x22224	// wants PRUNE_IMBALANCE = 2
+//	0x22233	// wants PRUNE_IMBALANCE = 4
+//	0x222222
+//
+	;	// if a set code isn't uncommented above, compiler error here
+	CBalaGray	bg;
+	bg.OpenLog("BalaGrayIter.txt");
+	bg.SetVerbose(true);
+	CBalaGray::CWinner	seqWinner;
+	bg.CalcFromCode(nSetCode, seqWinner);
+	printf("done\npress Enter to continue\n");
+	fgetc(stdin);
+}
+
+
+void GetDefaultOptions(CBalaGray::SET_CODE nSetCode, CBalaGrayJobQueue::OPTIONS& opts)
+{
+	int nTimeoutMillis = 30 * 1000;	// default maximum runtime
+	char	szCode[32];
+	sprintf(szCode, "%llX", static_cast<unsigned long long>(nSetCode));
+	opts.sLogPath = "BalaGray ";
+	opts.sLogPath += szCode;
+	opts.sLogPath += ".txt";
+	opts.bVerbose = true;
+	switch (nSetCode) {
+	case 0x37:
+	case 0x46:
+	case 0x234:
+	case 0x22222:
+		// the above sets benefit from longer runtimes
+		nTimeoutMillis = std::max(nTimeoutMillis, 120 * 1000);
+		break;
+	case 0x2224:
+		nTimeoutMillis = std::max(nTimeoutMillis, 60 * 1000);
+		break;
+	case 0x2225:
+		nTimeoutMillis = std::max(nTimeoutMillis, 180 * 1000);
+		break;
+	case 0x336:
+	case 0x2334:
+	case 0x22233:
+		opts.nPruneImbalance = 4;
+		break;
+	case 0x22224:
+	case 0x22223:
+		opts.nPruneImbalance = 2;
+		break;
+	}
+#if OPT_STD_DEV
+	nTimeoutMillis *= 2;	// standard deviation needs longer timeout
+#endif
+	opts.nTimeoutMillis = nTimeoutMillis;
+}
+
+CBalaGrayJobQueue::CJobPtr SubmitWithTimeout(CBalaGrayJobQueue& queue, CBalaGray::SET_CODE nSetCode, const CBalaGray::CWinner *pIncumbent = NULL, CBalaGrayBudget *pBudget = NULL)
+{
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	if (pIncumbent != NULL)	// if initial incumbent specified
+		opts.winIncumbent = *pIncumbent;
+	CBalaGrayJobQueue::CJobFunc	fnProgress;
+	if (pBudget != NULL) {	// if global budget specified, it overrides fixed timeout
+		pBudget->Attach(opts);
+		fnProgress = [pBudget](const CBalaGrayJobQueue::CJob& job, const CBalaGray::CWinner& winner) {
+			pBudget->OnImprove(job);	// job has earned another grant
+		};
+	}
+	return queue.Submit(nSetCode, opts, fnProgress, 
+		[pBudget](const CBalaGrayJobQueue::CJob& job, const CBalaGray::CWinner& winner) {
+			if (pBudget != NULL)	// if global budget specified
+				pBudget->OnDone(job);	// release job's unused time
+			if (job.IsTimedOut()) {	// if job was stopped by watchdog
+				printf("timeout\n");
+			} else {	// job finished normally
+				printf("done\n");
+			}
+		}
+	);
+}
+
+void CalcWithTimeout(CBalaGray::SET_CODE nSetCode, CBalaGray::CWinnerArray& arrSeq)
+{
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	arrSeq.push_back(SubmitWithTimeout(queue, nSetCode)->Wait());
+}
+
+void MakeHTMLTable(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
+{
+	static const char	arrBoolChar[2] = {'N', 'Y'};
+	assert(pszPath != NULL);
+	std::ofstream	fOut(pszPath, std::ios_base::trunc);
+	if (!fOut.good()) {
+		printf("can't create file '%s'\n", pszPath);
+		return;
+	}
+	int	nSeqs = static_cast<int>(arrSeq.size());
+	fOut << "<!DOCTYPE html>\n<html>\n<head>\n";
+	fOut << "<title>Balanced Gray Interval Sets</title>\n";
+	fOut << "<meta name=\"author\" content=\"Chris Korda\">\n"
+		"<meta name=\"description\" content=\"Interval sets derived from balanced Gray code.\">\n"
+		"<link href=\"../style.css\" rel=stylesheet title=default type=text/css>\n"
+		"</head>\n<body style=\"text-size-adjust: none; -webkit-text-size-adjust: none;\">\n"	// need this for mobile, else text size varies
+		"<table border=1 cellpadding=2 cellspacing=0>\n"
+		"<tr><th>Name</th><th>Size</th><th>Range</th><th>States</th><th>Imbalance</th>";
+	int	nScoreCols = CBalaGray::CObjective::GetColumnCount();
+	for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+		fOut << "<th>" << CBalaGray::CObjective::GetColumnName(iCol) << "</th>";
+	}
+	fOut << "<th>Proven</th><th>Set</th></tr>\n";
+	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
+		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
+		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
+		fOut << "<tr><td>" << std::hex << std::uppercase << seq.m_nSetCode << std::dec
+			<< "</td><td>" << seq.m_nPlaces
+			<< "</td><td>" << seq.m_nBaseSum
+			<< "</td><td>" << nNumerals
+			<< "</td><td>" << seq.m_nImbalance << std::setprecision(3);
+		for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+			fOut << "</td><td>";
+			CBalaGray::CObjective::WriteColumn(fOut, seq, iCol);
+		}
+		fOut << "</td><td>" << arrBoolChar[seq.m_bIsProven] << "</td><td>\n";
+		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
+			if (iPlace)
+				fOut << "\n<br>";
+			for (int iNum = 0; iNum < nNumerals; iNum++) {
+				if (iNum)
+					fOut << "&nbsp;";
+				fOut << int(seq.m_arrNum[iNum].b[iPlace]);
+			}
+		}
+		fOut << "\n</td></tr>\n";
+	}
+	fOut << "</table>\n</body>\n</html>\n";
+}
+
+void MakeCSVTable(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
+{
+	assert(pszPath != NULL);
+	std::ofstream	fOut(pszPath, std::ios_base::trunc);
+	if (!fOut.good()) {
+		printf("can't create file '%s'\n", pszPath);
+		return;
+	}
+	int	nSeqs = static_cast<int>(arrSeq.size());
+	int	nScoreCols = CBalaGray::CObjective::GetColumnCount();
+	fOut << "Name,Digit,Digits,Range,States,Imbalance";
+	for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+		fOut << ',' << CBalaGray::CObjective::GetColumnName(iCol);
+	}
+	fOut << ",Proven\n";
+	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
+		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
+		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
+		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
+			fOut << '[' << std::hex << std::uppercase << seq.m_nSetCode << std::dec << ']'
+				<< ',' << iPlace
+				<< ',' << seq.m_nPlaces
+				<< ',' << seq.m_nBaseSum
+				<< ',' << nNumerals
+				<< ',' << seq.m_nImbalance;
+			for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+				fOut << ',';
+				CBalaGray::CObjective::WriteColumn(fOut, seq, iCol);
+			}
+			fOut << ',' << seq.m_bIsProven;
+			for (int iNum = 0; iNum < nNumerals; iNum++) {
+				fOut << ',' << int(seq.m_arrNum[iNum].b[iPlace]);
+			}
+			fOut << '\n';
+		}
+	}
+}
+
+void MakePolymeterImportTracksCSV(const CBalaGray::CWinnerArray& arrSeq, const char *pszPath)
+{
+	assert(pszPath != NULL);
+	std::ofstream	fOut(pszPath, std::ios_base::trunc);
+	if (!fOut.good()) {
+		printf("can't create file '%s'\n", pszPath);
+		return;
+	}
+	int	nSeqs = static_cast<int>(arrSeq.size());
+	fOut << "Name,Type,Steps\n";
+	for (int iSeq = 0; iSeq < nSeqs; iSeq++) {
+		const CBalaGray::CWinner&	seq = arrSeq[iSeq];
+		int	nNumerals = static_cast<int>(seq.m_arrNum.size());
+		for (int iPlace = 0; iPlace < seq.m_nPlaces; iPlace++) {
+			fOut << "\"BG [" << std::hex << std::uppercase << seq.m_nSetCode << std::dec << "] " << iPlace + 1 << "\",7,\"";
+			for (int iNum = 0; iNum < nNumerals; iNum++) {
+				if (iNum)
+					fOut << ',';
+				fOut << int(seq.m_arrNum[iNum].b[iPlace]) + 64;	// convert to signed step value
+			}
+			fOut << "\"\n";
+		}
+	}
+}
+
+void MakeTables(const CBalaGray::CWinnerArray& arrSeq)
+{
+	MakeHTMLTable(arrSeq, "BalaGraySetsTable.htm");
+	MakeCSVTable(arrSeq, "BalaGraySetsTable.csv");
+	MakePolymeterImportTracksCSV(arrSeq, "BalaGraySetsAsPolymeterTracks.csv");
+}
+
+bool CalcAllSets(const CBalaGraySets& sets, double fBudgetSeconds = 0)
+{
+	bool	bReadSavedData = false;	// set true to read back previously saved data
+	const char *pszDataPath = "BalaGrayTable.dat";
+	CBalaGray::CWinnerArray	arrSeq;
+	if (bReadSavedData) {
+		arrSeq.Read(pszDataPath);
+	} else {	// not reading saved data, so calculate interval sets
+		CBalaGraySets::CSetInfoArray	arrSet;
+		if (!sets.Generate(arrSet))
+			return false;
+		// Sets are solved in waves by place count, so that each set can be seeded
+		// with a candidate composed from the winners of its sub-sets, which have
+		// fewer places. Within a wave, the hardest sets start first, so they don't
+		// straggle. There's one worker per core; each job's timeout starts when a
+		// worker picks it up, so each set still gets a whole core for its timeout.
+		// If a budget is specified, it replaces the fixed timeouts; it's declared
+		// before the queue, so that it outlives the queue's threads.
+		std::unique_ptr<CBalaGrayBudget>	pBudget;
+		CBalaGrayJobQueue	queue;
+		if (fBudgetSeconds > 0) {	// if global budget specified
+			int	nCrawlable = static_cast<int>(std::count_if(arrSet.begin(), arrSet.end(),
+				[](const CBalaGraySets::SET_INFO& info) { return info.IsCrawlable(); }));
+			pBudget.reset(new CBalaGrayBudget(fBudgetSeconds, queue.GetThreadCount(), nCrawlable));
+			printf("budget: %.0f core-seconds, initial slice %.1f seconds\n",
+				pBudget->GetTotalSeconds(), pBudget->GetSliceMillis() / 1000.0);
+		}
+		CBalaGrayCompose	compose;
+		std::map<CBalaGray::SET_CODE, CBalaGrayJobQueue::CJobPtr>	mapJob;
+		int	nSets = static_cast<int>(arrSet.size());
+		for (int iWaveStart = 0; iWaveStart < nSets; ) {	// for each wave
+			int	nPlaces = arrSet[iWaveStart].nPlaces;
+			int	iWaveEnd = iWaveStart;
+			while (iWaveEnd < nSets && arrSet[iWaveEnd].nPlaces == nPlaces)	// list is sorted by place count
+				iWaveEnd++;
+			CBalaGraySets::CSetInfoArray	arrSchedule(arrSet.begin() + iWaveStart, arrSet.begin() + iWaveEnd);
+			CBalaGraySets::SortByCost(arrSchedule);
+			std::vector<CBalaGrayJobQueue::CJobPtr>	arrWaveJob;
+			for (const CBalaGraySets::SET_INFO& info : arrSchedule) {	// for each set, hardest first
+				if (!info.IsCrawlable()) {	// if too many states for crawler
+					printf("%llX: skipped, %d states exceeds limit of %d\n",
+						static_cast<unsigned long long>(info.nSetCode), info.nStates, CBalaGray::MAX_NUMERALS);
+					continue;
+				}
+				CBalaGray::CWinner	winSeed;
+				bool	bSeeded = compose.Compose(info.nSetCode, winSeed);
+				if (bSeeded) {
+					std::ostringstream	ss;
+					ss << std::fixed;	// same format as printf's %f
+					CBalaGray::WriteBalance(ss, winSeed);
+					printf("%llX: seeded, %s\n", static_cast<unsigned long long>(info.nSetCode), ss.str().c_str());
+				}
+				CBalaGrayJobQueue::CJobPtr	pJob = SubmitWithTimeout(queue, info.nSetCode, bSeeded ? &winSeed : NULL, pBudget.get());
+				mapJob[info.nSetCode] = pJob;
+				arrWaveJob.push_back(pJob);
+			}
+			for (const CBalaGrayJobQueue::CJobPtr& pJob : arrWaveJob) {	// for each of wave's jobs
+				compose.AddWinner(pJob->Wait());	// next waves can compose from this winner
+			}
+			iWaveStart = iWaveEnd;
+		}
+		for (const CBalaGraySets::SET_INFO& info : arrSet) {	// collect results in list order
+			auto	iter = mapJob.find(info.nSetCode);
+			if (iter != mapJob.end())	// if set was submitted
+				arrSeq.push_back(iter->second->Wait());
+		}
+		if (pBudget) {	// if global budget specified
+			queue.WaitAll();	// ensure all completion callbacks have run
+			printf("budget: used %.1f of %.0f core-seconds, %d extensions\n",
+				pBudget->GetUsedSeconds(), pBudget->GetTotalSeconds(), pBudget->GetExtensionCount());
+		}
+		arrSeq.Write(pszDataPath);	// save data
+	}
+	MakeTables(arrSeq);
+	return true;
+}
+
+void ShowUsage()
+{
+	printf("usage: BalaGray [command]\n"
+		"with no command, calculates all interval sets and writes tables\n"
+		"commands:\n"
+		"  all [RANGE [MINPLACES [MAXPLACES]]]\n"
+		"      calculate all interval sets within the given bounds and write tables;\n"
+		"      default range is 12, as in IntervalSetsList.h\n"
+		"  budget SECS [RANGE [MINPLACES [MAXPLACES]]]\n"
+		"      same as all, but instead of fixed timeouts, share a total budget of SECS\n"
+		"      wall seconds on all cores, granting more time to sets that keep improving\n"
+		"  sets [RANGE [MINPLACES [MAXPLACES]]]\n"
+		"      list interval sets within the given bounds, with estimated search costs\n"
+		"  shard plan DIR SET PREFIXLEN [PRUNEIMBALANCE]\n"
+		"      enumerate crawl frontier of hex SET into a manifest of prefix jobs\n"
+		"  shard work DIR [TIMEOUTSECS]\n"
+		"      claim and crawl unfinished jobs; run any number of these at once\n"
+		"  shard merge DIR\n"
+		"      combine partial winners; proven if every job finished\n"
+		"  pareto SET [TIMEOUTSECS]\n"
+		"      crawl hex SET once, keeping every winner that isn't dominated\n"
+		"  meet SET [BACKLEN [TIMEOUTSECS]]\n"
+		"      crawl hex SET by meeting in the middle, joining forward halves to stored\n"
+		"      backward halves of BACKLEN numerals; default is a third of the states\n"
+		"  lds SET [STEP [TIMEOUTSECS]]\n"
+		"      crawl hex SET by limited discrepancy search, raising the limit on\n"
+		"      deviations from the preferred successor order by STEP per pass; default 1\n"
+		"  beam SET [WIDTH [TIMEOUTSECS]]\n"
+		"      approximate hex SET by beam search, keeping the best WIDTH partial paths\n"
+		"      at each depth; default 16384\n"
+		"  merge SET [FILE]\n"
+		"      build a cycle for hex SET without crawling, by merging a cover of short\n"
+		"      cycles; works for sets too large to crawl; writes winner to FILE if given\n"
+		"  best SET [NODES [MEGABYTES]]\n"
+		"      search hex SET best-first by lower bound, pruning admissibly only, within\n"
+		"      MEGABYTES of memory, default 256, then depth-first; stops after NODES nodes\n"
+		"      if given, with the best cycle so far; proven if the search finishes\n"
+		"  adjacent SET MODE [TIMEOUTSECS]\n"
+		"      crawl hex SET with each place's steps restricted by MODE: any, cyclic\n"
+		"      (next or previous value, wrapping), or a GRAPH of hex edges per place,\n"
+		"      places separated by slashes, e.g. 01,12,20/01,13; empty place is any\n"
+		"  window SET LEN MAX [TIMEOUTSECS]\n"
+		"      crawl hex SET, allowing each place at most MAX transitions within any\n"
+		"      LEN consecutive transitions, including windows that wrap around\n"
+		"  sweep NODES SET[,SET...] [IMBALANCES [MAXTRANS [LDSSTEPS [BEAMWIDTHS]]]]\n"
+		"      solve each hex SET with each combination of the given comma-separated\n"
+		"      pruning thresholds and search modes, in parallel, limiting each run to\n"
+		"      NODES nodes; writes BalaGraySweep.csv and shows best configuration per\n"
+		"      set; \"max\" means no threshold; defaults are 2,3,4 max 0 0\n"
+		"  portfolio SET [CONFIGS [TIMEOUTSECS [FIRSTSEED]]]\n"
+		"      crawl hex SET with CONFIGS successor orders at once, sharing one bound;\n"
+		"      default is one per core; reports which configuration found each improvement\n"
+		"  server SOCKET [CACHEFILE [MAXSOLVES]]\n"
+		"      answer solve requests on Unix domain SOCKET from a winner cache, default\n"
+		"      BalaGrayTable.dat, solving misses in the background, MAXSOLVES at once;\n"
+		"      default is one per core; see BalaGrayServer.h for the protocol\n"
+		"  bench [SET...]\n"
+		"      time the crawl's hot path kernels on sampled crawl states of each hex SET,\n"
+		"      comparing implementations; default sets are 234, 2224 and 22233\n"
+		"  bound [SET...]\n"
+		"      show lower bounds of each hex SET's metrics; a winner that meets them is\n"
+		"      optimal, so its crawl stops early; default is all crawlable interval sets\n"
+		"  certify [FILE [TIMEOUTSECS]]\n"
+		"      re-crawl each winner in FILE, default BalaGrayTable.dat, pruning only where\n"
+		"      no better cycle can exist, to prove it or find a better one; updates FILE,\n"
+		"      and the tables too if FILE is the default; TIMEOUTSECS is per winner\n"
+		"  verify FILE [FILE...]\n"
+		"      check that each winner in each FILE is a Gray cycle of its set's states,\n"
+		"      and recompute its metrics independently; fails if any winner is invalid\n"
+		"  pick FILE ORDER\n"
+		"      select best winner in FILE for ORDER, a string of objective letters\n"
+		"      in descending priority: i = imbalance, t = maxtrans, s = maxspan, d = stddev\n"
+	);
+}
+
+bool VerifyWinner(const CBalaGray::CWinner& winner)
+{
+	CBalaGrayVerify	verify;
+	CBalaGrayVerify::RESULT	result;
+	if (verify.Verify(winner, result))
+		return true;
+	std::ostringstream	ss;
+	CBalaGrayVerify::WriteErrors(ss, winner, result);
+	printf("%llX: invalid winner: %s\n", static_cast<unsigned long long>(winner.m_nSetCode), ss.str().c_str());
+	return false;
+}
+
+bool ShardCommand(int argc, const char* argv[])
+{
+	if (argc < 2) {
+		ShowUsage();
+		return false;
+	}
+	const char	*pszCmd = argv[0];
+	CBalaGrayShard	shard(argv[1]);
+	if (!strcmp(pszCmd, "plan")) {
+		if (argc < 4) {
+			ShowUsage();
+			return false;
+		}
+		CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[2], NULL, 16));
+		int	nPrefixLen = atoi(argv[3]);
+		CBalaGrayJobQueue::OPTIONS	opts;
+		GetDefaultOptions(nSetCode, opts);	// use batch's pruning threshold unless overridden
+		if (argc > 4)
+			opts.nPruneImbalance = atoi(argv[4]);
+		return shard.Plan(nSetCode, nPrefixLen, opts.nPruneImbalance, opts.nPruneMaxTrans);
+	} else if (!strcmp(pszCmd, "work")) {
+		unsigned int	nTimeoutMillis = argc > 2 ? atoi(argv[2]) * 1000 : 0;
+		return shard.Work(nTimeoutMillis);
+	} else if (!strcmp(pszCmd, "merge")) {
+		CBalaGray::CWinner	winner;
+		int	nFinished;
+		if (!shard.Merge(winner, nFinished))
+			return false;
+		if (!winner.m_arrNum.empty() && !VerifyWinner(winner))	// if merged winner is invalid
+			return false;
+		printf("%llX: %d of %d jobs finished, balance = %d, maxtrans = %d, maxspan = %d, proven = %d\n",
+			static_cast<unsigned long long>(shard.GetSetCode()), nFinished, shard.GetJobCount(), winner.m_nImbalance,
+			winner.m_nMaxTrans, winner.m_nMaxSpan, winner.m_bIsProven);
+		return true;
+	}
+	ShowUsage();
+	return false;
+}
+
+void PrintWinner(const CBalaGray::CWinner& winner)
+{
+	std::ostringstream	ss;
+	ss << std::fixed;	// same format as printf's %f
+	CBalaGray::WriteBalance(ss, winner);
+	printf("%s\n", ss.str().c_str());
+}
+
+bool ParetoCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGray::CWinnerArray	arrFront;
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	if (argc > 1)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[1]) * 1000;
+	opts.parrParetoFront = &arrFront;
+	CBalaGray::CWinner	winner = queue.Submit(nSetCode, opts)->Wait();
+	if (winner.m_arrNum.empty())	// if crawl failed
+		return false;
+	int	nPoints = static_cast<int>(arrFront.size());
+	printf("%llX: Pareto front has %d members, proven = %d\n", static_cast<unsigned long long>(nSetCode), nPoints, winner.m_bIsProven);
+	for (int iPoint = 0; iPoint < nPoints; iPoint++) {	// for each member of front
+		PrintWinner(arrFront[iPoint]);
+	}
+	char	szName[64];
+	sprintf(szName, "BalaGray %llX Pareto", static_cast<unsigned long long>(nSetCode));
+	std::string	sName(szName);
+	if (!arrFront.Write((sName + ".dat").c_str())) {
+		printf("can't write Pareto front\n");
+		return false;
+	}
+	MakeCSVTable(arrFront, (sName + ".csv").c_str());
+	return true;
+}
+
+bool MeetCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGraySets::SET_INFO	info;
+	CBalaGraySets::GetInfo(nSetCode, info);
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	opts.nMeetBackLen = argc > 1 ? atoi(argv[1]) : std::max(info.nStates / 3, 1);
+	if (argc > 2)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[2]) * 1000;
+	opts.bVerbose = true;
+	CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(nSetCode, opts);
+	CBalaGray::CWinner	winner = pJob->Wait();
+	if (winner.m_arrNum.empty())	// if crawl failed
+		return false;
+	printf("%llX: %llu nodes, proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		static_cast<unsigned long long>(pJob->GetNodeCount()), winner.m_bIsProven);
+	PrintWinner(winner);
+	return true;
+}
+
+bool VerifyCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGrayVerify	verify;
+	int	nTotal = 0;
+	int	nTotalInvalid = 0;
+	double	fTotalSeconds = 0;
+	for (int iFile = 0; iFile < argc; iFile++) {	// for each file
+		const char	*pszPath = argv[iFile];
+		CBalaGray::CWinnerArray	arrWin;
+		if (!arrWin.Read(pszPath)) {
+			printf("can't read winners from '%s'\n", pszPath);
+			return false;
+		}
+		CBalaGrayVerify::CResultArray	arrResult;
+		std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+		int	nInvalid = verify.Verify(arrWin, arrResult);
+		std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - tStart;
+		fTotalSeconds += dur.count();
+		int	nWinners = static_cast<int>(arrWin.size());
+		int	nEmpty = 0;
+		for (int iWin = 0; iWin < nWinners; iWin++) {	// for each winner
+			const CBalaGray::CWinner&	winner = arrWin[iWin];
+			if (CBalaGrayVerify::IsEmpty(winner)) {
+				nEmpty++;
+			} else if (arrResult[iWin].nErrors) {	// if winner is invalid
+				std::ostringstream	ss;
+				CBalaGrayVerify::WriteErrors(ss, winner, arrResult[iWin]);
+				printf("%s: winner %d (%llX): %s\n", pszPath, iWin, static_cast<unsigned long long>(winner.m_nSetCode), ss.str().c_str());
+			}
+		}
+		printf("%s: %d winners, %d invalid, %d empty\n", pszPath, nWinners, nInvalid, nEmpty);
+		nTotal += nWinners - nEmpty;
+		nTotalInvalid += nInvalid;
+	}
+	printf("verified %d winners in %.3f seconds (%.0f per second), %d invalid\n",
+		nTotal, fTotalSeconds, fTotalSeconds > 0 ? nTotal / fTotalSeconds : 0.0, nTotalInvalid);
+	return !nTotalInvalid;
+}
+
+bool DiscrepancyCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	opts.nDiscrepancyStep = argc > 1 ? std::max(atoi(argv[1]), 1) : 1;
+	if (argc > 2)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[2]) * 1000;
+	opts.bVerbose = true;
+	CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(nSetCode, opts);
+	CBalaGray::CWinner	winner = pJob->Wait();
+	if (winner.m_arrNum.empty())	// if crawl failed
+		return false;
+	printf("%llX: %llu nodes, proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		static_cast<unsigned long long>(pJob->GetNodeCount()), winner.m_bIsProven);
+	PrintWinner(winner);
+	return true;
+}
+
+bool BeamCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	opts.nBeamWidth = argc > 1 ? std::max(atoi(argv[1]), 1) : 16384;
+	if (argc > 2)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[2]) * 1000;
+	opts.bVerbose = true;
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(nSetCode, opts);
+	CBalaGray::CWinner	winner = pJob->Wait();
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - tStart;
+	if (winner.m_arrNum.empty())	// if crawl failed
+		return false;
+	printf("%llX: %llu nodes, %.3f s, proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		static_cast<unsigned long long>(pJob->GetNodeCount()), dur.count(), winner.m_bIsProven);
+	PrintWinner(winner);
+	return true;
+}
+
+bool MergeCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayMerge	merge;
+	CBalaGray::CWinner	winner;
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	if (!merge.Build(nSetCode, winner))
+		return false;
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - tStart;
+	const CBalaGrayMerge::STATS&	stats = merge.GetStats();
+	printf("%llX: %d states, %d cover cycles, %d merges, %d balancing switches, %.3f s\n",
+		static_cast<unsigned long long>(nSetCode), static_cast<int>(winner.m_arrNum.size()),
+		stats.nCoverCycles, stats.nMerges, stats.nBalanceSwitches, dur.count());
+	PrintWinner(winner);
+	if (!VerifyWinner(winner))	// shouldn't happen
+		return false;
+	if (argc > 1) {	// if output file specified
+		CBalaGray::CWinnerArray	arrWin;
+		arrWin.push_back(winner);
+		if (!arrWin.Write(argv[1])) {
+			printf("can't write winner to '%s'\n", argv[1]);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BestCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayBest	best;
+	if (argc > 1)	// if node limit specified
+		best.SetNodeLimit(strtoull(argv[1], NULL, 10));
+	if (argc > 2)	// if memory limit specified
+		best.SetMemoryLimit(static_cast<size_t>(std::max(atoi(argv[2]), 1)) << 20);
+	CBalaGray::CWinner	winner;
+	if (!best.Search(nSetCode, winner))
+		return false;
+	const CBalaGrayBest::STATS&	stats = best.GetStats();
+	printf("%llX: %llu nodes, %llu expanded, %d max open, %.1f MB, %d depth-first crawls, %.3f s, proven = %d\n",
+		static_cast<unsigned long long>(nSetCode), static_cast<unsigned long long>(stats.nNodes),
+		static_cast<unsigned long long>(stats.nExpanded), stats.nMaxOpen, stats.nMemory / 1048576.0,
+		stats.nCrawls, stats.fSeconds, winner.m_bIsProven);
+	if (winner.m_nImbalance == INT_MAX) {	// if no cycle found
+		printf("no cycle found\n");
+		return true;
+	}
+	PrintWinner(winner);
+	return VerifyWinner(winner);
+}
+
+bool AdjacentCommand(int argc, const char* argv[])
+{
+	if (argc < 2) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayJobQueue::OPTIONS	opts;
+	int	nAdjacency;
+	if (!strcmp(argv[1], "any")) {
+		nAdjacency = CBalaGray::ADJ_ANY;
+	} else if (!strcmp(argv[1], "cyclic")) {
+		nAdjacency = CBalaGray::ADJ_CYCLIC;
+	} else {	// custom graph
+		if (!CBalaGray::ParseAdjacency(argv[1], opts.arrAdjacency)) {
+			printf("invalid adjacency graph\n");
+			return false;
+		}
+		nAdjacency = CBalaGray::ADJ_CUSTOM;
+	}
+	nSetCode = CBalaGray::MakeVariant(nSetCode, nAdjacency);
+	if (!nSetCode) {	// if set leaves no room for variant byte
+		printf("restricted adjacency allows at most %d places\n", CBalaGray::MAX_VARIANT_PLACES);
+		return false;
+	}
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	GetDefaultOptions(nSetCode, opts);
+	if (argc > 2)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[2]) * 1000;
+	opts.bVerbose = true;
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(nSetCode, opts);
+	CBalaGray::CWinner	winner = pJob->Wait();
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - tStart;
+	if (winner.m_arrNum.empty())	// if crawl failed or no cycle exists
+		return false;
+	printf("%llX: %llu nodes, %.3f s, proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		static_cast<unsigned long long>(pJob->GetNodeCount()), dur.count(), winner.m_bIsProven);
+	PrintWinner(winner);
+	return true;
+}
+
+bool WindowCommand(int argc, const char* argv[])
+{
+	if (argc < 3) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayJobQueue	queue(1);	// one worker thread
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	opts.nWindowLen = atoi(argv[1]);
+	opts.nWindowMaxTrans = atoi(argv[2]);
+	if (opts.nWindowLen <= 0) {
+		printf("invalid balance window\n");
+		return false;
+	}
+	if (argc > 3)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[3]) * 1000;
+	opts.bVerbose = true;
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(nSetCode, opts);
+	CBalaGray::CWinner	winner = pJob->Wait();
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - tStart;
+	if (winner.m_arrNum.empty())	// if crawl failed
+		return false;
+	printf("%llX: %llu nodes, %.3f s, proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		static_cast<unsigned long long>(pJob->GetNodeCount()), dur.count(), winner.m_bIsProven);
+	if (winner.m_nImbalance == INT_MAX) {	// if no cycle fits window
+		printf("no cycle found within window\n");
+		return true;
+	}
+	printf("window max = %d\n", CBalaGray::GetWindowMaxTrans(winner, opts.nWindowLen));
+	PrintWinner(winner);
+	return true;
+}
+
+bool ParseIntList(const char *pszList, std::vector<int>& arrVal)
+{
+	// parse comma-separated decimal integers; "max" means no limit
+	arrVal.clear();
+	std::istringstream	ss(pszList);
+	std::string	sVal;
+	while (std::getline(ss, sVal, ',')) {	// for each value
+		if (sVal == "max") {
+			arrVal.push_back(INT_MAX);
+		} else {
+			char	*pEnd;
+			long	nVal = strtol(sVal.c_str(), &pEnd, 10);
+			if (sVal.empty() || *pEnd || nVal < 0 || nVal > INT_MAX)
+				return false;
+			arrVal.push_back(static_cast<int>(nVal));
+		}
+	}
+	return !arrVal.empty();
+}
+
+bool SweepCommand(int argc, const char* argv[])
+{
+	if (argc < 2) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGraySweep	sweep;
+	sweep.SetNodeLimit(strtoull(argv[0], NULL, 10));
+	CBalaGraySweep::CSetCodeArray	arrSet;
+	std::istringstream	ss(argv[1]);
+	std::string	sSet;
+	while (std::getline(ss, sSet, ',')) {	// for each set
+		arrSet.push_back(static_cast<CBalaGray::SET_CODE>(strtoull(sSet.c_str(), NULL, 16)));
+	}
+	sweep.SetSets(arrSet);
+	static const char *arrDefaultList[] = {"2,3,4", "max", "0", "0"};	// imbalance, maxtrans, LDS step, beam width
+	const int	nLists = _countof(arrDefaultList);
+	std::vector<int>	arrList[nLists];
+	for (int iList = 0; iList < nLists; iList++) {	// for each option list
+		const char	*pszList = argc > iList + 2 ? argv[iList + 2] : arrDefaultList[iList];
+		if (!ParseIntList(pszList, arrList[iList])) {
+			printf("invalid option list '%s'\n", pszList);
+			return false;
+		}
+	}
+	CBalaGraySweep::CConfigArray	arrConfig;
+	CBalaGraySweep::MakeGrid(arrList[0], arrList[1], arrList[2], arrList[3], arrConfig);
+	sweep.SetConfigs(arrConfig);
+	printf("%d sets, %d configurations\n", static_cast<int>(arrSet.size()), static_cast<int>(arrConfig.size()));
+	bool	bResult = sweep.Run();
+	sweep.Write("BalaGraySweep.csv");
+	printf("Set\tImbalance\tMaxTrans\tLDS\tBeam\tNodes\tProven\tBalance\n");
+	for (int iSet = 0; iSet < static_cast<int>(arrSet.size()); iSet++) {	// for each set
+		int	iBest = sweep.FindBestConfig(iSet);
+		const CBalaGraySweep::CONFIG&	config = arrConfig[iBest];
+		const CBalaGraySweep::RESULT&	result = sweep.GetResult(iSet, iBest);
+		std::ostringstream	ssBal;
+		ssBal << std::fixed;	// same format as printf's %f
+		CBalaGray::WriteBalance(ssBal, result.winner);
+		printf("%llX\t%s\t%s\t%d\t%d\t%llu\t%d\t%s\n", static_cast<unsigned long long>(arrSet[iSet]),
+			CBalaGraySweep::FormatOption(config.nPruneImbalance).c_str(), CBalaGraySweep::FormatOption(config.nPruneMaxTrans).c_str(),
+			config.nDiscrepancyStep, config.nBeamWidth,
+			static_cast<unsigned long long>(result.nNodes), result.winner.m_bIsProven, ssBal.str().c_str());
+	}
+	return bResult;
+}
+
+bool PortfolioCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGray::SET_CODE	nSetCode = static_cast<CBalaGray::SET_CODE>(strtoull(argv[0], NULL, 16));
+	CBalaGrayPortfolio	portfolio;
+	if (argc > 1)	// if configuration count specified
+		portfolio.SetConfigCount(atoi(argv[1]));
+	CBalaGrayJobQueue::OPTIONS	opts;
+	GetDefaultOptions(nSetCode, opts);
+	if (argc > 2)	// if timeout specified
+		opts.nTimeoutMillis = atoi(argv[2]) * 1000;
+	if (argc > 3)	// if first seed specified
+		portfolio.SetFirstSeed(static_cast<uint32_t>(strtoul(argv[3], NULL, 0)));
+	CBalaGray::CWinner	winner;
+	if (!portfolio.Solve(nSetCode, opts, winner))
+		return false;
+	const CBalaGrayPortfolio::CConfigArray&	arrConfig = portfolio.GetConfigs();
+	printf("Config\tSeed\tImproved\tBest\tLast\tNodes\tFinished\n");
+	for (int iConfig = 0; iConfig < static_cast<int>(arrConfig.size()); iConfig++) {	// for each configuration
+		const CBalaGrayPortfolio::CONFIG&	config = arrConfig[iConfig];
+		printf("%d\t%u\t%d\t%d\t%.3f\t%llu\t%d\n", iConfig, config.nSeed, config.nImprovements,
+			config.nGlobalImprovements, config.fLastSeconds, static_cast<unsigned long long>(config.nNodes), config.bFinished);
+	}
+	int	iBest = portfolio.GetBestConfig();
+	printf("%llX: best found by config %d (seed %u), proven = %d\n", static_cast<unsigned long long>(nSetCode),
+		iBest, iBest >= 0 ? arrConfig[iBest].nSeed : 0, winner.m_bIsProven);
+	PrintWinner(winner);
+	return true;
+}
+
+bool ServerCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	CBalaGrayServer	server(argc > 2 ? atoi(argv[2]) : 0);
+	server.SetCachePath(argc > 1 ? argv[1] : "BalaGrayTable.dat");
+	server.SetOptionsFunc([](CBalaGray::SET_CODE nSetCode, CBalaGrayJobQueue::OPTIONS& opts) {
+		GetDefaultOptions(nSetCode, opts);	// same timeouts and pruning as batch
+		opts.sLogPath.clear();	// no per-set log files
+		opts.bVerbose = false;
+	});
+	return server.Run(argv[0]);
+}
+
+bool BoundCommand(int argc, const char* argv[])
+{
+	std::vector<CBalaGray::SET_CODE>	arrSet;
+	for (int iArg = 0; iArg < argc; iArg++) {	// for each set argument
+		arrSet.push_back(static_cast<CBalaGray::SET_CODE>(strtoull(argv[iArg], NULL, 16)));
+	}
+	if (arrSet.empty()) {	// if no sets specified
+		CBalaGraySets::CSetInfoArray	arrInfo;
+		if (!CBalaGraySets().Generate(arrInfo))
+			return false;
+		for (const CBalaGraySets::SET_INFO& info : arrInfo) {	// for each interval set
+			if (info.IsCrawlable())
+				arrSet.push_back(info.nSetCode);
+		}
+	}
+	printf("Set\tImbalance\tMaxTrans\tMaxSpan\tStdDev\n");
+	CBalaGray	bg;
+	bool	bResult = true;
+	for (size_t iSet = 0; iSet < arrSet.size(); iSet++) {	// for each set
+		CBalaGray::LOWER_BOUND	bound;
+		if (!bg.CalcLowerBound(arrSet[iSet], bound)) {
+			bResult = false;
+			continue;
+		}
+		printf("%llX\t", static_cast<unsigned long long>(arrSet[iSet]));
+		if (bound.nImbalance == INT_MAX)	// if no feasible transition counts
+			printf("no cycle\n");
+		else
+			printf("%d\t%d\t%d\t%f\n", bound.nImbalance, bound.nMaxTrans, bound.nMaxSpan,
+				sqrt(static_cast<double>(bound.nDevSum) / bg.GetNumeralCount()));
+	}
+	return bResult;
+}
+
+bool CertifyCommand(int argc, const char* argv[])
+{
+	const char	*pszDefaultPath = "BalaGrayTable.dat";
+	const char	*pszPath = argc > 0 ? argv[0] : pszDefaultPath;
+	CBalaGray::CWinnerArray	arrSeq;
+	if (!arrSeq.Read(pszPath)) {
+		printf("can't read '%s'\n", pszPath);
+		return false;
+	}
+	CBalaGrayCertify	certify;
+	if (argc > 1)	// if timeout specified
+		certify.SetTimeout(atoi(argv[1]) * 1000);
+	int	arrCount[CBalaGrayCertify::CERTIFY_STATES] = {0};
+	printf("Set\tStatus\tJobs\tNodes\tSeconds\tBalance\n");
+	bool	bResult = true;
+	for (size_t iSeq = 0; iSeq < arrSeq.size(); iSeq++) {	// for each winner
+		CBalaGray::CWinner&	winner = arrSeq[iSeq];
+		if (winner.m_arrNum.empty() || winner.m_nImbalance == INT_MAX)	// if set has no winner
+			continue;
+		CBalaGrayCertify::RESULT	result;
+		if (!certify.Certify(winner, result)) {
+			bResult = false;
+			continue;
+		}
+		if (result.nStatus == CBalaGrayCertify::CS_UNFINISHED)	// if unfinished
+			winner.m_bIsProven = false;	// keep winner, but don't claim it's proven
+		else	// winner or its improvement is proven
+			winner = result.winBest;
+		arrCount[result.nStatus]++;
+		std::ostringstream	ss;
+		ss << std::fixed;	// same format as printf's %f
+		CBalaGray::WriteBalance(ss, winner);
+		printf("%llX\t%s\t%d\t%llu\t%.3f\t%s\n", static_cast<unsigned long long>(winner.m_nSetCode),
+			CBalaGrayCertify::GetStatusName(result.nStatus), result.nJobs,
+			static_cast<unsigned long long>(result.nNodes), result.fSeconds, ss.str().c_str());
+	}
+	printf("%d proven, %d improved, %d unfinished\n", arrCount[CBalaGrayCertify::CS_PROVEN],
+		arrCount[CBalaGrayCertify::CS_IMPROVED], arrCount[CBalaGrayCertify::CS_UNFINISHED]);
+	if (!arrSeq.Write(pszPath)) {
+		printf("can't write '%s'\n", pszPath);
+		return false;
+	}
+	if (!strcmp(pszPath, pszDefaultPath))	// if default table data
+		MakeTables(arrSeq);
+	return bResult;
+}
+
+bool BenchCommand(int argc, const char* argv[])
+{
+	static const CBalaGray::SET_CODE	arrDefaultSet[] = {0x234, 0x2224, 0x22233};	// representative sets
+	std::vector<CBalaGray::SET_CODE>	arrSet;
+	for (int iArg = 0; iArg < argc; iArg++) {	// for each set argument
+		arrSet.push_back(static_cast<CBalaGray::SET_CODE>(strtoull(argv[iArg], NULL, 16)));
+	}
+	if (arrSet.empty())	// if no sets specified
+		arrSet.assign(arrDefaultSet, arrDefaultSet + _countof(arrDefaultSet));
+	bool	bHasCycles = CBalaGrayBench::HasCycleCounter();
+	printf("Set\tSamples\tKernel\tVariant\tOps\tns/op\t%s\n", bHasCycles ? "cycles/op" : "");
+	bool	bResult = true;
+	for (size_t iSet = 0; iSet < arrSet.size(); iSet++) {	// for each set
+		CBalaGray::SET_CODE	nSetCode = arrSet[iSet];
+		CBalaGrayJobQueue::OPTIONS	opts;
+		GetDefaultOptions(nSetCode, opts);	// sample the states that the batch would crawl
+		CBalaGrayBench	bench;
+		bench.SetPruneImbalance(opts.nPruneImbalance);
+		if (!bench.Run(nSetCode))
+			bResult = false;
+		const CBalaGrayBench::CResultArray&	arrResult = bench.GetResults();
+		for (size_t iRes = 0; iRes < arrResult.size(); iRes++) {	// for each kernel implementation
+			const CBalaGrayBench::RESULT&	res = arrResult[iRes];
+			printf("%llX\t%d\t%s\t%s\t%llu\t%.3f", static_cast<unsigned long long>(nSetCode), bench.GetSampleCount(),
+				res.pszKernel, res.pszVariant, static_cast<unsigned long long>(res.nOps), res.fNanosPerOp);
+			if (bHasCycles)
+				printf("\t%.2f", res.fCyclesPerOp);
+			printf("\n");
+		}
+	}
+	return bResult;
+}
+
+bool PickCommand(int argc, const char* argv[])
+{
+	if (argc < 2) {
+		ShowUsage();
+		return false;
+	}
+	static const char	arrObjectiveLetter[CBalaGray::OBJECTIVES + 1] = "itsd";	// in objective enum order
+	int	arrObjective[CBalaGray::OBJECTIVES];
+	int	nObjectives = 0;
+	for (const char *pszOrder = argv[1]; *pszOrder; pszOrder++) {	// for each letter of order
+		const char	*pLetter = strchr(arrObjectiveLetter, *pszOrder);
+		if (pLetter == NULL || nObjectives >= CBalaGray::OBJECTIVES) {
+			printf("invalid order '%s'\n", argv[1]);
+			return false;
+		}
+		arrObjective[nObjectives++] = static_cast<int>(pLetter - arrObjectiveLetter);
+	}
+	CBalaGray::CWinnerArray	arrWin;
+	if (!arrWin.Read(argv[0])) {
+		printf("can't read winners from '%s'\n", argv[0]);
+		return false;
+	}
+	int	iBest = arrWin.FindBest(arrObjective, nObjectives);
+	if (iBest < 0) {	// if file has no winners
+		printf("no winners in '%s'\n", argv[0]);
+		return false;
+	}
+	const CBalaGray::CWinner&	winner = arrWin[iBest];
+	printf("%llX: winner %d of %d, ", static_cast<unsigned long long>(winner.m_nSetCode), iBest, static_cast<int>(arrWin.size()));
+	PrintWinner(winner);
+	for (int iPlace = 0; iPlace < winner.m_nPlaces; iPlace++) {	// for each place
+		for (int iNum = 0; iNum < static_cast<int>(winner.m_arrNum.size()); iNum++) {	// for each numeral
+			printf("%d ", winner.m_arrNum[iNum].b[iPlace]);
+		}
+		printf("\n");
+	}
+	return true;
+}
+
+bool GetSetBounds(int argc, const char* argv[], CBalaGraySets& sets)
+{
+	if (argc > 0)	// if range specified
+		sets.SetMaxRange(atoi(argv[0]));
+	int	nMinPlaces = argc > 1 ? atoi(argv[1]) : 2;
+	int	nMaxPlaces = argc > 2 ? atoi(argv[2]) : CBalaGray::MAX_PLACES;
+	if (nMinPlaces > nMaxPlaces || nMaxPlaces < 2) {
+		printf("invalid place bounds\n");
+		return false;
+	}
+	sets.SetPlaceBounds(nMinPlaces, nMaxPlaces);
+	return true;
+}
+
+bool SetsCommand(int argc, const char* argv[])
+{
+	CBalaGraySets	sets;
+	if (!GetSetBounds(argc, argv, sets))
+		return false;
+	CBalaGraySets::CSetInfoArray	arrSet;
+	if (!sets.Generate(arrSet))
+		return false;
+	printf("Set\tPlaces\tRange\tStates\tDegree\tCost\n");
+	for (const CBalaGraySets::SET_INFO& info : arrSet) {	// for each set
+		printf("%llX\t%d\t%d\t%d\t%d\t%.0f%s\n", static_cast<unsigned long long>(info.nSetCode),
+			info.nPlaces, info.nRange, info.nStates, info.nDegree, info.fCost, info.IsCrawlable() ? "" : "\ttoo many states");
+	}
+	printf("%d sets\n", static_cast<int>(arrSet.size()));
+	return true;
+}
+
+bool AllCommand(int argc, const char* argv[])
+{
+	CBalaGraySets	sets;
+	if (!GetSetBounds(argc, argv, sets))
+		return false;
+	return CalcAllSets(sets);
+}
+
+bool BudgetCommand(int argc, const char* argv[])
+{
+	if (argc < 1) {
+		ShowUsage();
+		return false;
+	}
+	double	fBudgetSeconds = atof(argv[0]);
+	if (fBudgetSeconds <= 0) {
+		printf("invalid budget\n");
+		return false;
+	}
+	CBalaGraySets	sets;
+	if (!GetSetBounds(argc - 1, argv + 1, sets))
+		return false;
+	return CalcAllSets(sets, fBudgetSeconds);
+}
+
+bool RunCommand(int argc, const char* argv[])
+{
+	const char	*pszCmd = argv[0];
+	if (!strcmp(pszCmd, "all")) {
+		return AllCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "budget")) {
+		return BudgetCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "sets")) {
+		return SetsCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "shard")) {
+		return ShardCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "pareto")) {
+		return ParetoCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "meet")) {
+		return MeetCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "lds")) {
+		return DiscrepancyCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "beam")) {
+		return BeamCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "merge")) {
+		return MergeCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "best")) {
+		return BestCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "adjacent")) {
+		return AdjacentCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "window")) {
+		return WindowCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "sweep")) {
+		return SweepCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "portfolio")) {
+		return PortfolioCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "server")) {
+		return ServerCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "bound")) {
+		return BoundCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "certify")) {
+		return CertifyCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "bench")) {
+		return BenchCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "verify")) {
+		return VerifyCommand(argc - 1, argv + 1);
+	} else if (!strcmp(pszCmd, "pick")) {
+		return PickCommand(argc - 1, argv + 1);
+	}
+	ShowUsage();
+	return false;
+}
+
+int main(int argc, const char* argv[])
+{
+	if (argc > 1)	// if command specified
+		return RunCommand(argc - 1, argv + 1) ? 0 : 1;
+//	TestCalc();
+//	CBalaGray::CWinnerArray arrSeq; CalcWithTimeout(0x444, arrSeq);
+	return CalcAllSets(CBalaGraySets()) ? 0 : 1;	// default bounds reproduce IntervalSetsList.h
+}
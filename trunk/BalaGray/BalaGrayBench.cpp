@@ -0,0 +1,349 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBench.cpp : microbenchmarks for the crawl's hot path kernels.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayBench.h"
+#include "BalaGrayVerify.h"
+#include <sstream>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>	// for __rdtsc
+#define BENCH_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>	// for __rdtsc
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0	// cycles aren't reported
+#endif
+
+CBalaGrayBench::CBalaGrayBench()
+{
+	m_nMaxSamples = DEFAULT_SAMPLES;
+	m_nMinMillis = DEFAULT_MIN_MILLIS;
+	m_nPruneImbalance = CBalaGray::PRUNE_IMBALANCE;
+	m_nSink = 0;
+}
+
+bool CBalaGrayBench::HasCycleCounter()
+{
+	return BENCH_HAS_TSC != 0;
+}
+
+uint64_t CBalaGrayBench::ReadCycleCounter()
+{
+	// Time stamp counter ticks at a constant reference rate on modern CPUs,
+	// so ticks approximate core cycles only if the core runs at that rate.
+#if BENCH_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+void CBalaGrayBench::RebuildStacks()
+{
+	// Rebuild each sample's crawl stack, as the crawl left it when the sample
+	// was taken, along with the transitioned places and the span policy state
+	// that the kernels consume.
+	int	nSamples = GetSampleCount();
+	m_arrStack.resize(nSamples);
+	m_arrTransPlace.resize(nSamples);
+	m_arrLeafObj.resize(nSamples);
+	for (int iSample = 0; iSample < nSamples; iSample++) {	// for each sample
+		const CPlaceArray&	arrPrefix = m_arrSample[iSample];
+		int	nDepths = static_cast<int>(arrPrefix.size());
+		CStateArray&	arrState = m_arrStack[iSample];
+		arrState.resize(nDepths);
+		for (int iDepth = 0; iDepth < nDepths; iDepth++) {	// for each depth
+			arrState[iDepth].iNum = arrPrefix[iDepth];
+			arrState[iDepth].iGray = 0;
+			arrState[iDepth].nTrans.Zero();
+		}
+		m_bg.m_arrState.swap(arrState);	// kernels read crawler's stack
+		CPlaceArray&	arrPlace = m_arrTransPlace[iSample];
+		arrPlace.resize(nDepths);
+		arrPlace[0] = 0;
+		for (int iDepth = 1; iDepth < nDepths; iDepth++) {	// for each depth after origin
+			int	nMaxTrans;
+			NUMERAL	nTransCounts;
+			m_bg.ComputeBalanceScalar(iDepth, nMaxTrans, nTransCounts);
+			m_bg.m_arrState[iDepth].nTrans = nTransCounts;	// as crawl saves them before descending
+			arrPlace[iDepth] = static_cast<CBalaGray::PLACE>(m_bg.GetTransPlace(iDepth));
+		}
+		m_bg.m_arrState.swap(arrState);
+		CObjective&	obj = m_arrLeafObj[iSample];
+		obj.Init(m_bg.m_nPlaces, m_bg.GetNumeralCount());
+		for (int iDepth = 1; iDepth < nDepths - 1; iDepth++) {	// for each depth before last
+			obj.Push(iDepth, arrPlace[iDepth]);
+		}
+	}
+}
+
+template<class PASS> void CBalaGrayBench::Measure(const char *pszKernel, const char *pszVariant, PASS fnPass)
+{
+	RESULT	res;
+	res.pszKernel = pszKernel;
+	res.pszVariant = pszVariant;
+	res.nChecksum = fnPass(res.nOps);	// warm up caches and branch predictors
+	int	nPasses = 0;
+	uint64_t	nOps;
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	uint64_t	nStartTicks = ReadCycleCounter();
+	std::chrono::duration<double>	dur;
+	do {
+		m_nSink += fnPass(nOps);
+		nPasses++;
+		dur = std::chrono::steady_clock::now() - tStart;
+	} while (dur.count() * 1000 < m_nMinMillis);
+	uint64_t	nTicks = ReadCycleCounter() - nStartTicks;
+	double	fOps = static_cast<double>(res.nOps) * nPasses;
+	res.fNanosPerOp = fOps ? dur.count() * 1e9 / fOps : 0;
+	res.fCyclesPerOp = fOps ? nTicks / fOps : 0;
+	m_arrResult.push_back(res);
+}
+
+template<bool SCALAR> uint64_t CBalaGrayBench::PassBalance(uint64_t& nOps)
+{
+	uint64_t	nSum = 0;
+	nOps = 0;
+	int	nSamples = GetSampleCount();
+	int	iLastPlace = m_bg.m_nPlaces - 1;
+	for (int iSample = 0; iSample < nSamples; iSample++) {	// for each sample
+		m_bg.m_arrState.swap(m_arrStack[iSample]);	// kernel reads crawler's stack
+		int	nDepths = static_cast<int>(m_bg.m_arrState.size());
+		for (int iDepth = 1; iDepth < nDepths; iDepth++) {	// for each depth after origin
+			int	nMaxTrans;
+			NUMERAL	nTransCounts;
+			int	nImbalance;
+			if (SCALAR)
+				nImbalance = m_bg.ComputeBalanceScalar(iDepth, nMaxTrans, nTransCounts);
+			else
+				nImbalance = m_bg.ComputeBalance(iDepth, nMaxTrans, nTransCounts);
+			nSum += (nImbalance << 16) + (nMaxTrans << 8) + (nTransCounts.b[0] ^ nTransCounts.b[iLastPlace]);
+		}
+		nOps += nDepths - 1;
+		m_bg.m_arrState.swap(m_arrStack[iSample]);
+	}
+	return nSum;
+}
+
+template<bool SCALAR> uint64_t CBalaGrayBench::PassGray(uint64_t& nOps) const
+{
+	// Test each sampled numeral against its predecessor, which is Gray, and
+	// against the numeral two steps back, which usually isn't, so that both
+	// outcomes are exercised.
+	uint64_t	nSum = 0;
+	nOps = 0;
+	const CBalaGray::CNumeralArray&	arrNum = m_bg.m_arrNum;
+	for (const CPlaceArray& arrPrefix : m_arrSample) {	// for each sample
+		int	nDepths = static_cast<int>(arrPrefix.size());
+		for (int iDepth = 2; iDepth < nDepths; iDepth++) {	// for each depth with two predecessors
+			const NUMERAL&	numCur = arrNum[arrPrefix[iDepth]];
+			if (SCALAR) {
+				nSum += m_bg.IsGrayScalar(arrNum[arrPrefix[iDepth - 1]], numCur);
+				nSum += m_bg.IsGrayScalar(arrNum[arrPrefix[iDepth - 2]], numCur) << 8;
+			} else {
+				nSum += m_bg.IsGray(arrNum[arrPrefix[iDepth - 1]], numCur);
+				nSum += m_bg.IsGray(arrNum[arrPrefix[iDepth - 2]], numCur) << 8;
+			}
+		}
+		if (nDepths > 2)
+			nOps += (nDepths - 2) * 2;
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassPack(uint64_t& nOps) const
+{
+	uint64_t	nSum = 0;
+	nOps = 0;
+	const CBalaGray::CNumeralArray&	arrNum = m_bg.m_arrNum;
+	for (const CPlaceArray& arrPrefix : m_arrSample) {	// for each sample
+		for (CBalaGray::PLACE iNum : arrPrefix) {	// for each numeral
+			nSum += m_bg.Pack(arrNum[iNum]);
+		}
+		nOps += arrPrefix.size();
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassUnpack(uint64_t& nOps) const
+{
+	uint64_t	nSum = 0;
+	nOps = 0;
+	int	iLastPlace = m_bg.m_nPlaces - 1;
+	for (const CPlaceArray& arrPrefix : m_arrSample) {	// for each sample
+		for (CBalaGray::PLACE iNum : arrPrefix) {	// for each numeral
+			NUMERAL	num = m_bg.Unpack(iNum);
+			nSum += (num.b[0] << 8) + num.b[iLastPlace];
+		}
+		nOps += arrPrefix.size();
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassNumeralTable(uint64_t& nOps) const
+{
+	// same as PassUnpack, but via the crawler's numeral table, as the crawl does
+	uint64_t	nSum = 0;
+	nOps = 0;
+	int	iLastPlace = m_bg.m_nPlaces - 1;
+	const CBalaGray::CNumeralArray&	arrNum = m_bg.m_arrNum;
+	for (const CPlaceArray& arrPrefix : m_arrSample) {	// for each sample
+		for (CBalaGray::PLACE iNum : arrPrefix) {	// for each numeral
+			const NUMERAL&	num = arrNum[iNum];
+			nSum += (num.b[0] << 8) + num.b[iLastPlace];
+		}
+		nOps += arrPrefix.size();
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassSuccessor(uint64_t& nOps) const
+{
+	// For each depth of each sample, look up every Gray successor of the
+	// previous numeral and test it against the branch's used numerals, as
+	// the crawl's inner loop does, then mark the sampled numeral as used.
+	uint64_t	nSum = 0;
+	nOps = 0;
+	int	nGraySuccessors = m_bg.m_nGraySuccessors;
+	int	nGrayStrideShift = m_bg.m_nGrayStrideShift;
+	const CBalaGray::PLACE	*pGraySuccessor = m_bg.m_arrGraySuccessor.data();
+	for (const CPlaceArray& arrPrefix : m_arrSample) {	// for each sample
+		uint64_t	nNumeralUsedMask[2] = {1, 0};	// origin is used
+		int	nDepths = static_cast<int>(arrPrefix.size());
+		for (int iDepth = 1; iDepth < nDepths; iDepth++) {	// for each depth after origin
+			int	iPrevNum = arrPrefix[iDepth - 1];
+			for (int iGray = 0; iGray < nGraySuccessors; iGray++) {	// for each Gray successor
+				int	iNum = pGraySuccessor[(iPrevNum << nGrayStrideShift) + iGray];
+				int	iUsedMask = iNum >= CBalaGray::ULONGLONG_BITS;
+				uint64_t	nNumeralMask = 1ull << (iNum & (CBalaGray::ULONGLONG_BITS - 1));
+				nSum += !(nNumeralUsedMask[iUsedMask] & nNumeralMask);	// count unused successors
+			}
+			int	iNum = arrPrefix[iDepth];
+			nNumeralUsedMask[iNum >= CBalaGray::ULONGLONG_BITS] |= 1ull << (iNum & (CBalaGray::ULONGLONG_BITS - 1));
+		}
+		if (nDepths > 1)
+			nOps += static_cast<uint64_t>(nDepths - 1) * nGraySuccessors;
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassSpanPush(uint64_t& nOps) const
+{
+	// Push each sample's transitions onto the span policy and pop them again,
+	// as the crawl does on descending and backtracking. Push incrementally
+	// updates maximum span length and sum of squared deviations.
+	uint64_t	nSum = 0;
+	nOps = 0;
+	CObjective	obj;
+	obj.Init(m_bg.m_nPlaces, m_bg.GetNumeralCount());
+	int	nSamples = GetSampleCount();
+	for (int iSample = 0; iSample < nSamples; iSample++) {	// for each sample
+		const CPlaceArray&	arrPlace = m_arrTransPlace[iSample];
+		int	nDepths = static_cast<int>(arrPlace.size());
+		for (int iDepth = 1; iDepth < nDepths; iDepth++) {	// for each depth after origin
+			obj.Push(iDepth, arrPlace[iDepth]);
+		}
+		int	arrKey[CObjective::KEYS];
+		obj.GetBound(nDepths - 1, arrKey);
+		nSum += arrKey[0];
+		for (int iDepth = nDepths - 1; iDepth >= 1; iDepth--) {	// for each depth after origin, in reverse
+			obj.Pop(iDepth);
+		}
+		nOps += nDepths - 1;
+	}
+	return nSum;
+}
+
+uint64_t CBalaGrayBench::PassSpanLeaf(uint64_t& nOps) const
+{
+	// Score each sample as if its last numeral completed the permutation;
+	// this closes the open spans, computing maximum span length and sum of
+	// squared deviations, from which standard deviation is derived.
+	uint64_t	nSum = 0;
+	int	nSamples = GetSampleCount();
+	for (int iSample = 0; iSample < nSamples; iSample++) {	// for each sample
+		const CPlaceArray&	arrPrefix = m_arrSample[iSample];
+		int	iDepth = static_cast<int>(arrPrefix.size()) - 1;
+		int	arrScore[CObjective::SCORES];
+		m_arrLeafObj[iSample].GetLeafScore(iDepth, m_arrTransPlace[iSample][iDepth], m_bg.m_arrNum[arrPrefix[iDepth]], arrScore);
+		for (int iScore = 0; iScore < CObjective::SCORES; iScore++) {	// for each score
+			nSum = nSum * 31 + arrScore[iScore];
+		}
+	}
+	nOps = nSamples;
+	return nSum;
+}
+
+bool CBalaGrayBench::Run(SET_CODE nSetCode)
+{
+	// sample crawl states; the sampler cancels the crawl once it has enough
+	m_arrSample.clear();
+	m_arrResult.clear();
+	m_bg.Reset();
+	m_bg.SetVerbose(false);
+	m_bg.SetPruneImbalance(m_nPruneImbalance);
+	m_bg.SetStateSampler(&m_arrSample, m_nMaxSamples);
+	CBalaGray::CWinner	winner;
+	bool	bResult = m_bg.CalcFromCode(nSetCode, winner);
+	m_bg.SetStateSampler(NULL, 0);
+	if (!bResult)	// if invalid set
+		return false;
+	// the sampled states are only meaningful if the crawl that visited them
+	// is sound, so check any winner it found before it was canceled
+	if (!CBalaGrayVerify::IsEmpty(winner)) {	// if crawl found a cycle
+		CBalaGrayVerify	verify;
+		CBalaGrayVerify::RESULT	result;
+		if (!verify.Verify(winner, result)) {	// if winner is invalid
+			std::ostringstream	ss;
+			CBalaGrayVerify::WriteErrors(ss, winner, result);
+			printf("%llX: invalid winner: %s\n", static_cast<unsigned long long>(nSetCode), ss.str().c_str());
+			return false;
+		}
+	}
+	if (m_arrSample.empty()) {	// if crawl ended before first sample
+		printf("crawl of %llX is too short to sample\n", static_cast<unsigned long long>(nSetCode));
+		return false;
+	}
+	RebuildStacks();
+	// time each kernel implementation; the crawler's own choice comes first
+#if NUMERAL_SSE2
+	Measure("balance", "SSE2", [this](uint64_t& nOps) { return PassBalance<false>(nOps); });
+#endif
+	Measure("balance", "scalar", [this](uint64_t& nOps) { return PassBalance<true>(nOps); });
+#if NUMERAL_SSE2
+	Measure("gray", "SSE2", [this](uint64_t& nOps) { return PassGray<false>(nOps); });
+#endif
+	Measure("gray", "scalar", [this](uint64_t& nOps) { return PassGray<true>(nOps); });
+	Measure("pack", "computed", [this](uint64_t& nOps) { return PassPack(nOps); });
+	Measure("unpack", "table", [this](uint64_t& nOps) { return PassNumeralTable(nOps); });
+	Measure("unpack", "computed", [this](uint64_t& nOps) { return PassUnpack(nOps); });
+	Measure("successor", "table", [this](uint64_t& nOps) { return PassSuccessor(nOps); });
+	Measure("span push", "incremental", [this](uint64_t& nOps) { return PassSpanPush(nOps); });
+	Measure("span leaf", "incremental", [this](uint64_t& nOps) { return PassSpanLeaf(nOps); });
+	// verify that implementations of each kernel agree
+	bool	bAgree = true;
+	for (size_t iRes = 1; iRes < m_arrResult.size(); iRes++) {	// for each result after first
+		const RESULT&	res = m_arrResult[iRes];
+		const RESULT&	resPrev = m_arrResult[iRes - 1];
+		if (!strcmp(res.pszKernel, resPrev.pszKernel) && res.nChecksum != resPrev.nChecksum) {
+			printf("%s: %s and %s disagree\n", res.pszKernel, resPrev.pszVariant, res.pszVariant);
+			bAgree = false;
+		}
+	}
+	return bAgree;
+}
@@ -0,0 +1,97 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBench.h : microbenchmarks for the crawl's hot path kernels.
+//
+// Crawls a set briefly, sampling the crawl stack periodically, and then
+// times each kernel on the sampled states: balance, Gray test, numeral
+// packing and unpacking, successor lookup with used mask test, and the
+// span policy's incremental update and leaf scoring, which compute the
+// maximum span and standard deviation. Where a kernel has several
+// implementations, e.g. SSE2 and scalar, each is timed, and their results
+// are checksummed to verify that they agree. Times are reported per kernel
+// call, in nanoseconds and in time stamp counter ticks where available.
+// The sampling crawl's winner, if it found one before it was canceled, is
+// checked by the independent verifier.
+
+#pragma once
+
+#include "BalaGray.h"
+
+class CBalaGrayBench {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	struct RESULT {	// timing of one kernel implementation
+		const char	*pszKernel;		// name of kernel
+		const char	*pszVariant;	// name of implementation
+		uint64_t	nOps;			// kernel calls per pass over samples
+		double	fNanosPerOp;		// wall time per kernel call, in nanoseconds
+		double	fCyclesPerOp;		// time stamp counter ticks per kernel call, or zero if unavailable
+		uint64_t	nChecksum;		// combined kernel results; implementations of a kernel must agree
+	};
+	typedef std::vector<RESULT> CResultArray;
+
+// Constants
+	enum {
+		DEFAULT_SAMPLES = 256,		// default number of crawl states to sample
+		DEFAULT_MIN_MILLIS = 100,	// default minimum timing per implementation, in milliseconds
+	};
+
+// Construction
+	CBalaGrayBench();
+
+// Attributes
+	void	SetSampleCount(int nSamples) { m_nMaxSamples = nSamples; }
+	void	SetMinMillis(int nMillis) { m_nMinMillis = nMillis; }
+	void	SetPruneImbalance(int nThreshold) { m_nPruneImbalance = nThreshold; }
+	int		GetSampleCount() const { return static_cast<int>(m_arrSample.size()); }
+	const CResultArray&	GetResults() const { return m_arrResult; }
+	static	bool	HasCycleCounter();
+
+// Operations
+	bool	Run(SET_CODE nSetCode);
+
+protected:
+// Types
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CPlaceArray CPlaceArray;
+	typedef CBalaGray::CStateArray CStateArray;
+	typedef CBalaGray::CObjective CObjective;
+	typedef std::vector<CObjective> CObjectiveArray;
+
+// Member data
+	int		m_nMaxSamples;		// number of crawl states to sample
+	int		m_nMinMillis;		// minimum timing per implementation, in milliseconds
+	int		m_nPruneImbalance;	// sampling crawl's imbalance threshold
+	CBalaGray	m_bg;			// crawler whose tables and kernels are measured
+	CBalaGray::CPrefixArray	m_arrSample;	// sampled crawl states, as numeral indices from origin
+	std::vector<CStateArray>	m_arrStack;	// crawl stack rebuilt from each sample
+	std::vector<CPlaceArray>	m_arrTransPlace;	// place that transitioned at each depth of each sample
+	CObjectiveArray	m_arrLeafObj;	// span policy of each sample, updated up to its next to last depth
+	CResultArray	m_arrResult;	// timing of each kernel implementation
+	uint64_t	m_nSink;		// accumulates kernel results, so optimizer can't remove them
+
+// Helpers
+	void	RebuildStacks();
+	template<class PASS> void	Measure(const char *pszKernel, const char *pszVariant, PASS fnPass);
+	template<bool SCALAR> uint64_t	PassBalance(uint64_t& nOps);
+	template<bool SCALAR> uint64_t	PassGray(uint64_t& nOps) const;
+	uint64_t	PassPack(uint64_t& nOps) const;
+	uint64_t	PassUnpack(uint64_t& nOps) const;
+	uint64_t	PassNumeralTable(uint64_t& nOps) const;
+	uint64_t	PassSuccessor(uint64_t& nOps) const;
+	uint64_t	PassSpanPush(uint64_t& nOps) const;
+	uint64_t	PassSpanLeaf(uint64_t& nOps) const;
+	static	uint64_t	ReadCycleCounter();
+};
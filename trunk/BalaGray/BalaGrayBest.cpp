@@ -0,0 +1,283 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBest.cpp : memory-bounded best-first search.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayBest.h"
+#include "BalaGrayMerge.h"
+#include <chrono>
+#include <algorithm>
+
+CBalaGrayBest::CBalaGrayBest()
+{
+	m_nMemoryLimit = static_cast<size_t>(DEFAULT_MEMORY_MB) << 20;
+	m_nNodeLimit = 0;
+	m_bProof = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(&m_lbound, 0, sizeof(m_lbound));
+	m_nGrayWrapMask = 0;
+	for (int iBound = 0; iBound < BOUNDS; iBound++) {	// for each bound
+		m_arrBest[iBound] = INT_MAX;
+	}
+}
+
+bool CBalaGrayBest::IsBoundBetter(const int *parrBound1, const int *parrBound2)
+{
+	// compare metrics in lexicographic order, as the crawler does; ties aren't better
+	for (int iBound = 0; iBound < BOUNDS; iBound++) {	// for each bound
+		if (parrBound1[iBound] != parrBound2[iBound])
+			return parrBound1[iBound] < parrBound2[iBound];
+	}
+	return false;
+}
+
+bool CBalaGrayBest::NODE_ORDER::operator()(const NODE& node1, const NODE& node2) const
+{
+	// true if first node is less promising; bounds come first, then depth, then current balance
+	for (int iBound = 0; iBound < BOUNDS; iBound++) {	// for each bound
+		if (node1.arrBound[iBound] != node2.arrBound[iBound])
+			return node1.arrBound[iBound] > node2.arrBound[iBound];
+	}
+	if (node1.iDepth != node2.iDepth)
+		return node1.iDepth < node2.iDepth;
+	return node1.nImbalance > node2.nImbalance;
+}
+
+void CBalaGrayBest::GetPath(int iLink, int iDepth)
+{
+	// recover path's numerals from history, last numeral first
+	for (int iLevel = iDepth; iLevel >= 0; iLevel--) {	// for each of path's levels
+		const LINK&	link = m_arrLink[iLink];
+		m_arrPath[iLevel] = link.iNum;
+		iLink = link.iParent;
+	}
+}
+
+void CBalaGrayBest::OnWinner(const CWinner& winner)
+{
+	if (winner.IsBetterThan(m_winBest)) {	// if winner improves on best
+		m_winBest = winner;
+		m_arrBest[0] = winner.m_nImbalance;
+		m_arrBest[1] = winner.m_nMaxTrans;
+		int	arrScore[CObjective::SCORES];
+		CObjective::LoadScore(winner, arrScore);
+		memcpy(&m_arrBest[2], arrScore, CObjective::KEYS * sizeof(int));
+	}
+}
+
+void CBalaGrayBest::Expand(const NODE& node)
+{
+	const CBalaGray&	bg = m_bg;
+	int	nPlaces = bg.m_nPlaces;
+	int	nNumerals = bg.GetNumeralCount();
+	int	nGraySuccessors = bg.m_nGraySuccessors;
+	int	iDepth = node.iDepth;
+	m_stats.nExpanded++;
+	// replay path into objective policy's state
+	GetPath(node.iLink, iDepth);
+	m_obj.Init(nPlaces, nNumerals);
+	for (int iLevel = 1; iLevel <= iDepth; iLevel++) {	// for each of path's levels after origin
+		const NUMERAL&	numPrev = bg.m_arrNum[m_arrPath[iLevel - 1]];
+		const NUMERAL&	numCur = bg.m_arrNum[m_arrPath[iLevel]];
+		int	iPlace = 0;
+		while (iPlace < nPlaces - 1 && numCur.b[iPlace] == numPrev.b[iPlace])
+			iPlace++;
+		m_obj.Push(iLevel, iPlace);
+	}
+	// if every successor of origin is used, path can't wrap around; see crawler's wrap prediction
+	if ((node.arrUsedMask[0] & m_nGrayWrapMask) == m_nGrayWrapMask) {
+		m_stats.nNodes += nGraySuccessors;
+		return;
+	}
+	// final max transition count is at least the mean, rounded up
+	int	nMeanTrans = (nNumerals + nPlaces - 1) / nPlaces;
+	int	iChildDepth = iDepth + 1;
+	for (int iGray = 0; iGray < nGraySuccessors; iGray++) {	// for each Gray successor
+		m_stats.nNodes++;
+		int	iSucc = (node.iNum << bg.m_nGrayStrideShift) + iGray;
+		int	iNum = bg.m_arrGraySuccessor[iSucc];
+		int	iUsedMask = iNum >= CBalaGray::ULONGLONG_BITS;	// index selects one of two 64-bit masks
+		uint64_t	nNumeralMask = 1ull << (iNum & (CBalaGray::ULONGLONG_BITS - 1));
+		if (node.arrUsedMask[iUsedMask] & nNumeralMask)	// if numeral already used on this path
+			continue;
+		int	iPlace = bg.m_arrGrayPlace[iSucc];
+		const NUMERAL&	numCur = bg.m_arrNum[iNum];
+		NUMERAL	nTrans = node.nTrans;
+		nTrans.b[iPlace]++;
+		int	nMinTrans = INT_MAX;
+		int	nMaxTrans = 0;
+		for (int iPl = 0; iPl < nPlaces; iPl++) {	// for each place
+			int	nWrapTrans = nTrans.b[iPl] + (numCur.b[iPl] != 0);	// including wraparound; origin is zero
+			nMinTrans = std::min(nMinTrans, nWrapTrans);
+			nMaxTrans = std::max(nMaxTrans, nWrapTrans);
+		}
+		int	nImbalance = nMaxTrans - nMinTrans;
+		if (iChildDepth == nNumerals - 1) {	// if path is complete
+			int	arrScore[CObjective::SCORES];
+			m_obj.GetLeafScore(iChildDepth, iPlace, numCur, arrScore);
+			int	arrMetric[BOUNDS] = {nImbalance, nMaxTrans};
+			memcpy(&arrMetric[2], arrScore, CObjective::KEYS * sizeof(int));
+			if (IsBoundBetter(arrMetric, m_arrBest)) {	// if cycle improves on best
+				m_arrPath[iChildDepth] = static_cast<PLACE>(iNum);
+				CWinner	winner;
+				winner.m_nImbalance = nImbalance;
+				winner.m_nMaxTrans = nMaxTrans;
+				bg.MakeWinner(m_arrPath, winner);
+				CObjective::StoreScore(arrScore, winner);
+				OnWinner(winner);
+			}
+			continue;
+		}
+		// With wraparound, each place's count can only grow, so the maximum
+		// bounds the final maximum, and via the lookahead table, imbalance.
+		NODE	child;
+		child.arrBound[0] = std::max(bg.m_arrImbalanceBound[nMaxTrans], m_lbound.nImbalance);
+		child.arrBound[1] = std::max(nMaxTrans, nMeanTrans);
+		if (CObjective::HAS_BOUND) {	// if policy has bound
+			m_obj.Push(iChildDepth, iPlace);
+			m_obj.GetBound(iChildDepth, &child.arrBound[2]);
+			m_obj.Pop(iChildDepth);
+		} else {	// no bound; zero is always admissible
+			memset(&child.arrBound[2], 0, CObjective::KEYS * sizeof(int));
+		}
+		if (!IsBoundBetter(child.arrBound, m_arrBest))	// if no completion can improve on best
+			continue;
+		LINK	link = {node.iLink, static_cast<PLACE>(iNum)};
+		m_arrLink.push_back(link);
+		child.nTrans = nTrans;
+		child.arrUsedMask[0] = node.arrUsedMask[0];
+		child.arrUsedMask[1] = node.arrUsedMask[1];
+		child.arrUsedMask[iUsedMask] |= nNumeralMask;
+		child.iLink = static_cast<int>(m_arrLink.size()) - 1;
+		child.iNum = static_cast<PLACE>(iNum);
+		child.iDepth = static_cast<PLACE>(iChildDepth);
+		child.nImbalance = static_cast<PLACE>(nImbalance);
+		m_qOpen.push(child);
+	}
+	m_stats.nMaxOpen = std::max(m_stats.nMaxOpen, static_cast<int>(m_qOpen.size()));
+	m_stats.nMemory = std::max(m_stats.nMemory, GetMemoryUsed());
+}
+
+bool CBalaGrayBest::CrawlPath(const NODE& node, SET_CODE nSetCode)
+{
+	// Crawl the path's subtree depth-first, pruning admissibly from the best
+	// cycle. A fresh crawler each time, so a node limit cancel doesn't linger.
+	m_stats.nCrawls++;
+	GetPath(node.iLink, node.iDepth);
+	CBalaGray	bg;
+	bg.SetCertify(true);
+	bg.SetPrefix(CBalaGray::CPlaceArray(m_arrPath.begin(), m_arrPath.begin() + node.iDepth + 1));
+	if (!m_winBest.m_arrNum.empty())	// if we have a cycle
+		bg.SetIncumbent(m_winBest);
+	if (m_nNodeLimit)	// if limiting nodes, crawl gets what's left
+		bg.SetNodeLimit(m_nNodeLimit - std::min(m_nNodeLimit - 1, m_stats.nNodes));
+	CWinner	winner;
+	if (!bg.CalcFromCode(nSetCode, winner))
+		return false;
+	m_stats.nNodes += bg.GetNodeCount();
+	if (!winner.m_bIsProven)	// if crawl didn't finish
+		m_bProof = false;
+	if (winner.m_nImbalance != INT_MAX)	// if crawl has a cycle
+		OnWinner(winner);
+	return true;
+}
+
+bool CBalaGrayBest::Search(SET_CODE nSetCode, CWinner& winner)
+{
+	std::chrono::steady_clock::time_point	tStart = std::chrono::steady_clock::now();
+	memset(&m_stats, 0, sizeof(m_stats));
+	if (!m_bg.CalcLowerBound(nSetCode, m_lbound))	// also validates set and makes its numerals
+		return false;
+	if (!m_bg.MakeGraySuccessorTable())
+		return false;
+	if (!m_bg.MakeGrayWrapMask(m_nGrayWrapMask))	// completed paths are only checked for wraparound by this mask
+		return false;
+	m_bg.MakeLookaheadTable();
+	int	nNumerals = m_bg.GetNumeralCount();
+	int	arrLower[BOUNDS] = {m_lbound.nImbalance, m_lbound.nMaxTrans};	// lower bounds of set's metrics
+	int	arrLowerScore[CObjective::SCORES];
+	CObjective::MakeScore(m_lbound.nMaxSpan, m_lbound.nDevSum, arrLowerScore);
+	memcpy(&arrLower[2], arrLowerScore, CObjective::KEYS * sizeof(int));
+	m_winBest = CWinner();
+	for (int iBound = 0; iBound < BOUNDS; iBound++) {	// for each bound
+		m_arrBest[iBound] = INT_MAX;
+	}
+	// Seed with a cycle built by the merge engine, scored as the crawler
+	// would, so even a search that's stopped early returns a cycle. Scoring
+	// resets a crawler's tables, so it gets its own.
+	CWinner	winSeed;
+	CBalaGray	bgScore;
+	if (CBalaGrayMerge().Build(nSetCode, winSeed) && bgScore.Score(winSeed))	// if seed built
+		OnWinner(winSeed);
+	m_bProof = true;
+	m_arrPath.assign(nNumerals, 0);
+	m_arrLink.clear();
+	m_qOpen = CNodeQueue();
+	// all cycles start with 0, and usually 1, as in the crawler
+	LINK	linkOrigin = {-1, 0};
+	m_arrLink.push_back(linkOrigin);
+	NODE	root;
+	memset(&root, 0, sizeof(root));
+	root.arrUsedMask[0] = 0x1;
+	if (m_bg.IsSecondFixed()) {	// if second numeral is fixed too
+		LINK	linkSecond = {0, 1};
+		m_arrLink.push_back(linkSecond);
+		root.nTrans.b[0] = 1;	// second numeral differs from origin in first place
+		root.arrUsedMask[0] = 0x3;
+		root.iLink = 1;
+		root.iNum = 1;
+		root.iDepth = 1;
+	}
+	m_qOpen.push(root);
+	bool	bBoundMet = false;	// true if best cycle meets set's lower bound
+	bool	bStopped = false;	// true if node limit was reached
+	while (!m_qOpen.empty()) {	// while paths remain
+		if (!IsBoundBetter(arrLower, m_arrBest)) {	// if best cycle meets lower bound, it's optimal
+			bBoundMet = true;
+			break;
+		}
+		NODE	node = m_qOpen.top();
+		if (!IsBoundBetter(node.arrBound, m_arrBest))	// if no open path can improve on best, it's optimal
+			break;
+		if (m_nNodeLimit && m_stats.nNodes >= m_nNodeLimit) {	// if node limit reached
+			bStopped = true;
+			break;
+		}
+		m_qOpen.pop();
+		if (GetMemoryUsed() < m_nMemoryLimit) {	// if memory remains
+			Expand(node);	// queue path's children
+		} else {	// out of memory; crawl path depth-first
+			if (!CrawlPath(node, nSetCode))
+				return false;
+		}
+	}
+	if (m_winBest.m_arrNum.empty()) {	// if no cycle found, report no winner, as crawler does
+		CBalaGray::CPlaceArray	arrPerm(nNumerals);
+		winner.m_nImbalance = INT_MAX;
+		winner.m_nMaxTrans = INT_MAX;
+		m_bg.MakeWinner(arrPerm, winner);
+		int	arrScore[CObjective::SCORES];
+		for (int iScore = 0; iScore < CObjective::SCORES; iScore++) {	// for each of policy's scores
+			arrScore[iScore] = INT_MAX;
+		}
+		CObjective::StoreScore(arrScore, winner);
+	} else {	// have a cycle
+		winner = m_winBest;
+	}
+	winner.m_bIsProven = bBoundMet || (!bStopped && m_bProof);
+	m_qOpen = CNodeQueue();	// free memory
+	CLinkArray().swap(m_arrLink);
+	m_stats.fSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	return true;
+}
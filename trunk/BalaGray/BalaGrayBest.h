@@ -0,0 +1,121 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBest.h : memory-bounded best-first search.
+//
+// The crawler is depth-first, so it can spend its whole budget below a bad
+// early choice. This engine instead keeps open partial paths in a priority
+// queue, and always expands the path whose lower bound on the final metrics
+// is least: imbalance, bounded via the lookahead table from the maximum
+// transition count including wraparound, which can only grow; that maximum
+// itself; and the objective policy's bound on its keys. Ties favor deeper
+// paths, and then those that are currently better balanced, so the search
+// dives to a complete cycle quickly and improves it from there. Paths are
+// stored compactly, as a link to their parent in a shared history, and the
+// objective policy's state is replayed from the history on expansion.
+//
+// Pruning is admissible only: a path is dropped only if its bound can't beat
+// the best cycle found. So once the least bound in the queue can't beat the
+// best cycle, or the queue empties, the best cycle is proven optimal. When
+// the queue and history reach the memory limit, no more paths are queued;
+// instead, each path popped from the queue is crawled depth-first by the
+// crawler in certify mode, seeded with the best cycle, still in best-first
+// order. The search is anytime: it starts from a cycle built by the merge
+// engine, so if stopped by its node limit, it returns the best cycle so far,
+// unproven, even if it hasn't completed a path of its own yet.
+
+#pragma once
+
+#include "BalaGray.h"
+#include "BalaGrayObjective.h"
+#include <queue>
+
+class CBalaGrayBest {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::PLACE PLACE;
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGray::CObjective CObjective;
+	struct STATS {	// statistics of most recent search
+		uint64_t	nNodes;		// number of nodes generated, including depth-first crawls
+		uint64_t	nExpanded;	// number of paths expanded best-first
+		int		nMaxOpen;		// largest number of paths queued at once
+		int		nCrawls;		// number of paths crawled depth-first after memory ran out
+		size_t	nMemory;		// bytes used by queue and history at their largest
+		double	fSeconds;		// elapsed time in seconds
+	};
+
+// Constants
+	enum {
+		DEFAULT_MEMORY_MB = 256,	// default memory limit of queue and history, in megabytes
+	};
+
+// Construction
+	CBalaGrayBest();
+
+// Attributes
+	void	SetMemoryLimit(size_t nBytes) { m_nMemoryLimit = nBytes; }
+	void	SetNodeLimit(uint64_t nLimit) { m_nNodeLimit = nLimit; }	// zero for none
+	const STATS&	GetStats() const { return m_stats; }
+
+// Operations
+	bool	Search(SET_CODE nSetCode, CWinner& winner);
+
+protected:
+// Constants
+	enum {
+		BOUNDS = CObjective::KEYS + 2,	// imbalance and max transition count precede policy's keys
+	};
+
+// Types
+	typedef CBalaGray::BEAM_LINK LINK;	// history entry: parent's index and last numeral
+	typedef CBalaGray::CBeamLinkArray CLinkArray;
+	struct NODE {	// open partial path
+		NUMERAL	nTrans;			// transition counts, excluding wraparound
+		uint64_t	arrUsedMask[2];	// numerals used by path; need 128 bits
+		int		arrBound[BOUNDS];	// lower bounds of any completion's metrics
+		int		iLink;			// index of path's last numeral in history
+		PLACE	iNum;			// index of path's last numeral
+		PLACE	iDepth;			// depth of path's last numeral
+		PLACE	nImbalance;		// path's imbalance including wraparound; only breaks ties
+	};
+	struct NODE_ORDER {	// orders queue so that its top is the most promising path
+		bool	operator()(const NODE& node1, const NODE& node2) const;
+	};
+	typedef std::priority_queue<NODE, std::vector<NODE>, NODE_ORDER> CNodeQueue;
+
+// Member data
+	CBalaGray	m_bg;			// owns the set's tables
+	CObjective	m_obj;			// objective policy's state for path being expanded
+	size_t	m_nMemoryLimit;		// maximum bytes used by queue and history
+	uint64_t	m_nNodeLimit;	// if non-zero, search stops once it generates this many nodes
+	CLinkArray	m_arrLink;		// history of queued paths
+	CNodeQueue	m_qOpen;		// open paths
+	CBalaGray::CPlaceArray	m_arrPath;	// numerals of path being expanded
+	CWinner	m_winBest;			// best cycle found so far
+	CBalaGray::LOWER_BOUND	m_lbound;	// lower bounds of set's metrics
+	uint64_t	m_nGrayWrapMask;	// bitmask of origin's successors; see crawler's wrap prediction
+	int		m_arrBest[BOUNDS];	// best cycle's metrics, in same order as bounds
+	bool	m_bProof;			// false if any depth-first crawl didn't finish
+	STATS	m_stats;			// statistics of most recent search
+
+// Helpers
+	static	bool	IsBoundBetter(const int *parrBound1, const int *parrBound2);
+	void	GetPath(int iLink, int iDepth);
+	void	Expand(const NODE& node);
+	bool	CrawlPath(const NODE& node, SET_CODE nSetCode);
+	void	OnWinner(const CWinner& winner);
+	size_t	GetMemoryUsed() const { return m_qOpen.size() * sizeof(NODE) + m_arrLink.size() * sizeof(LINK); }
+};
@@ -0,0 +1,98 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBudget.cpp : global time budget for a batch of jobs.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayBudget.h"
+#include <assert.h>	// debugging
+#include <algorithm>
+
+CBalaGrayBudget::CBalaGrayBudget(double fWallSeconds, int nWorkers, int nSets)
+{
+	assert(fWallSeconds > 0);
+	nWorkers = std::max(nWorkers, 1);
+	nSets = std::max(nSets, 1);
+	m_nTotalMillis = static_cast<int64_t>(fWallSeconds * 1000 * nWorkers);
+	int64_t	nSlice = m_nTotalMillis * INITIAL_SHARE / 100 / nSets;
+	m_nSliceMillis = static_cast<unsigned int>(std::min(std::max(nSlice, int64_t(1)), int64_t(UINT_MAX)));
+	m_nPoolMillis = m_nTotalMillis - static_cast<int64_t>(m_nSliceMillis) * nSets;	// initial slices are reserved
+	m_nUsedMillis = 0;
+	m_nExtensions = 0;
+	m_tDeadline = std::chrono::steady_clock::now()
+		+ std::chrono::milliseconds(static_cast<int64_t>(fWallSeconds * 1000));
+}
+
+double CBalaGrayBudget::GetUsedSeconds() const
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	return m_nUsedMillis / 1000.0;
+}
+
+double CBalaGrayBudget::GetPoolSeconds() const
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	return m_nPoolMillis / 1000.0;
+}
+
+int CBalaGrayBudget::GetExtensionCount() const
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	return m_nExtensions;
+}
+
+void CBalaGrayBudget::Attach(OPTIONS& opts)
+{
+	// budget must outlive the job queue, as watchdog calls us until queue exits
+	opts.nTimeoutMillis = m_nSliceMillis;
+	opts.fnExtend = [this](const CJob& job) { return Extend(job); };
+}
+
+void CBalaGrayBudget::OnImprove(const CJob& job)
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	m_mapJob[&job].bImproved = true;
+}
+
+unsigned int CBalaGrayBudget::Extend(const CJob& job)
+{
+	// called from job queue's watchdog when job's timeout expires
+	std::lock_guard<std::mutex> lk(m_mtx);
+	JOB_INFO&	info = m_mapJob[&job];
+	if (!info.bImproved)	// if job is stuck
+		return 0;
+	if (m_nPoolMillis <= 0 || std::chrono::steady_clock::now() >= m_tDeadline)	// if out of time
+		return 0;
+	int64_t	nGrant = std::min(std::max(static_cast<int64_t>(m_nSliceMillis), int64_t(MIN_GRANT_MILLIS)), m_nPoolMillis);
+	m_nPoolMillis -= nGrant;
+	info.nExtraMillis += nGrant;
+	info.bImproved = false;	// job must improve again to earn next grant
+	m_nExtensions++;
+	return static_cast<unsigned int>(nGrant);
+}
+
+void CBalaGrayBudget::OnDone(const CJob& job)
+{
+	// return job's unused time to pool, so that jobs which are still improving can use it
+	int64_t	nUsed = static_cast<int64_t>(job.GetElapsedSeconds() * 1000);
+	std::lock_guard<std::mutex> lk(m_mtx);
+	CJobInfoMap::iterator	iter = m_mapJob.find(&job);
+	int64_t	nGranted = m_nSliceMillis;
+	if (iter != m_mapJob.end()) {	// if job has budget state
+		nGranted += iter->second.nExtraMillis;
+		m_mapJob.erase(iter);
+	}
+	if (nUsed < nGranted)	// if job finished early
+		m_nPoolMillis += nGranted - nUsed;
+	m_nUsedMillis += nUsed;
+}
@@ -0,0 +1,77 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayBudget.h : global time budget for a batch of jobs.
+//
+// Instead of giving each set a fixed timeout, a batch gets a total budget,
+// in wall seconds times workers, i.e. core-seconds. Part of the budget is
+// split evenly into initial slices, one per set; the rest is a pool. When
+// a job's slice runs out, the job is granted another slice from the pool
+// only if it improved its incumbent during its last grant; otherwise it's
+// stopped. When a job finishes early, e.g. because its set was proven, its
+// unused time goes back to the pool right away, so that sets which are
+// still improving can use it. No grants are made after the wall deadline.
+
+#pragma once
+
+#include "BalaGrayJobs.h"
+#include <map>
+
+class CBalaGrayBudget {
+public:
+// Types
+	typedef CBalaGrayJobQueue::CJob CJob;
+	typedef CBalaGrayJobQueue::OPTIONS OPTIONS;
+
+// Construction
+	CBalaGrayBudget(double fWallSeconds, int nWorkers, int nSets);
+
+// Attributes
+	unsigned int	GetSliceMillis() const { return m_nSliceMillis; }
+	double	GetTotalSeconds() const { return m_nTotalMillis / 1000.0; }
+	double	GetUsedSeconds() const;
+	double	GetPoolSeconds() const;
+	int		GetExtensionCount() const;
+
+// Operations
+	void	Attach(OPTIONS& opts);
+	void	OnImprove(const CJob& job);
+	void	OnDone(const CJob& job);
+
+protected:
+// Constants
+	enum {
+		INITIAL_SHARE = 50,			// percentage of budget split into initial slices
+		MIN_GRANT_MILLIS = 1000,	// minimum extension, in milliseconds
+	};
+
+// Types
+	struct JOB_INFO {	// budget state of one job; value-initialized to zero
+		int64_t	nExtraMillis;	// total milliseconds granted beyond initial slice
+		bool	bImproved;		// true if job improved its incumbent since its last grant
+	};
+	typedef std::map<const CJob*, JOB_INFO> CJobInfoMap;
+
+// Member data
+	mutable std::mutex	m_mtx;	// protects members below; callbacks come from worker and watchdog threads
+	CJobInfoMap	m_mapJob;		// budget state of each attached job that hasn't finished
+	int64_t	m_nTotalMillis;		// total budget, in core-milliseconds
+	int64_t	m_nPoolMillis;		// unallocated budget, in core-milliseconds
+	int64_t	m_nUsedMillis;		// budget used by finished jobs, in core-milliseconds
+	unsigned int	m_nSliceMillis;	// initial slice of each job, in milliseconds
+	int		m_nExtensions;		// number of grants made from pool
+	std::chrono::steady_clock::time_point	m_tDeadline;	// no grants after this time
+
+// Helpers
+	unsigned int	Extend(const CJob& job);
+};
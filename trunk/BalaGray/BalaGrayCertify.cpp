@@ -0,0 +1,163 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayCertify.cpp : certifies winners found by a pruned crawl.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayCertify.h"
+#include <sstream>
+#include <algorithm>
+
+CBalaGrayCertify::CBalaGrayCertify()
+{
+	m_nThreads = 0;
+	m_nTimeoutMillis = 0;
+	m_bImproved = false;
+	m_bBoundMet = false;
+	m_nSharedBound = UINT64_MAX;
+}
+
+const char *CBalaGrayCertify::GetStatusName(int nStatus)
+{
+	static const char *arrName[CERTIFY_STATES] = {
+		"proven",
+		"improved",
+		"unfinished",
+	};
+	if (nStatus < 0 || nStatus >= CERTIFY_STATES)
+		return "?";
+	return arrName[nStatus];
+}
+
+void CBalaGrayCertify::OnImprove(const CWinner& winner)
+{
+	// called from a job's worker thread for each of its new incumbents
+	std::lock_guard<std::mutex> lk(m_mtx);
+	if (!winner.IsBetterThan(m_winBest))	// if not best so far of any job
+		return;
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - m_tStart;
+	m_winBest = winner;
+	m_bImproved = true;
+	std::ostringstream	ss;
+	ss << std::fixed;	// same format as printf's %f
+	CBalaGray::WriteBalance(ss, winner);
+	printf("%.3f s: improved: %s\n", dur.count(), ss.str().c_str());
+	if (m_bg.IsLowerBoundMet(winner)) {	// if improvement is optimal
+		m_bBoundMet = true;
+		for (size_t iJob = 0; iJob < m_arrJob.size(); iJob++) {	// for each job
+			m_arrJob[iJob]->Cancel();	// remaining jobs can't improve on best
+		}
+	}
+}
+
+bool CBalaGrayCertify::EnumerateFrontier(SET_CODE nSetCode, int nJobs, CBalaGray::CPrefixArray& arrPrefix, uint64_t& nNodes)
+{
+	// Lengthen the prefixes until the frontier has enough jobs to keep all
+	// threads busy, even if subtree sizes vary widely. The frontier crawl
+	// prunes admissibly from the incumbent, so each prefix must be crawled.
+	int	nMaxLen = std::max(m_bg.GetNumeralCount() / 2, static_cast<int>(MIN_PREFIX_LEN));
+	for (int nLen = MIN_PREFIX_LEN; nLen <= nMaxLen; nLen++) {	// for each prefix length
+		if (!m_bg.EnumerateFrontier(nSetCode, nLen, arrPrefix))
+			return false;
+		nNodes += m_bg.GetNodeCount();
+		if (arrPrefix.empty() || static_cast<int>(arrPrefix.size()) >= nJobs)	// if no work, or enough jobs
+			break;
+	}
+	return true;
+}
+
+bool CBalaGrayCertify::Certify(const CWinner& winner, RESULT& result)
+{
+	m_tStart = std::chrono::steady_clock::now();
+	result.nStatus = CS_UNFINISHED;
+	result.winBest = winner;
+	result.winBest.m_bIsProven = false;
+	result.nNodes = 0;
+	result.nJobs = 0;
+	result.nFinished = 0;
+	result.fSeconds = 0;
+	if (winner.m_arrNum.empty() || winner.m_nImbalance == INT_MAX) {	// if no winner
+		printf("nothing to certify\n");
+		return false;
+	}
+	SET_CODE	nSetCode = winner.m_nSetCode;
+	CBalaGray::LOWER_BOUND	bound;
+	m_bg.SetCustomAdjacency(m_arrAdjacency);
+	if (!m_bg.CalcLowerBound(nSetCode, bound))
+		return false;
+	if (m_bg.IsLowerBoundMet(winner)) {	// if winner is optimal by lower bound alone
+		result.nStatus = CS_PROVEN;
+		result.winBest.m_bIsProven = true;
+		return true;
+	}
+	int	nThreads = m_nThreads;
+	if (nThreads <= 0)	// if thread count unspecified
+		nThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	m_bg.SetCertify(true);
+	m_bg.SetPruneImbalance(INT_MAX);
+	m_bg.SetPruneMaxTrans(INT_MAX);
+	m_bg.SetIncumbent(winner);	// frontier is pruned from winner's metrics
+	CBalaGray::CPrefixArray	arrPrefix;
+	if (!EnumerateFrontier(nSetCode, nThreads * JOBS_PER_THREAD, arrPrefix, result.nNodes))
+		return false;
+	m_arrJob.clear();
+	m_winBest = winner;
+	m_bImproved = false;
+	m_bBoundMet = false;
+	m_nSharedBound = UINT64_MAX;	// first job to start publishes winner's bound
+	int	nJobs = static_cast<int>(arrPrefix.size());
+	CBalaGrayJobQueue	queue(nThreads);
+	{
+		// hold lock while submitting, so callbacks don't see a partial job list
+		std::lock_guard<std::mutex> lk(m_mtx);
+		CBalaGrayJobQueue::OPTIONS	opts;
+		opts.bCertify = true;
+		opts.nPruneImbalance = INT_MAX;
+		opts.nPruneMaxTrans = INT_MAX;
+		opts.pSharedBound = &m_nSharedBound;
+		opts.winIncumbent = winner;
+		opts.arrAdjacency = m_arrAdjacency;
+		for (int iJob = 0; iJob < nJobs; iJob++) {	// for each frontier prefix
+			opts.arrPrefix = arrPrefix[iJob];
+			m_arrJob.push_back(queue.Submit(nSetCode, opts,
+				[this](const CJob& job, const CWinner& winCur) { OnImprove(winCur); }));
+		}
+	}
+	if (m_nTimeoutMillis) {	// if overall timeout specified
+		std::chrono::steady_clock::time_point	tDeadline = m_tStart + std::chrono::milliseconds(m_nTimeoutMillis);
+		for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+			if (m_arrJob[iJob]->GetFuture().wait_until(tDeadline) == std::future_status::timeout) {
+				queue.CancelAll();	// out of time
+				break;
+			}
+		}
+	}
+	queue.WaitAll();
+	for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+		CWinner	winJob = m_arrJob[iJob]->Wait();
+		if (winJob.m_arrNum.empty())	// if crawl failed, e.g. invalid set
+			return false;
+		result.nNodes += m_arrJob[iJob]->GetNodeCount();
+		if (winJob.m_bIsProven && !m_arrJob[iJob]->IsCanceled())	// if job crawled its whole subtree
+			result.nFinished++;
+	}
+	std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - m_tStart;
+	result.fSeconds = dur.count();
+	result.nJobs = nJobs;
+	result.winBest = m_winBest;
+	bool	bIsProven = m_bBoundMet || result.nFinished == nJobs;
+	result.winBest.m_bIsProven = bIsProven;
+	if (bIsProven)
+		result.nStatus = m_bImproved ? CS_IMPROVED : CS_PROVEN;
+	return true;
+}
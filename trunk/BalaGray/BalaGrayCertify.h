@@ -0,0 +1,88 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayCertify.h : certifies winners found by a pruned crawl.
+//
+// The crawler's imbalance and maximum transition thresholds are heuristics
+// that may cut the optimal cycle, so a winner found with them isn't proven.
+// Certification re-crawls the set in certify mode, which prunes only where
+// no better cycle can exist, seeded with the winner as incumbent. The crawl
+// frontier is split into prefix jobs that run in parallel and share one
+// bound. If every job finishes, the winner is proven optimal, or else a
+// better winner was found and is proven instead. If the winner meets the
+// set's lower bound, it's proven without crawling.
+
+#pragma once
+
+#include "BalaGrayJobs.h"
+
+class CBalaGrayCertify {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGrayJobQueue::CJob CJob;
+	enum {	// certification status
+		CS_PROVEN,		// winner is optimal
+		CS_IMPROVED,	// a better winner was found and is optimal
+		CS_UNFINISHED,	// timed out; best winner found so far isn't proven
+		CERTIFY_STATES
+	};
+	struct RESULT {	// result of a certification
+		int		nStatus;		// certification status; see enum above
+		CWinner	winBest;		// certified winner, or best winner found if unfinished
+		uint64_t	nNodes;		// total number of nodes crawled
+		int		nJobs;			// number of prefix jobs
+		int		nFinished;		// number of prefix jobs that crawled their whole subtree
+		double	fSeconds;		// elapsed time in seconds
+	};
+
+// Construction
+	CBalaGrayCertify();
+
+// Attributes
+	void	SetThreadCount(int nThreads) { m_nThreads = nThreads; }	// zero for one per core
+	void	SetTimeout(unsigned int nTimeoutMillis) { m_nTimeoutMillis = nTimeoutMillis; }	// zero for none
+	void	SetCustomAdjacency(const CBalaGray::CAdjacencyArray& arrAdjacency) { m_arrAdjacency = arrAdjacency; }
+	static	const char	*GetStatusName(int nStatus);
+
+// Operations
+	bool	Certify(const CWinner& winner, RESULT& result);
+
+protected:
+// Types
+	typedef std::vector<CBalaGrayJobQueue::CJobPtr> CJobArray;
+
+// Constants
+	enum {
+		MIN_PREFIX_LEN = 4,		// initial length of frontier prefixes
+		JOBS_PER_THREAD = 16,	// frontier is split until it has at least this many jobs per thread
+	};
+
+// Member data
+	int		m_nThreads;			// number of worker threads, or zero for one per core
+	unsigned int	m_nTimeoutMillis;	// overall timeout in milliseconds, or zero for none
+	CBalaGray::CAdjacencyArray	m_arrAdjacency;	// custom adjacency graph, if any
+	CBalaGray	m_bg;			// crawler for lower bound and frontier
+	CJobArray	m_arrJob;		// one job per frontier prefix
+	CWinner	m_winBest;			// best winner found so far
+	bool	m_bImproved;		// true if a job found a better winner
+	bool	m_bBoundMet;		// true if best winner meets set's lower bound
+	CBalaGray::CSharedBound	m_nSharedBound;	// packed metrics of best winner, shared by jobs
+	std::chrono::steady_clock::time_point	m_tStart;	// when certification started
+	std::mutex	m_mtx;			// protects members above during certification
+
+// Helpers
+	void	OnImprove(const CWinner& winner);
+	bool	EnumerateFrontier(SET_CODE nSetCode, int nJobs, CBalaGray::CPrefixArray& arrPrefix, uint64_t& nNodes);
+};
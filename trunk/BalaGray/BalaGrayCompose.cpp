@@ -0,0 +1,242 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	ignore restricted adjacency variants
+
+*/
+
+// BalaGrayCompose.cpp : builds candidate cycles from winners of sub-sets.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayCompose.h"
+#include "BalaGraySets.h"
+#include <assert.h>	// debugging
+#include <algorithm>
+
+CBalaGrayCompose::CBalaGrayCompose()
+{
+	m_nRandSeed = 1;
+}
+
+inline uint32_t CBalaGrayCompose::Rand()
+{
+	m_nRandSeed = m_nRandSeed * 1664525 + 1013904223;	// linear congruential; repeatable results
+	return m_nRandSeed >> 16;	// low bits have short periods
+}
+
+bool CBalaGrayCompose::IsGray(const NUMERAL& num1, const NUMERAL& num2)
+{
+	// unused places are zero in both numerals, so they never differ
+	int	nDiffs = 0;
+	for (int iPlace = 0; iPlace < CBalaGray::MAX_PLACES; iPlace++) {	// for each place
+		if (num1.b[iPlace] != num2.b[iPlace])
+			nDiffs++;
+	}
+	return nDiffs == 1;
+}
+
+void CBalaGrayCompose::AddWinner(const CWinner& winner)
+{
+	// Cache winner in prime form, i.e. with its places sorted by range,
+	// so that it can serve any factor whose ranges are a permutation of it.
+	if (winner.m_arrNum.empty() || winner.m_nImbalance == INT_MAX)	// if no winner
+		return;
+	if (CBalaGray::GetAdjacency(winner.m_nSetCode) != CBalaGray::ADJ_ANY)	// if restricted variant
+		return;	// products and repairs don't preserve restricted adjacency
+	NUMERAL	arrBase;
+	int	nPlaces = CBalaGray::GetBases(winner.m_nSetCode, arrBase);
+	CIntArray	arrPlace(nPlaces);
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		arrPlace[iPlace] = iPlace;
+	}
+	std::stable_sort(arrPlace.begin(), arrPlace.end(),
+		[&arrBase](int a, int b) { return arrBase.b[a] < arrBase.b[b]; });
+	CWinner	winPrime(winner);
+	winPrime.m_nSetCode = CBalaGraySets::GetPrimeForm(winner.m_nSetCode);
+	int	nNumerals = static_cast<int>(winner.m_arrNum.size());
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
+		winPrime.m_arrNum[iNum].Zero();
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place of prime form
+			winPrime.m_arrNum[iNum].b[iPlace] = winner.m_arrNum[iNum].b[arrPlace[iPlace]];
+		}
+	}
+	CWinnerMap::iterator	iter = m_mapWinner.find(winPrime.m_nSetCode);
+	if (iter == m_mapWinner.end())	// if set not cached yet
+		m_mapWinner[winPrime.m_nSetCode] = winPrime;
+	else if (winPrime.IsBetterThan(iter->second))	// if better than cached winner
+		iter->second = winPrime;
+}
+
+void CBalaGrayCompose::AddWinners(const CWinnerArray& arrWin)
+{
+	for (const CWinner& winner : arrWin) {	// for each winner
+		AddWinner(winner);
+	}
+}
+
+bool CBalaGrayCompose::GetFactorCycle(const NUMERAL& arrBase, const CIntArray& arrPlace, CNumeralArray& arrCycle) const
+{
+	// Get a Gray cycle of the factor consisting of the given places of a set,
+	// expressed in the set's numerals; places outside the factor are zero.
+	int	nPlaces = static_cast<int>(arrPlace.size());
+	if (nPlaces == 1) {	// if single place
+		int	iPlace = arrPlace[0];
+		arrCycle.resize(arrBase.b[iPlace]);
+		for (int iVal = 0; iVal < arrBase.b[iPlace]; iVal++) {	// any order of values is a cycle
+			arrCycle[iVal].Zero();
+			arrCycle[iVal].b[iPlace] = static_cast<PLACE>(iVal);
+		}
+		return true;
+	}
+	CIntArray	arrSorted(arrPlace);	// map prime form's places to set's places
+	std::stable_sort(arrSorted.begin(), arrSorted.end(),
+		[&arrBase](int a, int b) { return arrBase.b[a] < arrBase.b[b]; });
+	SET_CODE	nSetCode = 0;
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place of prime form
+		nSetCode = (nSetCode << 4) | arrBase.b[arrSorted[iPlace]];
+	}
+	CWinnerMap::const_iterator	iter = m_mapWinner.find(nSetCode);
+	if (iter == m_mapWinner.end())	// if factor's winner isn't cached
+		return false;
+	const CNumeralArray&	arrNum = iter->second.m_arrNum;
+	int	nNumerals = static_cast<int>(arrNum.size());
+	arrCycle.resize(nNumerals);
+	for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral of factor's cycle
+		arrCycle[iNum].Zero();
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place of prime form
+			arrCycle[iNum].b[arrSorted[iPlace]] = arrNum[iNum].b[iPlace];
+		}
+	}
+	return true;
+}
+
+void CBalaGrayCompose::MakeProduct(const CIntArray& arrInnerPlace, const CNumeralArray& arrInner,
+	const CIntArray& arrOuterPlace, const CNumeralArray& arrOuter, CNumeralArray& arrPath)
+{
+	// Reflected product: for each numeral of the outer cycle, traverse the inner
+	// cycle, alternating direction, so that consecutive rows meet at the same
+	// inner numeral. If the outer cycle's length is even, the last row ends
+	// where the first row began, and the product is a cycle; otherwise it's
+	// only a path, and needs repair.
+	int	nInner = static_cast<int>(arrInner.size());
+	int	nOuter = static_cast<int>(arrOuter.size());
+	arrPath.resize(nInner * nOuter);
+	int	iPath = 0;
+	for (int iOuter = 0; iOuter < nOuter; iOuter++) {	// for each row
+		for (int iCol = 0; iCol < nInner; iCol++) {	// for each column
+			int	iInner = (iOuter & 1) ? nInner - 1 - iCol : iCol;	// odd rows are reversed
+			NUMERAL&	num = arrPath[iPath++];
+			num = arrInner[iInner];
+			for (int iPlace : arrOuterPlace) {	// for each of outer factor's places
+				num.b[iPlace] = arrOuter[iOuter].b[iPlace];
+			}
+		}
+	}
+}
+
+bool CBalaGrayCompose::Repair(CNumeralArray& arrPath)
+{
+	// Close a Hamiltonian path into a cycle using Posa rotations: if the path's
+	// end is Gray to some interior numeral, reversing the path after that
+	// numeral yields another Hamiltonian path with a different end. Rotate
+	// at random until the end is Gray to the start, flipping the path now and
+	// then so that both ends get rotated. Returns false if no cycle was found.
+	int	nNumerals = static_cast<int>(arrPath.size());
+	CIntArray	arrPivot;
+	for (int iStep = 0; iStep < MAX_REPAIR_STEPS; iStep++) {	// for each rotation
+		if (IsGray(arrPath[nNumerals - 1], arrPath[0]))	// if path is closed
+			return true;
+		arrPivot.clear();
+		for (int iNum = 0; iNum < nNumerals - 2; iNum++) {	// for each numeral that isn't adjacent to end
+			if (IsGray(arrPath[iNum], arrPath[nNumerals - 1]))
+				arrPivot.push_back(iNum);
+		}
+		if (!arrPivot.empty()) {	// if end can be rotated
+			int	iPivot = arrPivot[Rand() % arrPivot.size()];
+			std::reverse(arrPath.begin() + iPivot + 1, arrPath.end());
+		}
+		if (arrPivot.empty() || !(Rand() & 3))	// if end is stuck, or now and then
+			std::reverse(arrPath.begin(), arrPath.end());	// swap ends
+	}
+	return false;
+}
+
+void CBalaGrayCompose::Improve(CWinner& winner)
+{
+	// Local search by segment reversal: reversing the numerals between two
+	// positions keeps the cycle Gray if the numerals on either side of the
+	// segment are Gray to the segment's opposite ends. Take any reversal that
+	// improves the winner, until a pass finds none or the pass limit is hit.
+	int	nNumerals = static_cast<int>(winner.m_arrNum.size());
+	for (int iPass = 0; iPass < MAX_IMPROVE_PASSES; iPass++) {	// for each pass
+		bool	bImproved = false;
+		for (int iFirst = 0; iFirst < nNumerals - 2; iFirst++) {	// for each numeral before segment
+			for (int iLast = iFirst + 2; iLast < nNumerals; iLast++) {	// for each segment end
+				if (!iFirst && iLast == nNumerals - 1)	// if segment is rest of cycle
+					continue;	// reversal would only change direction
+				const CNumeralArray&	arrNum = winner.m_arrNum;
+				if (!IsGray(arrNum[iFirst], arrNum[iLast])
+				|| !IsGray(arrNum[iFirst + 1], arrNum[(iLast + 1) % nNumerals]))	// if reversal wouldn't be Gray
+					continue;
+				CWinner	winCand(winner);
+				std::reverse(winCand.m_arrNum.begin() + iFirst + 1, winCand.m_arrNum.begin() + iLast + 1);
+				if (m_bg.Score(winCand) && winCand.IsBetterThan(winner)) {	// if reversal improved winner
+					winner = winCand;
+					bImproved = true;
+				}
+			}
+		}
+		if (!bImproved)	// if local optimum
+			break;
+	}
+}
+
+bool CBalaGrayCompose::Compose(SET_CODE nSetCode, CWinner& winner)
+{
+	// Try each way of splitting the set's places into an inner and an outer
+	// factor whose cycles are known, and return the best resulting candidate.
+	// Returns false if no candidate could be built.
+	if (CBalaGray::GetAdjacency(nSetCode) != CBalaGray::ADJ_ANY)	// if restricted variant
+		return false;
+	NUMERAL	arrBase;
+	int	nPlaces = CBalaGray::GetBases(nSetCode, arrBase);
+	if (nPlaces < 2)
+		return false;
+	bool	bFound = false;
+	int	nSplits = (1 << nPlaces) - 1;	// excluding empty and full factors
+	for (int nInnerMask = 1; nInnerMask < nSplits; nInnerMask++) {	// for each split
+		CIntArray	arrInnerPlace, arrOuterPlace;
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			if (nInnerMask & (1 << iPlace))
+				arrInnerPlace.push_back(iPlace);
+			else
+				arrOuterPlace.push_back(iPlace);
+		}
+		CNumeralArray	arrInner, arrOuter;
+		if (!GetFactorCycle(arrBase, arrInnerPlace, arrInner)
+		|| !GetFactorCycle(arrBase, arrOuterPlace, arrOuter))	// if either factor's cycle is unknown
+			continue;
+		CWinner	winCand;
+		MakeProduct(arrInnerPlace, arrInner, arrOuterPlace, arrOuter, winCand.m_arrNum);
+		if (!Repair(winCand.m_arrNum))	// if product couldn't be closed
+			continue;
+		winCand.m_nSetCode = nSetCode;
+		if (!m_bg.Score(winCand)) {	// if not a Gray cycle; shouldn't happen
+			assert(0);
+			continue;
+		}
+		Improve(winCand);
+		if (!bFound || winCand.IsBetterThan(winner)) {	// if best candidate so far
+			winner = winCand;
+			bFound = true;
+		}
+	}
+	return bFound;
+}
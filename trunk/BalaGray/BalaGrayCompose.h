@@ -0,0 +1,75 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayCompose.h : builds candidate cycles from winners of sub-sets.
+//
+// A set's places can be split into two factors, e.g. 2222 into 22 and 22,
+// or 246 into 24 and 6. Given Gray cycles of both factors, their reflected
+// product visits every state of the set: the inner factor's cycle runs
+// forward and backward alternately, once per state of the outer factor.
+// A single place is a factor too, as any order of its values is a cycle.
+// The product is closed into a cycle if needed, improved by segment
+// reversals, and scored; the best candidate seeds the crawl as its
+// incumbent, so that the crawl prunes from its first node.
+
+#pragma once
+
+#include "BalaGray.h"
+#include <map>
+
+class CBalaGrayCompose {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::PLACE PLACE;
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CNumeralArray CNumeralArray;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGray::CWinnerArray CWinnerArray;
+
+// Construction
+	CBalaGrayCompose();
+
+// Attributes
+	void	AddWinner(const CWinner& winner);
+	void	AddWinners(const CWinnerArray& arrWin);
+	int		GetWinnerCount() const { return static_cast<int>(m_mapWinner.size()); }
+
+// Operations
+	bool	Compose(SET_CODE nSetCode, CWinner& winner);
+
+protected:
+// Constants
+	enum {
+		MAX_REPAIR_STEPS = 10000,	// maximum rotations when closing a path into a cycle
+		MAX_IMPROVE_PASSES = 4,		// maximum passes of segment reversal
+	};
+
+// Types
+	typedef std::map<SET_CODE, CWinner> CWinnerMap;
+	typedef std::vector<int> CIntArray;
+
+// Member data
+	CWinnerMap	m_mapWinner;	// cached winners, keyed by set code in prime form
+	CBalaGray	m_bg;			// scores candidates
+	uint32_t	m_nRandSeed;	// state of pseudo-random generator used by repair
+
+// Helpers
+	bool	GetFactorCycle(const NUMERAL& arrBase, const CIntArray& arrPlace, CNumeralArray& arrCycle) const;
+	static	void	MakeProduct(const CIntArray& arrInnerPlace, const CNumeralArray& arrInner,
+		const CIntArray& arrOuterPlace, const CNumeralArray& arrOuter, CNumeralArray& arrPath);
+	bool	Repair(CNumeralArray& arrPath);
+	void	Improve(CWinner& winner);
+	static	bool	IsGray(const NUMERAL& num1, const NUMERAL& num2);
+	uint32_t	Rand();
+};
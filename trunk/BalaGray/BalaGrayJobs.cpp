@@ -0,0 +1,220 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	add prefix and incumbent options
+		02		18oct26	add Pareto front option
+		03		18oct26	add meet-in-the-middle option
+		04		18oct26	add timeout extension option
+		05		18oct26	add successor seed and shared bound options
+		06		18oct26	add limited discrepancy option
+		07		18oct26	add beam width option
+		08		18oct26	add custom adjacency option
+		09		18oct26	add certify option
+		10		18oct26	add balance window option
+		11		18oct26	add node limit option
+
+*/
+
+// BalaGrayJobs.cpp : concurrent job queue for balanced Gray code solves.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayJobs.h"
+#include <algorithm>
+#include <assert.h>	// debugging
+
+CBalaGrayJobQueue::OPTIONS::OPTIONS()
+{
+	nPruneImbalance = 3;	// same as crawler's default
+	nPruneMaxTrans = INT_MAX;
+	nTimeoutMillis = 0;
+	bVerbose = false;
+	parrParetoFront = NULL;
+	nMeetBackLen = 0;
+	nSuccessorSeed = 0;
+	pSharedBound = NULL;
+	nDiscrepancyStep = 0;
+	nBeamWidth = 0;
+	bCertify = false;
+	nWindowLen = 0;
+	nWindowMaxTrans = INT_MAX;
+	nNodeLimit = 0;
+}
+
+CBalaGrayJobQueue::CJob::CJob(SET_CODE nSetCode, const OPTIONS& opts) : m_opts(opts)
+{
+	m_nSetCode = nSetCode;
+	m_future = m_promise.get_future().share();
+	m_nState = JS_QUEUED;
+	m_bCanceled = false;
+	m_bTimedOut = false;
+	m_nTimeoutMillis = opts.nTimeoutMillis;
+}
+
+double CBalaGrayJobQueue::CJob::GetElapsedSeconds() const
+{
+	if (m_nState == JS_QUEUED)	// if job hasn't started yet
+		return 0;
+	std::chrono::duration<double> dur = std::chrono::steady_clock::now() - m_tStart;
+	return dur.count();
+}
+
+void CBalaGrayJobQueue::CJob::Cancel()
+{
+	// crawler preserves its cancel flag, so this is safe even if job hasn't started
+	m_bCanceled = true;
+	m_bg.Cancel();
+}
+
+CBalaGrayJobQueue::CBalaGrayJobQueue(int nThreads)
+{
+	if (nThreads <= 0)	// if thread count unspecified
+		nThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	m_bExit = false;
+	for (int iThread = 0; iThread < nThreads; iThread++) {	// for each worker
+		m_arrWorker.push_back(std::thread(&CBalaGrayJobQueue::WorkerFunc, this));
+	}
+	m_thrWatchdog = std::thread(&CBalaGrayJobQueue::WatchdogFunc, this);
+}
+
+CBalaGrayJobQueue::~CBalaGrayJobQueue()
+{
+	CancelAll();
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_bExit = true;
+	}
+	m_cvWork.notify_all();	// wake all workers so they can exit
+	m_cvWatchdog.notify_all();
+	for (size_t iThread = 0; iThread < m_arrWorker.size(); iThread++) {
+		m_arrWorker[iThread].join();
+	}
+	m_thrWatchdog.join();
+}
+
+int CBalaGrayJobQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	return static_cast<int>(m_queJob.size() + m_arrRunning.size());
+}
+
+CBalaGrayJobQueue::CJobPtr CBalaGrayJobQueue::Submit(SET_CODE nSetCode, const OPTIONS& opts, CJobFunc fnProgress, CJobFunc fnDone)
+{
+	CJobPtr	pJob(new CJob(nSetCode, opts));
+	pJob->m_fnProgress = fnProgress;
+	pJob->m_fnDone = fnDone;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_queJob.push_back(pJob);
+	}
+	m_cvWork.notify_one();
+	return pJob;
+}
+
+void CBalaGrayJobQueue::CancelAll()
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	for (size_t iJob = 0; iJob < m_queJob.size(); iJob++) {	// for each queued job
+		m_queJob[iJob]->Cancel();
+	}
+	for (size_t iJob = 0; iJob < m_arrRunning.size(); iJob++) {	// for each running job
+		m_arrRunning[iJob]->Cancel();
+	}
+}
+
+void CBalaGrayJobQueue::WaitAll()
+{
+	std::unique_lock<std::mutex> lk(m_mtx);
+	m_cvIdle.wait(lk, [this]{ return m_queJob.empty() && m_arrRunning.empty(); });
+}
+
+void CBalaGrayJobQueue::WorkerFunc()
+{
+	while (1) {
+		CJobPtr	pJob;
+		{
+			std::unique_lock<std::mutex> lk(m_mtx);
+			m_cvWork.wait(lk, [this]{ return m_bExit || !m_queJob.empty(); });
+			if (m_queJob.empty())	// if exit requested and no work remains
+				break;
+			pJob = m_queJob.front();
+			m_queJob.pop_front();
+			pJob->m_tStart = std::chrono::steady_clock::now();
+			pJob->m_nState = CJob::JS_RUNNING;
+			m_arrRunning.push_back(pJob);
+		}
+		RunJob(*pJob);
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			m_arrRunning.erase(std::find(m_arrRunning.begin(), m_arrRunning.end(), pJob));
+		}
+		m_cvIdle.notify_all();
+	}
+}
+
+void CBalaGrayJobQueue::RunJob(CJob& job)
+{
+	CBalaGray&	bg = job.m_bg;
+	const OPTIONS&	opts = job.m_opts;
+	bg.SetPruneImbalance(opts.nPruneImbalance);
+	bg.SetPruneMaxTrans(opts.nPruneMaxTrans);
+	bg.SetVerbose(opts.bVerbose);
+	bg.SetPrefix(opts.arrPrefix);
+	bg.SetParetoFront(opts.parrParetoFront);
+	bg.SetMeetLength(opts.nMeetBackLen);
+	bg.SetSuccessorSeed(opts.nSuccessorSeed);
+	bg.SetSharedBound(opts.pSharedBound);
+	bg.SetDiscrepancyStep(opts.nDiscrepancyStep);
+	bg.SetBeamWidth(opts.nBeamWidth);
+	bg.SetCustomAdjacency(opts.arrAdjacency);
+	bg.SetCertify(opts.bCertify);
+	bg.SetWindowBalance(opts.nWindowLen, opts.nWindowMaxTrans);
+	bg.SetNodeLimit(opts.nNodeLimit);
+	if (!opts.winIncumbent.m_arrNum.empty())	// if initial incumbent specified
+		bg.SetIncumbent(opts.winIncumbent);
+	if (!opts.sLogPath.empty())	// if log file requested
+		bg.OpenLog(opts.sLogPath.c_str());	// on failure, crawl proceeds without log
+	if (job.m_fnProgress) {	// if job has a progress callback
+		CJob	*pJob = &job;
+		bg.SetIncumbentFunc([pJob](const CWinner& winner) { pJob->m_fnProgress(*pJob, winner); });
+	}
+	CWinner	winner;
+	if (!bg.CalcFromCode(job.m_nSetCode, winner)) {	// if invalid set
+		winner = CWinner();	// return empty winner; no numerals indicates failure
+		winner.m_nSetCode = job.m_nSetCode;
+	}
+	bg.SetLog(NULL);	// detach log before result is published
+	job.m_nState = CJob::JS_DONE;
+	job.m_promise.set_value(winner);
+	if (job.m_fnDone)	// if job has a completion callback
+		job.m_fnDone(job, winner);
+}
+
+void CBalaGrayJobQueue::WatchdogFunc()
+{
+	std::unique_lock<std::mutex> lk(m_mtx);
+	while (!m_bExit) {
+		m_cvWatchdog.wait_for(lk, std::chrono::milliseconds(WATCHDOG_PERIOD));
+		std::chrono::steady_clock::time_point	tNow = std::chrono::steady_clock::now();
+		for (size_t iJob = 0; iJob < m_arrRunning.size(); iJob++) {	// for each running job
+			CJob&	job = *m_arrRunning[iJob];
+			unsigned int	nTimeout = job.m_nTimeoutMillis;
+			if (nTimeout && !job.m_bTimedOut && tNow - job.m_tStart >= std::chrono::milliseconds(nTimeout)) {
+				// extension callback runs with our mutex locked, so it mustn't call us
+				unsigned int	nExtra = job.m_opts.fnExtend ? job.m_opts.fnExtend(job) : 0;
+				if (nExtra) {	// if job was granted more time
+					job.m_nTimeoutMillis = nTimeout + nExtra;
+				} else {	// job's time is up
+					job.m_bTimedOut = true;
+					job.m_bg.Cancel();	// request crawler to exit
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,148 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	add prefix and incumbent options
+		02		18oct26	add Pareto front option
+		03		18oct26	add meet-in-the-middle option
+		04		18oct26	add timeout extension option
+		05		18oct26	add successor seed and shared bound options
+		06		18oct26	add limited discrepancy option
+		07		18oct26	add beam width option
+		08		18oct26	add custom adjacency option
+		09		18oct26	add certify option
+		10		18oct26	add balance window option
+		11		18oct26	add node limit option
+
+*/
+
+// BalaGrayJobs.h : concurrent job queue for balanced Gray code solves.
+// Each submitted job owns its own crawler instance, so any number of
+// jobs can run at once without sharing state. A pool of worker threads
+// runs the jobs in submission order, and a watchdog thread cancels jobs
+// that exceed their timeouts, unless a job's extension callback grants
+// it more time. Results come back via a shared future, optionally with
+// progress and completion callbacks.
+
+#pragma once
+
+#include "BalaGray.h"
+#include <string>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+class CBalaGrayJobQueue {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	class CJob;
+	typedef std::function<unsigned int(const CJob& job)> CExtendFunc;	// called from watchdog thread
+	struct OPTIONS {	// solver options for one job
+		OPTIONS();
+		int		nPruneImbalance;	// prune branch if its imbalance exceeds this threshold
+		int		nPruneMaxTrans;		// prune branch if its maximum transition count exceeds this threshold
+		unsigned int	nTimeoutMillis;	// maximum runtime in milliseconds, or zero for no limit
+		std::string	sLogPath;		// path of log file, or empty for no log
+		bool	bVerbose;			// true if crawler should write progress to console
+		CBalaGray::CPlaceArray	arrPrefix;	// if non-empty, only branches below this prefix are crawled
+		CWinner	winIncumbent;		// initial incumbent, or empty for none
+		CBalaGray::CWinnerArray	*parrParetoFront;	// if non-NULL, receives Pareto front; must outlive job
+		int		nMeetBackLen;		// if non-zero, crawl meets in the middle, with backward halves of this length
+		CExtendFunc	fnExtend;		// if set, called when timeout expires; returns extra milliseconds, or zero to stop
+		uint32_t	nSuccessorSeed;	// if non-zero, seeds shuffle of crawl's successor order
+		CBalaGray::CSharedBound	*pSharedBound;	// if non-NULL, bound shared with other jobs; must outlive job
+		int		nDiscrepancyStep;	// if non-zero, limited discrepancy search raises its limit by this much per pass
+		int		nBeamWidth;		// if non-zero, beam search keeps this many partial paths per depth
+		CBalaGray::CAdjacencyArray	arrAdjacency;	// custom adjacency graph, for set codes of custom adjacency mode
+		bool	bCertify;		// if true, crawl prunes admissibly only, so its proven flag certifies winner
+		int		nWindowLen;		// if non-zero, number of consecutive transitions in each balance window
+		int		nWindowMaxTrans;	// maximum transition count of any place within any balance window
+		uint64_t	nNodeLimit;		// if non-zero, crawl stops after this many nodes, like a timeout
+	};
+	typedef std::shared_ptr<CJob> CJobPtr;
+	typedef std::function<void(const CJob& job, const CWinner& winner)> CJobFunc;	// called from worker thread
+	class CJob {	// a single solve; created by job queue
+	public:
+		CJob(SET_CODE nSetCode, const OPTIONS& opts);
+		SET_CODE	GetSetCode() const { return m_nSetCode; }
+		const OPTIONS&	GetOptions() const { return m_opts; }
+		std::shared_future<CWinner>	GetFuture() const { return m_future; }
+		CWinner	Wait() const { return m_future.get(); }
+		bool	IsDone() const { return m_nState == JS_DONE; }
+		bool	IsRunning() const { return m_nState == JS_RUNNING; }
+		bool	IsTimedOut() const { return m_bTimedOut; }
+		bool	IsCanceled() const { return m_bCanceled; }
+		unsigned int	GetTimeoutMillis() const { return m_nTimeoutMillis; }
+		uint64_t	GetNodeCount() const { return m_bg.GetNodeCount(); }
+		double	GetElapsedSeconds() const;
+		void	Cancel();
+
+	protected:
+		friend class CBalaGrayJobQueue;
+		enum {	// job states
+			JS_QUEUED,	// waiting for a worker
+			JS_RUNNING,	// crawling
+			JS_DONE,	// result is available
+		};
+		SET_CODE	m_nSetCode;	// set to solve
+		OPTIONS	m_opts;		// solver options
+		CBalaGray	m_bg;	// job's private crawler instance
+		std::promise<CWinner>	m_promise;	// result promise
+		std::shared_future<CWinner>	m_future;	// result future
+		std::chrono::steady_clock::time_point	m_tStart;	// when job started running
+		std::atomic<int>	m_nState;	// job state; see enum above
+		std::atomic<bool>	m_bCanceled;	// true if cancel was requested
+		std::atomic<bool>	m_bTimedOut;	// true if job exceeded its timeout
+		std::atomic<unsigned int>	m_nTimeoutMillis;	// current timeout, including extensions
+		CJobFunc	m_fnProgress;	// optional progress callback, one call per new incumbent
+		CJobFunc	m_fnDone;	// optional completion callback
+	};
+
+// Construction
+	CBalaGrayJobQueue(int nThreads = 0);
+	~CBalaGrayJobQueue();
+
+// Attributes
+	int		GetThreadCount() const { return static_cast<int>(m_arrWorker.size()); }
+	int		GetPendingCount() const;
+
+// Operations
+	CJobPtr	Submit(SET_CODE nSetCode, const OPTIONS& opts, CJobFunc fnProgress = nullptr, CJobFunc fnDone = nullptr);
+	void	CancelAll();
+	void	WaitAll();
+
+protected:
+// Constants
+	enum {
+		WATCHDOG_PERIOD = 10,	// watchdog polling period, in milliseconds
+	};
+
+// Member data
+	std::vector<std::thread>	m_arrWorker;	// worker threads
+	std::thread	m_thrWatchdog;	// cancels jobs that exceed their timeouts
+	std::deque<CJobPtr>	m_queJob;	// jobs waiting to run
+	std::vector<CJobPtr>	m_arrRunning;	// jobs currently running
+	mutable std::mutex	m_mtx;	// protects job containers and exit flag
+	std::condition_variable	m_cvWork;	// signaled when jobs are queued or on exit
+	std::condition_variable	m_cvIdle;	// signaled when a job finishes
+	std::condition_variable	m_cvWatchdog;	// signaled on exit
+	bool	m_bExit;	// true if threads should exit
+
+// Helpers
+	void	WorkerFunc();
+	void	WatchdogFunc();
+	void	RunJob(CJob& job);
+};
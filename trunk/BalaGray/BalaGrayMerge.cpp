@@ -0,0 +1,469 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayMerge.cpp : builds a cycle for any set by merging a cycle cover.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayMerge.h"
+#include <assert.h>	// debugging
+#include <algorithm>
+
+CBalaGrayMerge::CBalaGrayMerge()
+{
+	m_nPlaces = 0;
+	m_nStates = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+int CBalaGrayMerge::GetChangedPlace(int iState1, int iState2) const
+{
+	// Returns the only place in which two states differ, or -1 if they differ
+	// in none or several. If one place differs, it's the highest place whose
+	// stride doesn't exceed the difference; lower places can't differ, as their
+	// differences can't add up to a multiple of that stride.
+	int	nDiff = abs(iState2 - iState1);
+	if (!nDiff)	// if same state
+		return -1;
+	int	iPlace = m_nPlaces - 1;
+	while (m_arrStride[iPlace] > nDiff)
+		iPlace--;
+	int	nStride = m_arrStride[iPlace];
+	if (nDiff % nStride)	// if lower places differ
+		return -1;
+	int	nSpan = nStride * m_arrBase[iPlace];
+	if (iState1 / nSpan != iState2 / nSpan)	// if higher places differ
+		return -1;
+	return iPlace;
+}
+
+bool CBalaGrayMerge::HasEdge(int iState1, int iState2) const
+{
+	const LINK&	link = m_arrLink[iState1];
+	return link.arrNbr[0] == iState2 || link.arrNbr[1] == iState2;
+}
+
+void CBalaGrayMerge::ReplaceNeighbor(int iState, int iOldNbr, int iNewNbr)
+{
+	LINK&	link = m_arrLink[iState];
+	int	iSide = link.arrNbr[1] == iOldNbr;
+	assert(link.arrNbr[iSide] == iOldNbr);
+	link.arrNbr[iSide] = iNewNbr;
+}
+
+int CBalaGrayMerge::FindRoot(int iNode)
+{
+	while (m_arrParent[iNode] != iNode) {	// while not root
+		m_arrParent[iNode] = m_arrParent[m_arrParent[iNode]];	// path halving
+		iNode = m_arrParent[iNode];
+	}
+	return iNode;
+}
+
+void CBalaGrayMerge::MakeCover()
+{
+	// Choose the base cycle whose places carry the least load once the cover is
+	// merged. Each merge takes two transitions from the base cycle, so a base
+	// cycle of m states keeps about 1 - 2 / m of all transitions: a third for a
+	// place of base three, or half for a square, but split between two places.
+	int	iLinePlace = -1;	// place with smallest base of at least three, if any
+	int	arrBinaryPlace[2];	// first two binary places, if any
+	int	nBinaryPlaces = 0;
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		int	nBase = m_arrBase[iPlace];
+		if (nBase == 2) {
+			if (nBinaryPlaces < 2)
+				arrBinaryPlace[nBinaryPlaces++] = iPlace;
+		} else if (iLinePlace < 0 || nBase < m_arrBase[iLinePlace]) {
+			iLinePlace = iPlace;
+		}
+	}
+	bool	bSquare;
+	if (iLinePlace < 0) {	// if all places are binary
+		bSquare = true;
+	} else if (nBinaryPlaces < 2) {	// if square isn't possible
+		bSquare = false;
+	} else {	// compare loads
+		int	nLineLoad = m_nStates - 2 * (m_nStates / m_arrBase[iLinePlace] - 1);
+		int	nSquareLoad = (m_nStates - 2 * (m_nStates / 4 - 1)) / 2;
+		bSquare = nSquareLoad < nLineLoad;
+	}
+	m_arrBaseCycle.clear();
+	memset(m_arrIsCoverPlace, 0, sizeof(m_arrIsCoverPlace));
+	if (bSquare) {
+		int	nStride1 = m_arrStride[arrBinaryPlace[0]];
+		int	nStride2 = m_arrStride[arrBinaryPlace[1]];
+		m_arrBaseCycle.push_back(0);
+		m_arrBaseCycle.push_back(nStride1);
+		m_arrBaseCycle.push_back(nStride1 + nStride2);
+		m_arrBaseCycle.push_back(nStride2);
+		m_arrIsCoverPlace[arrBinaryPlace[0]] = true;
+		m_arrIsCoverPlace[arrBinaryPlace[1]] = true;
+	} else {
+		for (int iVal = 0; iVal < m_arrBase[iLinePlace]; iVal++) {	// for each value of place
+			m_arrBaseCycle.push_back(iVal * m_arrStride[iLinePlace]);
+		}
+		m_arrIsCoverPlace[iLinePlace] = true;
+	}
+	// a copy's origin is the state whose cover places are zero
+	int	nCycleLen = static_cast<int>(m_arrBaseCycle.size());
+	m_arrOrigin.clear();
+	m_arrParent.assign(m_nStates, -1);
+	m_arrLink.resize(m_nStates);
+	memset(m_arrTrans, 0, sizeof(m_arrTrans));
+	for (int iState = 0; iState < m_nStates; iState++) {	// for each state
+		bool	bIsOrigin = true;
+		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+			if (m_arrIsCoverPlace[iPlace] && GetDigit(iState, iPlace)) {
+				bIsOrigin = false;
+				break;
+			}
+		}
+		if (!bIsOrigin)
+			continue;
+		m_arrOrigin.push_back(iState);
+		m_arrParent[iState] = iState;
+		for (int iPos = 0; iPos < nCycleLen; iPos++) {	// for each edge of base cycle
+			int	iFrom = m_arrBaseCycle[iPos];
+			int	iTo = m_arrBaseCycle[(iPos + 1) % nCycleLen];
+			m_arrLink[iState + iFrom].arrNbr[1] = iState + iTo;
+			m_arrLink[iState + iTo].arrNbr[0] = iState + iFrom;
+			m_arrTrans[GetChangedPlace(iFrom, iTo)]++;
+		}
+	}
+	m_stats.nCoverCycles = static_cast<int>(m_arrOrigin.size());
+}
+
+int CBalaGrayMerge::FindSwitch(int iOrigin1, int iOrigin2) const
+{
+	// Returns the position of a base cycle edge that's still present in both
+	// copies, preferring edges of the most used cover place, or -1 if none.
+	int	nCycleLen = static_cast<int>(m_arrBaseCycle.size());
+	int	iBestPos = -1;
+	int	nBestTrans = -1;
+	for (int iPos = 0; iPos < nCycleLen; iPos++) {	// for each edge of base cycle
+		int	iFrom = m_arrBaseCycle[iPos];
+		int	iTo = m_arrBaseCycle[(iPos + 1) % nCycleLen];
+		if (!HasEdge(iOrigin1 + iFrom, iOrigin1 + iTo) || !HasEdge(iOrigin2 + iFrom, iOrigin2 + iTo))
+			continue;	// edge was used by an earlier merge
+		int	nTrans = m_arrTrans[GetChangedPlace(iFrom, iTo)];
+		if (nTrans > nBestTrans) {
+			iBestPos = iPos;
+			nBestTrans = nTrans;
+		}
+	}
+	return iBestPos;
+}
+
+bool CBalaGrayMerge::Merge(int iOrigin1, int iOrigin2, int iPlace)
+{
+	// If the copies at the given origins, which differ only in the given place,
+	// are in different cycles, merge those cycles by switching a 4-cycle: edges
+	// a1-a2 and b1-b2 are replaced by a1-b1 and a2-b2. Returns true if merged.
+	int	iRoot1 = FindRoot(iOrigin1);
+	int	iRoot2 = FindRoot(iOrigin2);
+	if (iRoot1 == iRoot2)	// if already in same cycle
+		return false;
+	int	iPos = FindSwitch(iOrigin1, iOrigin2);
+	if (iPos < 0)	// if no edge is free in both copies
+		return false;
+	int	nCycleLen = static_cast<int>(m_arrBaseCycle.size());
+	int	iFrom = m_arrBaseCycle[iPos];
+	int	iTo = m_arrBaseCycle[(iPos + 1) % nCycleLen];
+	int	iA1 = iOrigin1 + iFrom;
+	int	iA2 = iOrigin1 + iTo;
+	int	iB1 = iOrigin2 + iFrom;
+	int	iB2 = iOrigin2 + iTo;
+	ReplaceNeighbor(iA1, iA2, iB1);
+	ReplaceNeighbor(iA2, iA1, iB2);
+	ReplaceNeighbor(iB1, iB2, iA1);
+	ReplaceNeighbor(iB2, iB1, iA2);
+	m_arrTrans[GetChangedPlace(iFrom, iTo)] -= 2;
+	m_arrTrans[iPlace] += 2;
+	m_arrParent[iRoot1] = iRoot2;
+	m_stats.nMerges++;
+	return true;
+}
+
+bool CBalaGrayMerge::MergeCover()
+{
+	// Each round, take the least used place that has untried candidates, and
+	// try to merge the next copy with the copy one value above it in that
+	// place. Each candidate is tried once, so this takes linear time. If copies
+	// remain unmerged because their free edges ran out, try all other values.
+	int	nCopies = static_cast<int>(m_arrOrigin.size());
+	int	nCycles = nCopies;
+	int	arrCursor[CBalaGray::MAX_PLACES] = {0};	// next candidate copy for each place
+	while (nCycles > 1) {	// while cover isn't merged
+		int	iPlace = -1;
+		for (int iPl = 0; iPl < m_nPlaces; iPl++) {	// for each place
+			if (!m_arrIsCoverPlace[iPl] && arrCursor[iPl] < nCopies
+			&& (iPlace < 0 || m_arrTrans[iPl] < m_arrTrans[iPlace]))	// if least used place with candidates
+				iPlace = iPl;
+		}
+		if (iPlace < 0)	// if candidates exhausted
+			break;
+		int	iOrigin = m_arrOrigin[arrCursor[iPlace]++];
+		int	nDigit = GetDigit(iOrigin, iPlace);
+		int	iOther = iOrigin + ((nDigit + 1) % m_arrBase[iPlace] - nDigit) * m_arrStride[iPlace];
+		if (Merge(iOrigin, iOther, iPlace))
+			nCycles--;
+	}
+	for (int iCopy = 0; iCopy < nCopies && nCycles > 1; iCopy++) {	// for each copy, while cover isn't merged
+		int	iOrigin = m_arrOrigin[iCopy];
+		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+			if (m_arrIsCoverPlace[iPlace])
+				continue;
+			int	nDigit = GetDigit(iOrigin, iPlace);
+			for (int iVal = 0; iVal < m_arrBase[iPlace]; iVal++) {	// for each other value of place
+				if (iVal != nDigit && Merge(iOrigin, iOrigin + (iVal - nDigit) * m_arrStride[iPlace], iPlace))
+					nCycles--;
+			}
+		}
+	}
+	return nCycles == 1;
+}
+
+bool CBalaGrayMerge::ExtractCycle()
+{
+	// walk the merged cycle from state zero; returns false if it doesn't visit every state
+	m_arrCycle.resize(m_nStates);
+	m_arrPos.resize(m_nStates);
+	int	iPrev = m_arrLink[0].arrNbr[0];
+	int	iState = 0;
+	for (int iPos = 0; iPos < m_nStates; iPos++) {	// for each position
+		if (iPos && !iState)	// if returned to start early
+			return false;
+		m_arrCycle[iPos] = iState;
+		m_arrPos[iState] = iPos;
+		const LINK&	link = m_arrLink[iState];
+		int	iNext = link.arrNbr[0] == iPrev ? link.arrNbr[1] : link.arrNbr[0];
+		iPrev = iState;
+		iState = iNext;
+	}
+	return !iState;
+}
+
+int CBalaGrayMerge::LabelCycles()
+{
+	// label each state with its cycle's index; returns number of cycles
+	m_arrLabel.assign(m_nStates, -1);
+	int	nCycles = 0;
+	for (int iStart = 0; iStart < m_nStates; iStart++) {	// for each state
+		if (m_arrLabel[iStart] >= 0)	// if cycle already labeled
+			continue;
+		int	iPrev = m_arrLink[iStart].arrNbr[0];
+		int	iState = iStart;
+		do {
+			m_arrLabel[iState] = nCycles;
+			const LINK&	link = m_arrLink[iState];
+			int	iNext = link.arrNbr[0] == iPrev ? link.arrNbr[1] : link.arrNbr[0];
+			iPrev = iState;
+			iState = iNext;
+		} while (iState != iStart);
+		nCycles++;
+	}
+	return nCycles;
+}
+
+int CBalaGrayMerge::SwitchSquares(int nMinGain, bool bMergeOnly)
+{
+	// For each edge u-v, find squares u-v-x-w, where w and x are u and v with
+	// another place changed to the same value, and w-x is also an edge. Switch
+	// edges u-v and w-x to u-w and v-x if the gain, i.e. how many more
+	// transitions the edges' place has than the other place, is at least the
+	// given minimum. If merging, only switch squares that join two cycles, as
+	// given by the labels and the union-find forest of labels. Otherwise the
+	// switch may split a cycle in two. Returns the number of switches.
+	int	nSwitches = 0;
+	for (int iU = 0; iU < m_nStates; iU++) {	// for each state
+		for (int iSide = 0; iSide < 2; iSide++) {	// for each of state's edges
+			int	iV = m_arrLink[iU].arrNbr[iSide];
+			int	iEdgePlace = GetChangedPlace(iU, iV);
+			bool	bSwitched = false;
+			for (int iPlace = 0; iPlace < m_nPlaces && !bSwitched; iPlace++) {	// for each place
+				if (iPlace == iEdgePlace || m_arrTrans[iEdgePlace] - m_arrTrans[iPlace] < nMinGain)
+					continue;
+				int	nDigit = GetDigit(iU, iPlace);
+				for (int iVal = 0; iVal < m_arrBase[iPlace]; iVal++) {	// for each other value of place
+					if (iVal == nDigit)
+						continue;
+					int	nOffset = (iVal - nDigit) * m_arrStride[iPlace];
+					int	iW = iU + nOffset;
+					int	iX = iV + nOffset;
+					if (!HasEdge(iW, iX) || HasEdge(iU, iW) || HasEdge(iV, iX))	// if not a switchable square
+						continue;
+					if (bMergeOnly) {
+						int	iRoot1 = FindRoot(m_arrLabel[iU]);
+						int	iRoot2 = FindRoot(m_arrLabel[iW]);
+						if (iRoot1 == iRoot2)	// if same cycle
+							continue;
+						m_arrParent[iRoot1] = iRoot2;
+					}
+					ReplaceNeighbor(iU, iV, iW);
+					ReplaceNeighbor(iV, iU, iX);
+					ReplaceNeighbor(iW, iX, iU);
+					ReplaceNeighbor(iX, iW, iV);
+					m_arrTrans[iEdgePlace] -= 2;
+					m_arrTrans[iPlace] += 2;
+					nSwitches++;
+					bSwitched = true;	// state's edges changed, so move on to its next edge
+					break;
+				}
+			}
+		}
+	}
+	return nSwitches;
+}
+
+int64_t CBalaGrayMerge::GetSquareSum() const
+{
+	// sum of squared transition counts; least when the counts are equal
+	int64_t	nSum = 0;
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		nSum += static_cast<int64_t>(m_arrTrans[iPlace]) * m_arrTrans[iPlace];
+	}
+	return nSum;
+}
+
+void CBalaGrayMerge::Balance()
+{
+	// Each round, switch every square whose place has at least three more
+	// transitions than the other place, which lowers the sum of squared
+	// counts, even if the switch splits the cycle. Then merge the resulting
+	// cycles by switching squares again, preferring switches that improve the
+	// balance, then those that don't worsen it, then any. If the cycles can't
+	// be merged, or the round didn't improve the balance, undo the round.
+	// Each round takes linear time.
+	for (int iRound = 0; iRound < MAX_BALANCE_ROUNDS; iRound++) {	// for each round
+		CLinkArray	arrPrevLink(m_arrLink);
+		int	arrPrevTrans[CBalaGray::MAX_PLACES];
+		memcpy(arrPrevTrans, m_arrTrans, sizeof(arrPrevTrans));
+		int64_t	nPrevSquareSum = GetSquareSum();
+		int	nSwitches = SwitchSquares(3, false);
+		if (!nSwitches)	// if balance can't be improved
+			break;
+		int	nCycles = LabelCycles();
+		m_arrParent.resize(nCycles);
+		for (int iCycle = 0; iCycle < nCycles; iCycle++) {	// for each cycle
+			m_arrParent[iCycle] = iCycle;
+		}
+		static const int	arrMinGain[] = {3, 0, INT_MIN / 2};
+		for (int iPass = 0; iPass < static_cast<int>(_countof(arrMinGain)) && nCycles > 1; iPass++) {	// for each merge pass
+			int	nMerges = SwitchSquares(arrMinGain[iPass], true);
+			nCycles -= nMerges;
+			nSwitches += nMerges;
+		}
+		if (nCycles > 1 || GetSquareSum() >= nPrevSquareSum) {	// if round failed
+			m_arrLink.swap(arrPrevLink);
+			memcpy(m_arrTrans, arrPrevTrans, sizeof(m_arrTrans));
+			break;
+		}
+		m_stats.nBalanceSwitches += nSwitches;
+	}
+}
+
+void CBalaGrayMerge::MakeWinner(SET_CODE nSetCode, CWinner& winner) const
+{
+	// Convert the cycle to numerals starting from zero, as the crawler's do, and
+	// compute its metrics. Spans are cyclic gaps between a place's transitions,
+	// as in the verifier; transition iPos is from numeral iPos - 1 to iPos.
+	int	nStates = m_nStates;
+	int	iStart = m_arrPos[0];
+	winner.m_nSetCode = nSetCode;
+	winner.m_nPlaces = m_nPlaces;
+	winner.m_nBaseSum = 0;
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		winner.m_nBaseSum += m_arrBase[iPlace];
+	}
+	winner.m_bIsProven = false;
+	winner.m_arrNum.resize(nStates);
+	for (int iNum = 0; iNum < nStates; iNum++) {	// for each numeral
+		int	iState = m_arrCycle[(iStart + iNum) % nStates];
+		NUMERAL&	num = winner.m_arrNum[iNum];
+		num.Zero();
+		for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+			num.b[iPlace] = static_cast<PLACE>(GetDigit(iState, iPlace));
+		}
+	}
+	CIntArray	arrTransPlace(nStates + 1);
+	int	arrTrans[CBalaGray::MAX_PLACES] = {0};
+	int	arrPrevTrans[CBalaGray::MAX_PLACES] = {0};
+	for (int iPos = 1; iPos <= nStates; iPos++) {	// for each transition, including wraparound
+		int	iPlace = GetChangedPlace(m_arrCycle[(iStart + iPos - 1) % nStates], m_arrCycle[(iStart + iPos) % nStates]);
+		assert(iPlace >= 0);
+		arrTransPlace[iPos] = iPlace;
+		arrTrans[iPlace]++;
+		arrPrevTrans[iPlace] = iPos;	// last transition, for now
+	}
+	for (int iPlace = 0; iPlace < m_nPlaces; iPlace++) {	// for each place
+		arrPrevTrans[iPlace] -= nStates;	// last transition minus a cycle closes first span
+	}
+	int	nMaxSpan = 0;
+	int64_t	nDevSum = 0;
+	for (int iPos = 1; iPos <= nStates; iPos++) {	// for each transition, including wraparound
+		int	iPlace = arrTransPlace[iPos];
+		int	nSpan = iPos - arrPrevTrans[iPlace];
+		int	nDev = nSpan - m_nPlaces;	// ideal mean span length is place count
+		nMaxSpan = std::max(nMaxSpan, nSpan);
+		nDevSum += static_cast<int64_t>(nDev) * nDev;
+		arrPrevTrans[iPlace] = iPos;
+	}
+	winner.m_nImbalance = *std::max_element(arrTrans, arrTrans + m_nPlaces) - *std::min_element(arrTrans, arrTrans + m_nPlaces);
+	winner.m_nMaxTrans = *std::max_element(arrTrans, arrTrans + m_nPlaces);
+	winner.m_nMaxSpan = nMaxSpan;
+	winner.SetDevSum(static_cast<int>(std::min(nDevSum, static_cast<int64_t>(INT_MAX - 1))));	// INT_MAX means no winner
+}
+
+bool CBalaGrayMerge::Build(SET_CODE nSetCode, CWinner& winner)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	if (CBalaGray::GetAdjacency(nSetCode) != CBalaGray::ADJ_ANY) {	// if restricted variant
+		printf("merge engine supports only unrestricted adjacency\n");
+		return false;
+	}
+	NUMERAL	arrBase;
+	int	nPlaces = CBalaGray::GetBases(nSetCode, arrBase);
+	if (nPlaces < 2) {
+		printf("invalid place count\n");
+		return false;
+	}
+	m_nPlaces = nPlaces;
+	m_nStates = 1;
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		int	nBase = arrBase.b[iPlace];
+		if (nBase < 2) {	// if place can't change
+			printf("invalid base\n");
+			return false;
+		}
+		if (m_nStates > MAX_STATES / nBase) {
+			printf("too many states\n");
+			return false;
+		}
+		m_arrBase[iPlace] = nBase;
+		m_arrStride[iPlace] = m_nStates;
+		m_nStates *= nBase;
+	}
+	MakeCover();
+	if (!MergeCover()) {
+		printf("can't merge cycle cover\n");
+		return false;
+	}
+	Balance();
+	if (!ExtractCycle()) {	// shouldn't happen
+		assert(0);
+		printf("merged cover isn't one cycle\n");
+		return false;
+	}
+	MakeWinner(nSetCode, winner);
+	return true;
+}
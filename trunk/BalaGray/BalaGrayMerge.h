@@ -0,0 +1,110 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayMerge.h : builds a cycle for any set by merging a cycle cover.
+//
+// For sets too large to crawl. The set's states are first covered by
+// disjoint short Gray cycles, all copies of one base cycle: either a cycle
+// through every value of one place, or a square on two binary places. Two
+// copies that differ in one other place are parallel, so any edge of one
+// and the matching edge of the other form a 4-cycle, and switching that
+// 4-cycle's edges merges the two copies into one cycle, trading two of the
+// base cycle's transitions for two transitions of the other place. Merges
+// are chosen to favor the least used places, until one cycle remains.
+// Merging alone leaves the base cycle's places overused, so the cycle is
+// then balanced in rounds: every square that trades an overused place for
+// a less used one is switched, even if that splits the cycle, and the
+// pieces are merged again. Each phase and round takes linear time.
+//
+// Unlike the crawler, the engine doesn't build numeral tables; states are
+// mixed-radix integers and their neighbors are computed, so it isn't
+// limited by the crawler's numeral count. Only unrestricted adjacency is
+// supported.
+
+#pragma once
+
+#include "BalaGray.h"
+
+class CBalaGrayMerge {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::PLACE PLACE;
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CWinner CWinner;
+	struct STATS {	// statistics of most recent build
+		int		nCoverCycles;	// number of cycles in initial cover
+		int		nMerges;		// number of switches that merged two cycles
+		int		nBalanceSwitches;	// number of switches made while balancing, including merges
+	};
+
+// Constants
+	enum {
+		MAX_STATES = 1 << 20,	// limited by memory and time, not by the crawler
+	};
+
+// Construction
+	CBalaGrayMerge();
+
+// Attributes
+	const STATS&	GetStats() const { return m_stats; }
+
+// Operations
+	bool	Build(SET_CODE nSetCode, CWinner& winner);
+
+protected:
+// Constants
+	enum {
+		MAX_BALANCE_ROUNDS = 16,	// maximum rounds of balancing switches
+	};
+
+// Types
+	typedef std::vector<int> CIntArray;
+	struct LINK {	// a state's two neighbors in its cycle, in no particular order
+		int		arrNbr[2];
+	};
+	typedef std::vector<LINK> CLinkArray;
+
+// Member data
+	int		m_nPlaces;			// number of places
+	int		m_nStates;			// number of states, i.e. product of bases
+	int		m_arrBase[CBalaGray::MAX_PLACES];	// base of each place
+	int		m_arrStride[CBalaGray::MAX_PLACES];	// state index increment per unit of each place
+	int		m_arrTrans[CBalaGray::MAX_PLACES];	// transition count of each place in current cycles
+	CIntArray	m_arrBaseCycle;	// state offsets of base cycle, relative to each copy's origin
+	CIntArray	m_arrOrigin;	// origin state of each copy of base cycle
+	CIntArray	m_arrParent;	// union-find forest of merged copies by origin state, or of merged cycles by label
+	CIntArray	m_arrLabel;		// index of each state's cycle, while balancing
+	CLinkArray	m_arrLink;		// each state's neighbors in its cycle
+	CIntArray	m_arrCycle;		// states in cycle order, once merged
+	CIntArray	m_arrPos;		// position of each state in cycle
+	bool	m_arrIsCoverPlace[CBalaGray::MAX_PLACES];	// true if place is used by base cycle
+	STATS	m_stats;			// statistics of most recent build
+
+// Helpers
+	int		GetDigit(int iState, int iPlace) const { return iState / m_arrStride[iPlace] % m_arrBase[iPlace]; }
+	int		GetChangedPlace(int iState1, int iState2) const;
+	bool	HasEdge(int iState1, int iState2) const;
+	void	ReplaceNeighbor(int iState, int iOldNbr, int iNewNbr);
+	int		FindRoot(int iNode);
+	void	MakeCover();
+	int		FindSwitch(int iOrigin1, int iOrigin2) const;
+	bool	Merge(int iOrigin1, int iOrigin2, int iPlace);
+	bool	MergeCover();
+	bool	ExtractCycle();
+	int		LabelCycles();
+	int		SwitchSquares(int nMinGain, bool bMergeOnly);
+	int64_t	GetSquareSum() const;
+	void	Balance();
+	void	MakeWinner(SET_CODE nSetCode, CWinner& winner) const;
+};
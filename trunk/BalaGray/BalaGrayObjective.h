@@ -0,0 +1,283 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	add MakeScore for lower bounds
+
+*/
+
+// BalaGrayObjective.h : objective policies for balanced Gray code crawler.
+//
+// The crawler always minimizes imbalance first, then maximum transition
+// count. An objective policy supplies the remaining criteria, as an array
+// of integer scores that are minimized in lexicographic order. The policy
+// is a template parameter of the crawl loop, so its hooks are inlined. A
+// policy is a class that provides the following:
+//
+//	SCORES			number of scores stored in a winner
+//	KEYS			number of leading scores that are compared; the rest are only reported
+//	HAS_BOUND		non-zero if GetBound is admissible and should be used for pruning
+//	Init			prepare to crawl a set, given its place and numeral counts
+//	Push			update state for a transition of the given place at the given depth
+//	Pop				undo Push at the given depth
+//	GetBound		lower bound of the keys of any complete permutation below the given depth
+//	GetLeafScore	scores of a complete permutation, whose last numeral is at the given depth
+//	StoreScore		copy scores to a winner; the winner's numerals must already be set
+//	LoadScore		copy scores from a winner
+//	MakeScore		scores from a maximum span length and sum of squared deviations
+//	GetColumnCount, GetColumnName, WriteColumn	report scores in tables and logs
+//
+// To add a criterion, write a policy and select it via CBalaGray::CObjective.
+
+#pragma once
+
+#include "BalaGray.h"
+#include <ostream>
+
+class CSpanTracker {	// tracks span lengths incrementally; base class of span policies
+public:
+// Types
+	typedef CBalaGray::PLACE PLACE;
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CWinner CWinner;
+
+// Operations
+	void	Init(int nPlaces, int nNumerals);
+	void	Push(int iDepth, int iPlace);
+	void	Pop(int iDepth);
+	void	CloseSpans(int iDepth, int iPlace, const NUMERAL& numLast, int& nMaxSpan, int& nDevSum) const;
+	static	const char	*GetColumnName(int iCol);
+	static	void	WriteColumn(std::ostream& os, const CWinner& winner, int iCol);
+
+protected:
+// Types
+	struct STATE {	// span state for one depth
+		PLACE	iTransPlace;	// index of place that transitioned at this depth
+		PLACE	iPrevTrans;		// that place's previous transition depth, or zero if none
+		PLACE	nMaxSpan;		// maximum length of spans closed so far
+		int		nDevSum;		// sum of squared deviations of spans closed so far, excluding first spans
+	};
+
+// Member data
+	int		m_nPlaces;	// number of places, which is also the ideal mean span length
+	std::vector<STATE>	m_arrState;	// span state for each depth
+	PLACE	m_arrLastTrans[CBalaGray::MAX_PLACES];	// depth of each place's latest transition, or zero if none
+	PLACE	m_arrFirstTrans[CBalaGray::MAX_PLACES];	// depth of each place's first transition, which is also its first span length
+
+// Helpers
+	int		CalcDeviance(int nSamp) const;
+};
+
+class CObjMaxSpan : public CSpanTracker {	// minimize maximum span length
+public:
+	enum {
+		SCORES = 1,		// maximum span length
+		KEYS = 1,
+		HAS_BOUND = 1,	// closed spans bound maximum span length
+	};
+	void	GetBound(int iDepth, int *parrKey) const;
+	void	GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const;
+	static	void	StoreScore(const int *parrScore, CWinner& winner) { winner.m_nMaxSpan = parrScore[0]; }
+	static	void	LoadScore(const CWinner& winner, int *parrScore) { parrScore[0] = winner.m_nMaxSpan; }
+	static	void	MakeScore(int nMaxSpan, int nDevSum, int *parrScore) { parrScore[0] = nMaxSpan; }
+	static	int		GetColumnCount() { return 1; }
+};
+
+class CObjStdDev : public CSpanTracker {	// minimize standard deviation of span lengths, ignoring maximum span length
+public:
+	enum {
+		SCORES = 2,		// sum of squared deviations, and maximum span length
+		KEYS = 1,		// maximum span length is only reported
+		HAS_BOUND = 1,	// closed spans bound sum of squared deviations
+	};
+	void	GetBound(int iDepth, int *parrKey) const;
+	void	GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const;
+	static	void	StoreScore(const int *parrScore, CWinner& winner);
+	static	void	LoadScore(const CWinner& winner, int *parrScore);
+	static	void	MakeScore(int nMaxSpan, int nDevSum, int *parrScore);
+	static	int		GetColumnCount() { return 2; }
+};
+
+class CObjMaxSpanStdDev : public CSpanTracker {	// minimize maximum span length, then standard deviation
+public:
+	enum {
+		SCORES = 2,		// maximum span length, and sum of squared deviations
+		KEYS = 2,
+		HAS_BOUND = 1,	// closed spans bound both keys
+	};
+	void	GetBound(int iDepth, int *parrKey) const;
+	void	GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const;
+	static	void	StoreScore(const int *parrScore, CWinner& winner);
+	static	void	LoadScore(const CWinner& winner, int *parrScore);
+	static	void	MakeScore(int nMaxSpan, int nDevSum, int *parrScore);
+	static	int		GetColumnCount() { return 2; }
+};
+
+inline void CSpanTracker::Init(int nPlaces, int nNumerals)
+{
+	m_nPlaces = nPlaces;
+	m_arrState.resize(nNumerals);
+	m_arrState[0].nMaxSpan = 0;
+	m_arrState[0].nDevSum = 0;
+	for (int iPlace = 0; iPlace < CBalaGray::MAX_PLACES; iPlace++) {	// for each place
+		m_arrLastTrans[iPlace] = 0;	// no transitions yet
+		m_arrFirstTrans[iPlace] = 0;
+	}
+}
+
+FORCE_INLINE int CSpanTracker::CalcDeviance(int nSamp) const
+{
+	int	nDev = nSamp - m_nPlaces;	// deviation from mean
+	return nDev * nDev;	// squared
+}
+
+FORCE_INLINE void CSpanTracker::Push(int iDepth, int iPlace)
+{
+	// Update span metrics for a transition of the given place at the given
+	// depth, closing the place's current span. A place's first span can't be
+	// scored until the sequence wraps around, so it only counts towards the
+	// maximum span length for now; CloseSpans accounts for its deviation.
+	STATE&	st = m_arrState[iDepth];
+	const STATE&	stPrev = m_arrState[iDepth - 1];
+	int	iLast = m_arrLastTrans[iPlace];
+	int	nSpan = iDepth - iLast;	// if first transition, span starts at depth zero
+	st.nMaxSpan = static_cast<PLACE>(nSpan > stPrev.nMaxSpan ? nSpan : stPrev.nMaxSpan);
+	st.nDevSum = stPrev.nDevSum;
+	if (iLast)	// if not first transition
+		st.nDevSum += CalcDeviance(nSpan);
+	else	// first transition
+		m_arrFirstTrans[iPlace] = static_cast<PLACE>(iDepth);
+	st.iTransPlace = static_cast<PLACE>(iPlace);
+	st.iPrevTrans = static_cast<PLACE>(iLast);
+	m_arrLastTrans[iPlace] = static_cast<PLACE>(iDepth);
+}
+
+FORCE_INLINE void CSpanTracker::Pop(int iDepth)
+{
+	// undo Push; first transition depth is only read if latest is non-zero, so leave it
+	const STATE&	st = m_arrState[iDepth];
+	m_arrLastTrans[st.iTransPlace] = st.iPrevTrans;
+}
+
+FORCE_INLINE void CSpanTracker::CloseSpans(int iDepth, int iPlace, const NUMERAL& numLast, int& nMaxSpan, int& nDevSum) const
+{
+	// Compute maximum span length and sum of squared deviations for a complete
+	// permutation, whose last numeral transitioned the given place. Spans closed
+	// by earlier transitions are already summed on the stack, so only the spans
+	// that are still open need to be closed, including wrap around to first state.
+	const STATE&	stPrev = m_arrState[iDepth - 1];
+	int	nNumerals = iDepth + 1;
+	int	nMax = stPrev.nMaxSpan;
+	int	nSum = stPrev.nDevSum;
+	for (int iPl = 0; iPl < m_nPlaces; iPl++) {	// for each place
+		int	iLast = m_arrLastTrans[iPl];
+		int	iFirst = m_arrFirstTrans[iPl];
+		if (iPl == iPlace) {	// if place transitioned at last numeral
+			int	nSpan = iDepth - iLast;
+			if (nSpan > nMax)
+				nMax = nSpan;
+			if (iLast)	// if not first transition
+				nSum += CalcDeviance(nSpan);
+			else	// first transition
+				iFirst = iDepth;
+			iLast = iDepth;
+		}
+		int	nSpan = nNumerals - iLast;	// length of final span, up to wraparound
+		if (numLast.b[iPl]) {	// if place transitions on wraparound; first state is assumed to be zero
+			nSum += CalcDeviance(nSpan) + CalcDeviance(iFirst);	// final and first spans are separate
+		} else {	// place doesn't transition; final span continues into first span
+			nSpan += iFirst;	// compute wrapped span length
+			nSum += CalcDeviance(nSpan);
+		}
+		if (nSpan > nMax)
+			nMax = nSpan;
+	}
+	nMaxSpan = nMax;
+	nDevSum = nSum;
+}
+
+inline const char *CSpanTracker::GetColumnName(int iCol)
+{
+	return iCol ? "StdDev" : "MaxSpan";
+}
+
+inline void CSpanTracker::WriteColumn(std::ostream& os, const CWinner& winner, int iCol)
+{
+	if (iCol)
+		os << winner.m_fStdDev;
+	else
+		os << winner.m_nMaxSpan;
+}
+
+FORCE_INLINE void CObjMaxSpan::GetBound(int iDepth, int *parrKey) const
+{
+	parrKey[0] = m_arrState[iDepth].nMaxSpan;
+}
+
+FORCE_INLINE void CObjMaxSpan::GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const
+{
+	int	nDevSum;
+	CloseSpans(iDepth, iPlace, numLast, parrScore[0], nDevSum);
+}
+
+FORCE_INLINE void CObjStdDev::GetBound(int iDepth, int *parrKey) const
+{
+	parrKey[0] = m_arrState[iDepth].nDevSum;
+}
+
+FORCE_INLINE void CObjStdDev::GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const
+{
+	CloseSpans(iDepth, iPlace, numLast, parrScore[1], parrScore[0]);
+}
+
+inline void CObjStdDev::StoreScore(const int *parrScore, CWinner& winner)
+{
+	winner.SetDevSum(parrScore[0]);
+	winner.m_nMaxSpan = parrScore[1];
+}
+
+inline void CObjStdDev::LoadScore(const CWinner& winner, int *parrScore)
+{
+	MakeScore(winner.m_nMaxSpan, winner.GetDevSum(), parrScore);
+}
+
+inline void CObjStdDev::MakeScore(int nMaxSpan, int nDevSum, int *parrScore)
+{
+	parrScore[0] = nDevSum;
+	parrScore[1] = nMaxSpan;
+}
+
+FORCE_INLINE void CObjMaxSpanStdDev::GetBound(int iDepth, int *parrKey) const
+{
+	// both are lower bounds, so their lexicographic pair is too
+	parrKey[0] = m_arrState[iDepth].nMaxSpan;
+	parrKey[1] = m_arrState[iDepth].nDevSum;
+}
+
+FORCE_INLINE void CObjMaxSpanStdDev::GetLeafScore(int iDepth, int iPlace, const NUMERAL& numLast, int *parrScore) const
+{
+	CloseSpans(iDepth, iPlace, numLast, parrScore[0], parrScore[1]);
+}
+
+inline void CObjMaxSpanStdDev::StoreScore(const int *parrScore, CWinner& winner)
+{
+	winner.m_nMaxSpan = parrScore[0];
+	winner.SetDevSum(parrScore[1]);
+}
+
+inline void CObjMaxSpanStdDev::LoadScore(const CWinner& winner, int *parrScore)
+{
+	MakeScore(winner.m_nMaxSpan, winner.GetDevSum(), parrScore);
+}
+
+inline void CObjMaxSpanStdDev::MakeScore(int nMaxSpan, int nDevSum, int *parrScore)
+{
+	parrScore[0] = nMaxSpan;
+	parrScore[1] = nDevSum;
+}
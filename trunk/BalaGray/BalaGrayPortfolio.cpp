@@ -0,0 +1,111 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	prove only if a crawl finished without heuristic cuts
+
+*/
+
+// BalaGrayPortfolio.cpp : parallel portfolio solver for a single set.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayPortfolio.h"
+#include <sstream>
+#include <algorithm>
+
+CBalaGrayPortfolio::CBalaGrayPortfolio()
+{
+	m_nConfigs = 0;
+	m_nFirstSeed = 1;
+	m_iBestConfig = -1;
+	m_nSharedBound = UINT64_MAX;
+}
+
+void CBalaGrayPortfolio::OnImprove(int iConfig, const CWinner& winner)
+{
+	// called from configuration's worker thread for each of its new incumbents
+	std::lock_guard<std::mutex> lk(m_mtx);
+	CONFIG&	config = m_arrConfig[iConfig];
+	config.nImprovements++;
+	if (winner.IsBetterThan(m_winBest)) {	// if best so far of any configuration
+		std::chrono::duration<double>	dur = std::chrono::steady_clock::now() - m_tStart;
+		m_winBest = winner;
+		m_iBestConfig = iConfig;
+		config.nGlobalImprovements++;
+		config.fLastSeconds = dur.count();
+		std::ostringstream	ss;
+		ss << std::fixed;	// same format as printf's %f
+		CBalaGray::WriteBalance(ss, winner);
+		printf("%.3f s: config %d (seed %u): %s\n", config.fLastSeconds, iConfig, config.nSeed, ss.str().c_str());
+	}
+}
+
+void CBalaGrayPortfolio::OnDone(int iConfig, const CJob& job, const CWinner& winner)
+{
+	// called from configuration's worker thread when its crawl ends
+	std::lock_guard<std::mutex> lk(m_mtx);
+	if (job.IsCanceled() || job.IsTimedOut())	// if crawl was stopped
+		return;
+	m_arrConfig[iConfig].bFinished = true;	// whole tree was crawled
+	if (!winner.m_bIsProven)	// if crawl made heuristic cuts, finishing proves nothing
+		return;
+	m_arrConfig[iConfig].bProven = true;	// best winner is optimal
+	for (int iJob = 0; iJob < static_cast<int>(m_arrJob.size()); iJob++) {	// for each configuration
+		if (iJob != iConfig)
+			m_arrJob[iJob]->Cancel();	// remaining crawls can't improve on best
+	}
+}
+
+bool CBalaGrayPortfolio::Solve(SET_CODE nSetCode, const OPTIONS& opts, CWinner& winner)
+{
+	int	nConfigs = m_nConfigs;
+	if (nConfigs <= 0)	// if configuration count unspecified
+		nConfigs = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	CBalaGrayJobQueue	queue(nConfigs);	// one worker per configuration, so all run at once
+	m_arrConfig.assign(nConfigs, CONFIG());
+	m_arrJob.clear();
+	m_winBest = CWinner();
+	m_iBestConfig = -1;
+	m_nSharedBound = UINT64_MAX;	// no bound yet
+	if (!opts.winIncumbent.m_arrNum.empty())	// if initial incumbent specified
+		m_winBest = opts.winIncumbent;	// configurations must beat it
+	m_tStart = std::chrono::steady_clock::now();
+	{
+		// hold lock while submitting, so callbacks don't see a partial job list
+		std::lock_guard<std::mutex> lk(m_mtx);
+		for (int iConfig = 0; iConfig < nConfigs; iConfig++) {	// for each configuration
+			CONFIG&	config = m_arrConfig[iConfig];
+			config.nSeed = iConfig ? m_nFirstSeed + iConfig - 1 : 0;	// first configuration is the usual crawl
+			OPTIONS	optsConfig(opts);
+			optsConfig.nSuccessorSeed = config.nSeed;
+			optsConfig.pSharedBound = &m_nSharedBound;
+			optsConfig.bVerbose = false;	// we report improvements instead
+			optsConfig.sLogPath.clear();	// configurations would clobber each other's logs
+			m_arrJob.push_back(queue.Submit(nSetCode, optsConfig,
+				[this, iConfig](const CJob& job, const CWinner& winCur) { OnImprove(iConfig, winCur); },
+				[this, iConfig](const CJob& job, const CWinner& winCur) { OnDone(iConfig, job, winCur); }
+			));
+		}
+	}
+	queue.WaitAll();
+	winner = CWinner();
+	bool	bIsProven = false;
+	for (int iConfig = 0; iConfig < nConfigs; iConfig++) {	// for each configuration
+		CWinner	winConfig = m_arrJob[iConfig]->Wait();
+		if (winConfig.m_arrNum.empty())	// if crawl failed, e.g. invalid set
+			return false;
+		m_arrConfig[iConfig].nNodes = m_arrJob[iConfig]->GetNodeCount();
+		if (m_arrConfig[iConfig].bProven)
+			bIsProven = true;
+		if (!iConfig || winConfig.IsBetterThan(winner))	// if first or best winner
+			winner = winConfig;
+	}
+	winner.m_bIsProven = bIsProven;
+	return true;
+}
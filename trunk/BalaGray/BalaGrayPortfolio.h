@@ -0,0 +1,80 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	prove only if a crawl finished without heuristic cuts
+
+*/
+
+// BalaGrayPortfolio.h : parallel portfolio solver for a single set.
+//
+// Crawls the same set with several configurations at once, each with its
+// own successor order, so that they explore the tree in different orders
+// and find different incumbents early on. The crawlers share one atomic
+// bound, so each prunes with the best metrics found by any of them. Each
+// crawler covers the whole tree, so the first one to finish without any
+// heuristic cuts proves the best winner found by all of them, and the others
+// are canceled; if pruning thresholds cut branches that might have beaten the
+// best, finishing proves nothing, and the others keep going. Improvements
+// are attributed to the configuration that found them, so that good
+// configurations can be learned per set.
+
+#pragma once
+
+#include "BalaGrayJobs.h"
+
+class CBalaGrayPortfolio {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGrayJobQueue::OPTIONS OPTIONS;
+	typedef CBalaGrayJobQueue::CJob CJob;
+	struct CONFIG {	// one configuration of the portfolio
+		uint32_t	nSeed;			// successor order seed, or zero for natural order
+		int		nImprovements;		// number of times configuration improved its own incumbent
+		int		nGlobalImprovements;	// number of times configuration improved the portfolio's best
+		double	fLastSeconds;		// time of configuration's latest global improvement, in seconds
+		uint64_t	nNodes;			// number of nodes crawled
+		bool	bFinished;			// true if configuration crawled its whole tree
+		bool	bProven;			// true if configuration's crawl proved the best winner optimal
+	};
+	typedef std::vector<CONFIG> CConfigArray;
+
+// Construction
+	CBalaGrayPortfolio();
+
+// Attributes
+	void	SetConfigCount(int nConfigs) { m_nConfigs = nConfigs; }
+	void	SetFirstSeed(uint32_t nSeed) { m_nFirstSeed = nSeed; }
+	const CConfigArray&	GetConfigs() const { return m_arrConfig; }
+	int		GetBestConfig() const { return m_iBestConfig; }
+
+// Operations
+	bool	Solve(SET_CODE nSetCode, const OPTIONS& opts, CWinner& winner);
+
+protected:
+// Types
+	typedef std::vector<CBalaGrayJobQueue::CJobPtr> CJobArray;
+
+// Member data
+	int		m_nConfigs;		// number of configurations, or zero for one per core
+	uint32_t	m_nFirstSeed;	// seed of second configuration; first uses natural order
+	CConfigArray	m_arrConfig;	// configurations
+	CJobArray	m_arrJob;		// one job per configuration
+	CWinner	m_winBest;			// best winner found by any configuration
+	int		m_iBestConfig;		// index of configuration that found best winner, or -1 if none
+	CBalaGray::CSharedBound	m_nSharedBound;	// packed metrics of best winner, shared by crawlers
+	std::chrono::steady_clock::time_point	m_tStart;	// when solve started
+	std::mutex	m_mtx;			// protects members above during solve
+
+// Helpers
+	void	OnImprove(int iConfig, const CWinner& winner);
+	void	OnDone(int iConfig, const CJob& job, const CWinner& winner);
+};
@@ -0,0 +1,446 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayServer.cpp : local solve server backed by a winner cache.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayServer.h"
+#include <sstream>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <afunix.h>	// Unix domain sockets need Windows 10 version 1803 or later
+#pragma comment(lib, "ws2_32.lib")
+#define SHUT_RDWR SD_BOTH
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+
+#ifndef MSG_NOSIGNAL	// if platform can't suppress SIGPIPE per send
+#define MSG_NOSIGNAL 0
+#endif
+
+CBalaGrayServer::CBalaGrayServer(int nMaxSolves) : m_queue(nMaxSolves)
+{
+	m_stats.nHits = 0;
+	m_stats.nMisses = 0;
+	m_stats.nJoins = 0;
+	m_nClients = 0;
+	m_bStop = false;
+	m_sockListen = INVALID_SOCKET;
+	m_nSaves = 0;
+}
+
+int CBalaGrayServer::GetCacheSize() const
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	return static_cast<int>(m_mapWinner.size());
+}
+
+bool CBalaGrayServer::IsValid(const CWinner& winner)
+{
+	return !winner.m_arrNum.empty() && winner.m_nImbalance != INT_MAX;
+}
+
+std::string CBalaGrayServer::FormatWinner(const char *pszTag, const CWinner& winner)
+{
+	std::ostringstream	ss;
+	ss << pszTag << ' ' << winner << '\n';
+	return ss.str();
+}
+
+std::string CBalaGrayServer::FormatSet(const char *pszTag, SET_CODE nSetCode)
+{
+	std::ostringstream	ss;
+	ss << pszTag << ' ' << std::hex << nSetCode << '\n';
+	return ss.str();
+}
+
+bool CBalaGrayServer::Send(CLIENT& client, const std::string& sLine)
+{
+	std::lock_guard<std::mutex> lk(client.m_mtxSend);
+	if (!client.m_bOpen)	// if client is gone
+		return false;
+	const char	*pData = sLine.c_str();
+	int	nRemain = static_cast<int>(sLine.size());
+	while (nRemain > 0) {	// send may be partial
+		int	nSent = static_cast<int>(send(static_cast<SOCKET_HANDLE>(client.m_sock), pData, nRemain, MSG_NOSIGNAL));
+		if (nSent <= 0) {	// if client disconnected
+			client.m_bOpen = false;
+			return false;
+		}
+		pData += nSent;
+		nRemain -= nSent;
+	}
+	return true;
+}
+
+void CBalaGrayServer::Broadcast(const CClientArray& arrClient, const std::string& sLine)
+{
+	for (const CClientPtr& pClient : arrClient) {	// for each client
+		Send(*pClient, sLine);	// failures are ignored; client thread cleans up
+	}
+}
+
+bool CBalaGrayServer::UpdateCache(const CWinner& winner)
+{
+	// Cache winner if it's better than the cached one, or if it proves that
+	// the cached one is optimal. Returns true if cache changed. Caller must
+	// hold our mutex.
+	if (!IsValid(winner))
+		return false;
+	CWinnerMap::iterator	iter = m_mapWinner.find(winner.m_nSetCode);
+	if (iter == m_mapWinner.end()) {	// if set not cached yet
+		m_mapWinner[winner.m_nSetCode] = winner;
+		return true;
+	}
+	CWinner&	winCached = iter->second;
+	if (winner.IsBetterThan(winCached)) {	// if better than cached winner
+		winCached = winner;
+		return true;
+	}
+	if (winner.m_bIsProven && !winCached.m_bIsProven && !winCached.IsBetterThan(winner)) {	// if proof of equal winner
+		winCached.m_bIsProven = true;	// cached winner is optimal too
+		return true;
+	}
+	return false;
+}
+
+bool CBalaGrayServer::LoadCache()
+{
+	if (m_sCachePath.empty())	// if no cache file
+		return true;
+	FILE	*pFile = fopen(m_sCachePath.c_str(), "r");
+	if (pFile == NULL)	// if file doesn't exist yet, start with empty cache
+		return true;
+	fclose(pFile);
+	CBalaGray::CWinnerArray	arrWin;
+	if (!arrWin.Read(m_sCachePath.c_str()))
+		return false;
+	// Cached winners seed solves, so their metrics and proofs are trusted;
+	// rescore them, drop any that aren't Gray cycles, and drop the proof of
+	// any whose stored metrics were wrong.
+	CBalaGray	bg;
+	std::lock_guard<std::mutex> lk(m_mtx);
+	for (const CWinner& winner : arrWin) {	// for each winner in file
+		if (!IsValid(winner))	// if empty
+			continue;
+		CWinner	winCheck(winner);
+		if (!bg.Score(winCheck)) {	// if not a Gray cycle of its set
+			printf("%llX: dropped invalid cached winner\n", static_cast<unsigned long long>(winner.m_nSetCode));
+			continue;
+		}
+		if (!winCheck.IsBetterThan(winner) && !winner.IsBetterThan(winCheck))	// if stored metrics were right
+			winCheck.m_bIsProven = winner.m_bIsProven;	// keep its proof
+		UpdateCache(winCheck);
+	}
+	return true;
+}
+
+bool CBalaGrayServer::SaveCache() const
+{
+	if (m_sCachePath.empty())	// if no cache file
+		return true;
+	// Solves can finish on several worker threads at once, so saves are
+	// serialized; the snapshot is taken under the save lock too, so a later
+	// save never writes older winners than an earlier one.
+	std::lock_guard<std::mutex> lkSave(m_mtxSave);
+	CBalaGray::CWinnerArray	arrWin;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		for (const auto& item : m_mapWinner) {	// for each cached winner, in set order
+			arrWin.push_back(item.second);
+		}
+	}
+	// write to temporary file, then rename it over the cache, so readers
+	// never see a partial file, nor a missing one
+	std::ostringstream	ssTemp;
+	ssTemp << m_sCachePath << ".tmp" << m_nSaves++;
+	std::string	sTempPath(ssTemp.str());
+	if (!arrWin.Write(sTempPath.c_str())) {
+		remove(sTempPath.c_str());
+		return false;
+	}
+#if defined(_WIN32)	// rename can't replace an existing file on Windows
+	bool	bRenamed = MoveFileExA(sTempPath.c_str(), m_sCachePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else	// rename replaces atomically
+	bool	bRenamed = rename(sTempPath.c_str(), m_sCachePath.c_str()) == 0;
+#endif
+	if (!bRenamed) {
+		printf("can't rename '%s'\n", sTempPath.c_str());
+		remove(sTempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+void CBalaGrayServer::OnIncumbent(SET_CODE nSetCode, const CWinner& winner)
+{
+	// called from solve's worker thread for each new incumbent
+	CClientArray	arrClient;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		UpdateCache(winner);
+		CSolveMap::iterator	iter = m_mapSolve.find(nSetCode);
+		if (iter == m_mapSolve.end())	// shouldn't happen
+			return;
+		iter->second.winBest = winner;
+		arrClient = iter->second.arrClient;
+	}
+	Broadcast(arrClient, FormatWinner("incumbent", winner));	// send without lock, as clients may be slow
+}
+
+void CBalaGrayServer::OnDone(SET_CODE nSetCode, const CWinner& winner)
+{
+	// called from solve's worker thread when its crawl ends
+	CClientArray	arrClient;
+	CWinner	winFinal;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		UpdateCache(winner);
+		CSolveMap::iterator	iter = m_mapSolve.find(nSetCode);
+		if (iter != m_mapSolve.end()) {
+			arrClient.swap(iter->second.arrClient);
+			m_mapSolve.erase(iter);
+		}
+		CWinnerMap::const_iterator	iterWin = m_mapWinner.find(nSetCode);
+		if (iterWin != m_mapWinner.end())	// best winner may be a cached one that solve didn't beat
+			winFinal = iterWin->second;
+	}
+	if (IsValid(winFinal)) {
+		Broadcast(arrClient, FormatWinner("done", winFinal));
+		SaveCache();
+	} else {	// solve failed, e.g. set is too big, or was canceled before it found a winner
+		std::ostringstream	ss;
+		ss << "error no winner for " << std::hex << nSetCode << '\n';
+		Broadcast(arrClient, ss.str());
+	}
+}
+
+void CBalaGrayServer::OnSolve(CClientPtr pClient, SET_CODE nSetCode, bool bRequireProven, const OPTIONS& opts)
+{
+	std::string	sCached;
+	std::string	sReply;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		CWinnerMap::const_iterator	iterWin = m_mapWinner.find(nSetCode);
+		bool	bHit = iterWin != m_mapWinner.end();
+		if (bHit) {	// if set is cached
+			sCached = FormatWinner("cached", iterWin->second);
+			if (iterWin->second.m_bIsProven || !bRequireProven) {	// if cached winner is good enough
+				m_stats.nHits++;
+				sReply = FormatWinner("done", iterWin->second);
+			}
+		}
+		if (sReply.empty()) {	// if solve needed
+			CSolveMap::iterator	iterSolve = m_mapSolve.find(nSetCode);
+			if (iterSolve != m_mapSolve.end()) {	// if set is already being solved, join that solve
+				SOLVE&	solve = iterSolve->second;
+				solve.arrClient.push_back(pClient);
+				m_stats.nJoins++;
+				sReply = FormatSet("joined", nSetCode);
+				if (IsValid(solve.winBest))	// if solve has an incumbent, client needn't wait for next one
+					sReply += FormatWinner("incumbent", solve.winBest);
+			} else {	// start a new solve
+				SOLVE&	solve = m_mapSolve[nSetCode];
+				solve.arrClient.push_back(pClient);
+				m_stats.nMisses++;
+				sReply = FormatSet("queued", nSetCode);
+				OPTIONS	optsSolve(opts);
+				if (bHit)	// if cached winner exists, solve must beat it
+					optsSolve.winIncumbent = iterWin->second;
+				// callbacks lock our mutex, so they wait until we're done here
+				solve.pJob = m_queue.Submit(nSetCode, optsSolve,
+					[this, nSetCode](const CJob& job, const CWinner& winner) { OnIncumbent(nSetCode, winner); },
+					[this, nSetCode](const CJob& job, const CWinner& winner) { OnDone(nSetCode, winner); }
+				);
+			}
+		}
+		// reply before unlocking, so a new solve's incumbents can't overtake it
+		Send(*pClient, sCached + sReply);
+	}
+}
+
+bool CBalaGrayServer::OnRequest(CClientPtr pClient, const std::string& sLine)
+{
+	// Handle one request line. Returns false if client's connection should close.
+	std::istringstream	ss(sLine);
+	std::string	sCmd;
+	if (!(ss >> sCmd))	// if blank line
+		return true;
+	if (sCmd == "solve" || sCmd == "get") {
+		std::string	sSet;
+		ss >> sSet;
+		SET_CODE	nSetCode = static_cast<SET_CODE>(strtoull(sSet.c_str(), NULL, 16));
+		CBalaGray::NUMERAL	arrBase;
+		if (CBalaGray::GetBases(nSetCode, arrBase) < 2) {	// if invalid set
+			Send(*pClient, "error invalid set '" + sSet + "'\n");
+			return true;
+		}
+		if (sCmd == "get") {
+			std::string	sReply;
+			{
+				std::lock_guard<std::mutex> lk(m_mtx);
+				CWinnerMap::const_iterator	iterWin = m_mapWinner.find(nSetCode);
+				if (iterWin != m_mapWinner.end())
+					sReply = FormatWinner("cached", iterWin->second);
+			}
+			Send(*pClient, sReply.empty() ? FormatSet("miss", nSetCode) : sReply);
+			return true;
+		}
+		OPTIONS	opts;
+		if (m_fnOptions)	// if default options supplied
+			m_fnOptions(nSetCode, opts);
+		bool	bRequireProven = false;
+		std::string	sOpt;
+		while (ss >> sOpt) {	// for each option
+			if (sOpt == "proven") {
+				bRequireProven = true;
+			} else if (!sOpt.compare(0, 8, "timeout=")) {
+				opts.nTimeoutMillis = static_cast<unsigned int>(atof(sOpt.c_str() + 8) * 1000);
+			} else if (!sOpt.compare(0, 5, "beam=")) {
+				opts.nBeamWidth = std::max(atoi(sOpt.c_str() + 5), 1);
+			} else {
+				Send(*pClient, "error unknown option '" + sOpt + "'\n");
+				return true;
+			}
+		}
+		OnSolve(pClient, nSetCode, bRequireProven, opts);
+	} else if (sCmd == "stats") {
+		std::ostringstream	ssReply;
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			ssReply << "stats cached=" << m_mapWinner.size() << " solving=" << m_mapSolve.size()
+				<< " hits=" << m_stats.nHits << " misses=" << m_stats.nMisses << " joins=" << m_stats.nJoins
+				<< " clients=" << m_nClients << " workers=" << m_queue.GetThreadCount() << '\n';
+		}
+		Send(*pClient, ssReply.str());
+	} else if (sCmd == "shutdown") {
+		Shutdown();
+		return false;
+	} else {
+		Send(*pClient, "error unknown command '" + sCmd + "'\n");
+	}
+	return true;
+}
+
+void CBalaGrayServer::ClientFunc(CClientPtr pClient)
+{
+	std::string	sBuf;
+	char	szRecv[1024];
+	bool	bOpen = true;
+	while (bOpen) {
+		int	nRecv = static_cast<int>(recv(static_cast<SOCKET_HANDLE>(pClient->m_sock), szRecv, sizeof(szRecv), 0));
+		if (nRecv <= 0)	// if client disconnected, or server is shutting down
+			break;
+		sBuf.append(szRecv, nRecv);
+		size_t	iEnd;
+		while (bOpen && (iEnd = sBuf.find('\n')) != std::string::npos) {	// for each complete line
+			std::string	sLine(sBuf, 0, iEnd);
+			sBuf.erase(0, iEnd + 1);
+			if (!sLine.empty() && sLine.back() == '\r')	// tolerate CRLF
+				sLine.pop_back();
+			bOpen = OnRequest(pClient, sLine);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lkSend(pClient->m_mtxSend);	// wait for any send in progress
+		pClient->m_bOpen = false;	// solves still holding this client skip it from now on
+		closesocket(static_cast<SOCKET_HANDLE>(pClient->m_sock));
+	}
+	std::lock_guard<std::mutex> lk(m_mtx);
+	m_arrClient.erase(std::find(m_arrClient.begin(), m_arrClient.end(), pClient));
+	m_nClients--;
+	m_cvClients.notify_all();
+}
+
+void CBalaGrayServer::Shutdown()
+{
+	// can be called from any thread; unblocks accept in Run
+	m_bStop = true;
+	SOCKET_HANDLE	sock = m_sockListen;
+	if (sock != INVALID_SOCKET)
+		shutdown(sock, SHUT_RDWR);
+}
+
+bool CBalaGrayServer::Run(const char *pszSocketPath)
+{
+	// Serve requests until shutdown is requested. Returns false on error.
+	struct sockaddr_un	addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(pszSocketPath) >= sizeof(addr.sun_path)) {
+		printf("socket path too long\n");
+		return false;
+	}
+	strcpy(addr.sun_path, pszSocketPath);
+	if (!LoadCache()) {
+		printf("can't read cache file '%s'\n", m_sCachePath.c_str());
+		return false;
+	}
+#if defined(_WIN32)
+	WSADATA	wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa)) {
+		printf("can't initialize sockets\n");
+		return false;
+	}
+#endif
+	SOCKET_HANDLE	sockListen = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sockListen == INVALID_SOCKET) {
+		printf("can't create socket\n");
+		return false;
+	}
+	remove(pszSocketPath);	// remove stale socket left by a previous server
+	if (bind(sockListen, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))
+	|| listen(sockListen, SOMAXCONN)) {
+		printf("can't listen on '%s'\n", pszSocketPath);
+		closesocket(sockListen);
+		return false;
+	}
+	m_sockListen = sockListen;
+	printf("listening on %s, %d cached winners, %d workers\n", pszSocketPath, GetCacheSize(), m_queue.GetThreadCount());
+	while (!m_bStop) {
+		SOCKET_HANDLE	sock = accept(sockListen, NULL, NULL);
+		if (sock == INVALID_SOCKET) {	// if shutdown, or error
+			if (!m_bStop)
+				printf("accept failed\n");
+			break;
+		}
+		CClientPtr	pClient(new CLIENT(sock));
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_arrClient.push_back(pClient);
+		m_nClients++;
+		std::thread(&CBalaGrayServer::ClientFunc, this, pClient).detach();	// client thread is tracked by count
+	}
+	m_sockListen = INVALID_SOCKET;
+	closesocket(sockListen);
+	remove(pszSocketPath);
+	m_queue.CancelAll();	// canceled solves still report their incumbents as done
+	m_queue.WaitAll();
+	{
+		std::unique_lock<std::mutex> lk(m_mtx);
+		for (const CClientPtr& pClient : m_arrClient) {	// for each connected client
+			shutdown(static_cast<SOCKET_HANDLE>(pClient->m_sock), SHUT_RDWR);	// unblock its receive
+		}
+		m_cvClients.wait(lk, [this]{ return !m_nClients; });
+	}
+#if defined(_WIN32)
+	WSACleanup();
+#endif
+	return SaveCache();
+}
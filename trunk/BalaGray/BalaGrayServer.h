@@ -0,0 +1,125 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayServer.h : local solve server backed by a winner cache.
+//
+// Listens on a Unix domain socket, so that other programs can ask for a
+// set's best ordering without running the batch and parsing its table. A
+// request for a cached set is answered at once. On a miss, or if the client
+// wants a proven winner and the cached one isn't, a solve is queued in the
+// background, seeded with the cached winner if any, and its incumbents are
+// streamed back as they improve. Requests for a set that's already being
+// solved join that solve instead of starting another. The job queue's
+// thread count bounds the number of concurrent solves. The cache is loaded
+// from a winner file, e.g. BalaGrayTable.dat, and saved back to it after
+// each solve.
+//
+// The protocol is line-based text. Requests:
+//
+//	solve SET [proven] [timeout=SECS] [beam=WIDTH]
+//	get SET		cache lookup only
+//	stats
+//	shutdown
+//
+// Replies, each tagged with its kind; WINNER is one line in winner file format:
+//
+//	cached WINNER		winner from cache
+//	queued SET			solve started
+//	joined SET			solve already in progress; replies follow as for queued
+//	incumbent WINNER	solve improved
+//	done WINNER			solve ended; WINNER's proven flag says if it's optimal
+//	miss SET			get found nothing
+//	stats NAME=VALUE ...
+//	error MESSAGE
+
+#pragma once
+
+#include "BalaGrayJobs.h"
+#include <map>
+
+class CBalaGrayServer {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGrayJobQueue::OPTIONS OPTIONS;
+	typedef CBalaGrayJobQueue::CJob CJob;
+	typedef std::function<void(SET_CODE nSetCode, OPTIONS& opts)> COptionsFunc;	// supplies a set's default options
+
+// Construction
+	CBalaGrayServer(int nMaxSolves = 0);
+
+// Attributes
+	void	SetOptionsFunc(COptionsFunc fnOptions) { m_fnOptions = fnOptions; }
+	void	SetCachePath(const char *pszPath) { m_sCachePath = pszPath; }	// empty for no file
+	int		GetCacheSize() const;
+
+// Operations
+	bool	Run(const char *pszSocketPath);
+	void	Shutdown();
+
+protected:
+// Types
+	typedef intptr_t SOCKET_HANDLE;	// platform's socket handle, as an integer
+	struct CLIENT {	// connected client
+		CLIENT(SOCKET_HANDLE sock) : m_sock(sock), m_bOpen(true) {}
+		SOCKET_HANDLE	m_sock;		// client's socket
+		std::atomic<bool>	m_bOpen;	// false once a send fails or client disconnects
+		std::mutex	m_mtxSend;		// serializes replies, which may come from several threads
+	};
+	typedef std::shared_ptr<CLIENT> CClientPtr;
+	typedef std::vector<CClientPtr> CClientArray;
+	struct SOLVE {	// solve in progress
+		CBalaGrayJobQueue::CJobPtr	pJob;	// solve's job
+		CClientArray	arrClient;	// clients waiting for replies
+		CWinner	winBest;	// best incumbent so far, or empty if none
+	};
+	typedef std::map<SET_CODE, SOLVE> CSolveMap;
+	typedef std::map<SET_CODE, CWinner> CWinnerMap;
+	struct STATS {	// request counters
+		int		nHits;		// solves answered from cache
+		int		nMisses;	// solves that queued a new solve
+		int		nJoins;		// solves that joined an existing solve
+	};
+
+// Member data
+	COptionsFunc	m_fnOptions;	// supplies default options, or empty for job queue's defaults
+	std::string	m_sCachePath;	// path of winner cache file, or empty for none
+	CWinnerMap	m_mapWinner;	// best known winner for each set
+	CSolveMap	m_mapSolve;		// solves in progress, keyed by set
+	STATS	m_stats;			// request counters
+	int		m_nClients;			// number of connected clients
+	CClientArray	m_arrClient;	// connected clients
+	std::atomic<bool>	m_bStop;	// true if shutdown was requested
+	std::atomic<SOCKET_HANDLE>	m_sockListen;	// listening socket
+	mutable std::mutex	m_mtx;	// protects members above, except where atomic
+	std::condition_variable	m_cvClients;	// signaled when a client disconnects
+	mutable std::mutex	m_mtxSave;	// serializes cache saves, which may come from several threads
+	mutable int	m_nSaves;		// number of cache saves started, for naming temporary files; protected by save mutex
+	CBalaGrayJobQueue	m_queue;	// runs solves; declared last, so its workers exit before the rest is destroyed
+
+// Helpers
+	void	ClientFunc(CClientPtr pClient);
+	bool	OnRequest(CClientPtr pClient, const std::string& sLine);
+	void	OnSolve(CClientPtr pClient, SET_CODE nSetCode, bool bRequireProven, const OPTIONS& opts);
+	void	OnIncumbent(SET_CODE nSetCode, const CWinner& winner);
+	void	OnDone(SET_CODE nSetCode, const CWinner& winner);
+	bool	UpdateCache(const CWinner& winner);
+	bool	LoadCache();
+	bool	SaveCache() const;
+	static	bool	Send(CLIENT& client, const std::string& sLine);
+	static	void	Broadcast(const CClientArray& arrClient, const std::string& sLine);
+	static	std::string	FormatWinner(const char *pszTag, const CWinner& winner);
+	static	std::string	FormatSet(const char *pszTag, SET_CODE nSetCode);
+	static	bool	IsValid(const CWinner& winner);
+};
@@ -0,0 +1,134 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGraySets.cpp : interval set generator.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGraySets.h"
+#include <math.h>
+#include <algorithm>
+
+CBalaGraySets::CBalaGraySets()
+{
+	m_nMaxRange = 12;	// same as IntervalSetsList.h
+	m_nMinPlaces = 2;
+	m_nMaxPlaces = CBalaGray::MAX_PLACES;
+	m_nMaxStates = INT_MAX;
+}
+
+void CBalaGraySets::SetPlaceBounds(int nMinPlaces, int nMaxPlaces)
+{
+	m_nMinPlaces = std::max(nMinPlaces, 2);	// a set must have at least two places
+	m_nMaxPlaces = std::min(nMaxPlaces, static_cast<int>(CBalaGray::MAX_PLACES));
+}
+
+CBalaGraySets::SET_CODE CBalaGraySets::GetPrimeForm(SET_CODE nSetCode)
+{
+	// IntervalSetsList.h defines prime form as excluding phase shifts and
+	// reversals, but its list in fact treats any permutation of a set's places
+	// as equivalent, e.g. 2323 is omitted in favor of 2233; this is sound, as
+	// the Gray code graph of a set doesn't depend on the order of its places.
+	// So the prime form is the set's place ranges in ascending order, which is
+	// also the least set code among all of the set's permutations.
+	CBalaGray::NUMERAL	arrBase;
+	int	nPlaces = CBalaGray::GetBases(nSetCode, arrBase);
+	std::sort(arrBase.b, arrBase.b + nPlaces);
+	SET_CODE	nPrime = 0;
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		nPrime = (nPrime << 4) | arrBase.b[iPlace];	// first place is leftmost nibble
+	}
+	return nPrime;
+}
+
+void CBalaGraySets::GetInfo(SET_CODE nSetCode, SET_INFO& info)
+{
+	CBalaGray::NUMERAL	arrBase;
+	info.nSetCode = nSetCode;
+	info.nPlaces = CBalaGray::GetBases(nSetCode, arrBase);
+	info.nRange = 0;
+	info.nDegree = 0;
+	double	fStates = 1;
+	for (int iPlace = 0; iPlace < info.nPlaces; iPlace++) {	// for each place
+		info.nRange += arrBase.b[iPlace];
+		info.nDegree += arrBase.b[iPlace] - 1;	// Gray successor can change place to any other value
+		fStates *= arrBase.b[iPlace];
+	}
+	info.nStates = fStates < INT_MAX ? static_cast<int>(fStates) : INT_MAX;
+	// Crude estimate: crawl is a depth-first search for a Hamiltonian cycle,
+	// so its tree has one level per state, and each level branches at most
+	// once per successor; pruning makes the actual tree far smaller.
+	info.fCost = fStates * log2(info.nDegree);
+}
+
+bool CBalaGraySets::Generate(CSetInfoArray& arrSet) const
+{
+	// Generate all prime-form sets within the current bounds, in the same
+	// order as IntervalSetsList.h: by place count, then range, then set code.
+	arrSet.clear();
+	CBalaGray::PLACE	arrBase[CBalaGray::MAX_PLACES];
+	for (int nPlaces = m_nMinPlaces; nPlaces <= m_nMaxPlaces; nPlaces++) {	// for each place count
+		if (nPlaces * 2 > m_nMaxRange)	// if minimum range exceeds limit
+			break;
+		if (!Generate(0, nPlaces, 0, 1, arrBase, arrSet))
+			return false;
+	}
+	std::stable_sort(arrSet.begin(), arrSet.end(),
+		[](const SET_INFO& a, const SET_INFO& b) {
+			if (a.nPlaces != b.nPlaces)
+				return a.nPlaces < b.nPlaces;
+			if (a.nRange != b.nRange)
+				return a.nRange < b.nRange;
+			return a.nSetCode < b.nSetCode;
+		}
+	);
+	return true;
+}
+
+bool CBalaGraySets::Generate(int iPlace, int nPlaces, int nRange, int nStates, CBalaGray::PLACE *parrBase, CSetInfoArray& arrSet) const
+{
+	// recursively enumerate place ranges, pruning by range and state count
+	if (iPlace == nPlaces) {	// if all places assigned
+		SET_CODE	nSetCode = 0;
+		for (int iBase = 0; iBase < nPlaces; iBase++) {	// for each place
+			nSetCode = (nSetCode << 4) | parrBase[iBase];	// first place is leftmost nibble
+		}
+		// ascending place ranges are prime by construction, but the code must
+		// also decode to the same bases, else its info would be wrong
+		if (!IsPrimeForm(nSetCode)) {	// if code doesn't round-trip through GetBases
+			printf("%llX: invalid set code\n", static_cast<unsigned long long>(nSetCode));
+			return false;
+		}
+		SET_INFO	info;
+		GetInfo(nSetCode, info);
+		arrSet.push_back(info);
+		return true;
+	}
+	int	nRemainPlaces = nPlaces - iPlace - 1;
+	int	nMinBase = iPlace ? parrBase[iPlace - 1] : 2;	// prime form's place ranges are ascending
+	int	nMaxBase = std::min(m_nMaxRange - nRange - nRemainPlaces * nMinBase, static_cast<int>(MAX_PLACE_RANGE));
+	for (int nBase = nMinBase; nBase <= nMaxBase; nBase++) {	// for each possible range of this place
+		if (static_cast<int64_t>(nStates) * nBase > m_nMaxStates)	// if too many states
+			break;	// larger ranges have even more states
+		parrBase[iPlace] = static_cast<CBalaGray::PLACE>(nBase);
+		if (!Generate(iPlace + 1, nPlaces, nRange + nBase, nStates * nBase, parrBase, arrSet))
+			return false;
+	}
+	return true;
+}
+
+void CBalaGraySets::SortByCost(CSetInfoArray& arrSet)
+{
+	// sort hardest first, so that long jobs start early instead of straggling at the end
+	std::stable_sort(arrSet.begin(), arrSet.end(),
+		[](const SET_INFO& a, const SET_INFO& b) { return a.fCost > b.fCost; });
+}
@@ -0,0 +1,69 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGraySets.h : interval set generator.
+//
+// Enumerates the prime-form set codes for a given maximum total range and
+// place count bounds, generalizing the hand-written list in IntervalSetsList.h
+// to other tunings. See that file for definitions, and GetPrimeForm. Each set also gets a rough
+// estimate of its search cost, so that batches can be scheduled hardest first.
+
+#pragma once
+
+#include "BalaGray.h"
+
+class CBalaGraySets {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	struct SET_INFO {	// info about one interval set
+		SET_CODE	nSetCode;	// set code in prime form
+		int		nPlaces;	// number of places
+		int		nRange;		// sum of place ranges
+		int		nStates;	// number of states, or INT_MAX if too many to count
+		int		nDegree;	// number of Gray successors of each state
+		double	fCost;		// estimated search cost, as log2 of search tree size
+		bool	IsCrawlable() const { return nStates <= CBalaGray::MAX_NUMERALS; }
+	};
+	typedef std::vector<SET_INFO> CSetInfoArray;
+
+// Construction
+	CBalaGraySets();
+
+// Attributes
+	void	SetMaxRange(int nRange) { m_nMaxRange = nRange; }
+	void	SetPlaceBounds(int nMinPlaces, int nMaxPlaces);
+	void	SetMaxStates(int nStates) { m_nMaxStates = nStates; }
+
+// Operations
+	bool	Generate(CSetInfoArray& arrSet) const;
+	static	void	SortByCost(CSetInfoArray& arrSet);
+	static	SET_CODE	GetPrimeForm(SET_CODE nSetCode);
+	static	bool	IsPrimeForm(SET_CODE nSetCode) { return GetPrimeForm(nSetCode) == nSetCode; }
+	static	void	GetInfo(SET_CODE nSetCode, SET_INFO& info);
+
+protected:
+// Constants
+	enum {
+		MAX_PLACE_RANGE = 0xf,	// a place's range must fit in a nibble of the set code
+	};
+
+// Member data
+	int		m_nMaxRange;	// maximum sum of place ranges
+	int		m_nMinPlaces;	// minimum number of places
+	int		m_nMaxPlaces;	// maximum number of places
+	int		m_nMaxStates;	// maximum number of states, or INT_MAX for no limit
+
+// Helpers
+	bool	Generate(int iPlace, int nPlaces, int nRange, int nStates, CBalaGray::PLACE *parrBase, CSetInfoArray& arrSet) const;
+};
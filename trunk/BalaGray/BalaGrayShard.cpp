@@ -0,0 +1,318 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	widen set code
+
+*/
+
+// BalaGrayShard.cpp : multi-process sharded crawl with a file-based work queue.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayShard.h"
+#include "BalaGrayJobs.h"
+#include <assert.h>	// debugging
+#include <stdio.h>
+#include <time.h>
+#include <thread>
+#include <chrono>
+
+#define MANIFEST_SIGNATURE "BalaGrayShard"	// first token of manifest file
+#define MANIFEST_VERSION 1	// manifest file version
+
+CBalaGrayShard::CBalaGrayShard(const char *pszDir)
+{
+	assert(pszDir != NULL);
+	m_sDir = pszDir;
+	if (!m_sDir.empty() && m_sDir.back() != '/' && m_sDir.back() != '\\')	// if separator missing
+		m_sDir += '/';	// forward slash works on all supported platforms
+	m_nSetCode = 0;
+	m_nPrefixLen = 0;
+	m_nPruneImbalance = 0;
+	m_nPruneMaxTrans = 0;
+}
+
+std::string CBalaGrayShard::GetPath(const char *pszName) const
+{
+	return m_sDir + pszName;
+}
+
+std::string CBalaGrayShard::GetJobPath(int iJob, const char *pszExt) const
+{
+	char	szName[32];
+	sprintf(szName, "job%05d.%s", iJob, pszExt);
+	return GetPath(szName);
+}
+
+bool CBalaGrayShard::FileExists(const std::string& sPath)
+{
+	FILE	*pFile = fopen(sPath.c_str(), "rb");
+	if (pFile == NULL)
+		return false;
+	fclose(pFile);
+	return true;
+}
+
+bool CBalaGrayShard::CreateExclusive(const std::string& sPath)
+{
+	// exclusive mode fails if file already exists; the check and the
+	// creation are atomic, so at most one process can own the file
+	FILE	*pFile = fopen(sPath.c_str(), "wx");
+	if (pFile == NULL)
+		return false;
+	fprintf(pFile, "%lld\n", static_cast<long long>(time(NULL)));	// creation time, for staleness test
+	fclose(pFile);
+	return true;
+}
+
+bool CBalaGrayShard::IsLockStale(const std::string& sPath)
+{
+	// true if lock's time stamp is older than the staleness limit
+	FILE	*pFile = fopen(sPath.c_str(), "r");
+	if (pFile == NULL)	// if lock vanished
+		return false;
+	long long	nLockTime;
+	bool	bStale = fscanf(pFile, "%lld", &nLockTime) == 1
+		&& time(NULL) - nLockTime > LOCK_STALE_SECONDS;
+	fclose(pFile);
+	return bStale;
+}
+
+void CBalaGrayShard::RefreshLock(const std::string& sPath)
+{
+	// overwrite lock's time stamp, so other workers know its owner is alive
+	FILE	*pFile = fopen(sPath.c_str(), "w");
+	if (pFile == NULL)
+		return;
+	fprintf(pFile, "%lld\n", static_cast<long long>(time(NULL)));
+	fclose(pFile);
+}
+
+bool CBalaGrayShard::ClaimJob(int iJob) const
+{
+	// If the job's lock is stale and the job isn't done, its worker died, so
+	// break the lock and try again. Two workers may both break it, in which
+	// case the job may be crawled twice, but its result is the same.
+	std::string	sLockPath(GetJobPath(iJob, "lock"));
+	if (CreateExclusive(sLockPath))
+		return true;
+	if (!IsLockStale(sLockPath) || FileExists(GetJobPath(iJob, "dat")))	// if owner is alive, or job is done
+		return false;
+	remove(sLockPath.c_str());	// assume owner died; break the lock
+	return CreateExclusive(sLockPath);
+}
+
+bool CBalaGrayShard::WriteManifest() const
+{
+	std::ofstream	fOut(GetPath("manifest.txt").c_str(), std::ios_base::trunc);
+	if (!fOut.good())
+		return false;
+	int	nJobs = GetJobCount();
+	fOut << MANIFEST_SIGNATURE << ' ' << MANIFEST_VERSION << '\n';
+	fOut << std::hex << m_nSetCode << std::dec << ' ' << m_nPrefixLen << ' '
+		<< m_nPruneImbalance << ' ' << m_nPruneMaxTrans << ' ' << nJobs << '\n';
+	for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+		for (int iNum = 0; iNum < m_nPrefixLen; iNum++) {	// for each numeral of job's prefix
+			if (iNum)
+				fOut << ' ';
+			fOut << int(m_arrPrefix[iJob][iNum]);
+		}
+		fOut << '\n';
+	}
+	fOut.close();
+	return !fOut.fail();
+}
+
+bool CBalaGrayShard::ReadManifest()
+{
+	std::ifstream	fIn(GetPath("manifest.txt").c_str());
+	if (!fIn.good()) {
+		printf("can't open manifest in '%s'\n", m_sDir.c_str());
+		return false;
+	}
+	std::string	sSignature;
+	int	nVersion = 0;
+	fIn >> sSignature >> nVersion;
+	if (sSignature != MANIFEST_SIGNATURE || nVersion != MANIFEST_VERSION) {
+		printf("invalid manifest\n");
+		return false;
+	}
+	int	nJobs = 0;
+	fIn >> std::hex >> m_nSetCode >> std::dec >> m_nPrefixLen >> m_nPruneImbalance >> m_nPruneMaxTrans >> nJobs;
+	if (fIn.fail() || m_nPrefixLen <= 0 || nJobs < 0) {
+		printf("invalid manifest\n");
+		return false;
+	}
+	m_arrPrefix.resize(nJobs);
+	for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+		m_arrPrefix[iJob].resize(m_nPrefixLen);
+		for (int iNum = 0; iNum < m_nPrefixLen; iNum++) {	// for each numeral of job's prefix
+			int	iVal;
+			fIn >> iVal;
+			m_arrPrefix[iJob][iNum] = static_cast<CBalaGray::PLACE>(iVal);
+		}
+	}
+	if (fIn.fail()) {
+		printf("manifest is truncated\n");
+		return false;
+	}
+	return true;
+}
+
+bool CBalaGrayShard::LockIncumbent() const
+{
+	std::string	sLockPath(GetPath("incumbent.lock"));
+	while (!CreateExclusive(sLockPath)) {	// while another worker holds the lock
+		if (IsLockStale(sLockPath)) {	// if lock is stale
+			remove(sLockPath.c_str());	// assume owner died; break the lock
+			continue;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(LOCK_RETRY_MILLIS));
+	}
+	return true;
+}
+
+void CBalaGrayShard::UnlockIncumbent() const
+{
+	remove(GetPath("incumbent.lock").c_str());
+}
+
+bool CBalaGrayShard::ReadIncumbent(CWinner& winner) const
+{
+	CBalaGray::CWinnerArray	arrWin;
+	LockIncumbent();
+	bool	bResult = arrWin.Read(GetPath("incumbent.dat").c_str());
+	UnlockIncumbent();
+	if (!bResult || arrWin.size() != 1)	// if no incumbent yet
+		return false;
+	winner = arrWin[0];
+	return true;
+}
+
+bool CBalaGrayShard::UpdateIncumbent(const CWinner& winner) const
+{
+	// replace shared incumbent if given winner is better
+	if (winner.m_nImbalance == INT_MAX)	// if winner is merely a placeholder
+		return false;
+	CBalaGray::CWinnerArray	arrWin;
+	std::string	sPath(GetPath("incumbent.dat"));
+	bool	bResult = false;
+	LockIncumbent();
+	if (!arrWin.Read(sPath.c_str()) || arrWin.size() != 1 || winner.IsBetterThan(arrWin[0])) {
+		arrWin.assign(1, winner);
+		arrWin[0].m_bIsProven = false;	// incumbent is only proven by merge step
+		bResult = arrWin.Write(sPath.c_str());
+	}
+	UnlockIncumbent();
+	return bResult;
+}
+
+bool CBalaGrayShard::Plan(SET_CODE nSetCode, int nPrefixLen, int nPruneImbalance, int nPruneMaxTrans)
+{
+	CBalaGray	bg;
+	bg.SetPruneImbalance(nPruneImbalance);
+	bg.SetPruneMaxTrans(nPruneMaxTrans);
+	if (!bg.EnumerateFrontier(nSetCode, nPrefixLen, m_arrPrefix))
+		return false;
+	m_nSetCode = nSetCode;
+	m_nPrefixLen = nPrefixLen;
+	m_nPruneImbalance = nPruneImbalance;
+	m_nPruneMaxTrans = nPruneMaxTrans;
+	if (!WriteManifest()) {
+		printf("can't write manifest in '%s'\n", m_sDir.c_str());
+		return false;
+	}
+	printf("%llX: %d jobs of prefix length %d\n", static_cast<unsigned long long>(m_nSetCode), GetJobCount(), m_nPrefixLen);
+	return true;
+}
+
+bool CBalaGrayShard::Work(unsigned int nTimeoutMillis, bool bVerbose)
+{
+	if (!ReadManifest())
+		return false;
+	CBalaGrayJobQueue	queue(1);	// one worker thread; run more processes for more cores
+	int	nJobs = GetJobCount();
+	for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+		std::string	sDonePath(GetJobPath(iJob, "dat"));
+		if (FileExists(sDonePath))	// if job already finished
+			continue;
+		if (!ClaimJob(iJob))	// if another worker claimed job first
+			continue;
+		CBalaGrayJobQueue::OPTIONS	opts;
+		opts.nPruneImbalance = m_nPruneImbalance;
+		opts.nPruneMaxTrans = m_nPruneMaxTrans;
+		opts.nTimeoutMillis = nTimeoutMillis;
+		opts.bVerbose = bVerbose;
+		opts.arrPrefix = m_arrPrefix[iJob];
+		ReadIncumbent(opts.winIncumbent);	// seed crawl with best result found by any worker
+		CBalaGrayJobQueue::CJobPtr	pJob = queue.Submit(m_nSetCode, opts,
+			[this](const CBalaGrayJobQueue::CJob& job, const CWinner& winner) {
+				UpdateIncumbent(winner);	// share improvement with other workers right away
+			}
+		);
+		std::string	sLockPath(GetJobPath(iJob, "lock"));
+		while (pJob->GetFuture().wait_for(std::chrono::seconds(LOCK_REFRESH_SECONDS)) != std::future_status::ready)
+			RefreshLock(sLockPath);	// job is still running
+		CWinner	winner = pJob->Wait();
+		if (winner.m_arrNum.empty()) {	// if crawl failed
+			printf("job %d failed\n", iJob);
+			return false;
+		}
+		// write partial winner to temporary file, then rename it, so merge never sees a partial file
+		std::string	sTempPath(GetJobPath(iJob, "tmp"));
+		CBalaGray::CWinnerArray	arrWin;
+		arrWin.assign(1, winner);
+		if (!arrWin.Write(sTempPath.c_str()) || rename(sTempPath.c_str(), sDonePath.c_str())) {
+			printf("can't write result of job %d\n", iJob);
+			return false;
+		}
+		UpdateIncumbent(winner);
+		printf("job %d of %d %s\n", iJob, nJobs, winner.m_bIsProven ? "done" : "timeout");
+	}
+	return true;
+}
+
+bool CBalaGrayShard::Merge(CWinner& winner, int& nFinished)
+{
+	// Combine partial winners. The result is proven only if every job
+	// finished without timing out, in which case the whole search space
+	// defined by the manifest was crawled.
+	if (!ReadManifest())
+		return false;
+	winner = CWinner();
+	CWinner	winInc;
+	if (ReadIncumbent(winInc) && winInc.m_nImbalance != INT_MAX)	// incumbent may include unfinished jobs' finds
+		winner = winInc;
+	int	nJobs = GetJobCount();
+	bool	bIsProven = true;
+	nFinished = 0;
+	for (int iJob = 0; iJob < nJobs; iJob++) {	// for each job
+		CBalaGray::CWinnerArray	arrWin;
+		if (!arrWin.Read(GetJobPath(iJob, "dat").c_str()) || arrWin.size() != 1) {	// if job unfinished
+			bIsProven = false;
+			continue;
+		}
+		nFinished++;
+		const CWinner&	winJob = arrWin[0];
+		if (!winJob.m_bIsProven)	// if job timed out
+			bIsProven = false;
+		if (winJob.m_nImbalance != INT_MAX && winJob.IsBetterThan(winner))
+			winner = winJob;
+	}
+	winner.m_nSetCode = m_nSetCode;
+	winner.m_bIsProven = bIsProven;
+	CBalaGray::CWinnerArray	arrWin;
+	if (!winner.m_arrNum.empty())	// if any winner was found
+		arrWin.push_back(winner);
+	if (!arrWin.Write(GetPath("merged.dat").c_str())) {
+		printf("can't write merged result in '%s'\n", m_sDir.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGrayShard.h : multi-process sharded crawl with a file-based work queue.
+//
+// A shard directory contains:
+//	manifest.txt		set code, prefix length, pruning thresholds and prefix jobs
+//	incumbent.dat		best winner found so far by any worker
+//	incumbent.lock		exists while a worker is reading or writing the incumbent
+//	jobNNNNN.lock		exists once a worker has claimed job NNNNN; refreshed while job runs
+//	jobNNNNN.dat		partial winner of job NNNNN; exists once job is finished
+//	merged.dat			final winner, written by merge step
+//
+// Any number of worker processes, on one host or on several hosts sharing
+// the directory, can work on the same manifest. Locks are files created
+// exclusively, so no other coordination is needed. A worker refreshes its
+// job's lock periodically, so if the worker dies, the lock goes stale, and
+// another worker reclaims the job.
+
+#pragma once
+
+#include "BalaGray.h"
+#include <string>
+
+class CBalaGrayShard {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGray::CPlaceArray CPlaceArray;
+	typedef CBalaGray::CPrefixArray CPrefixArray;
+
+// Construction
+	CBalaGrayShard(const char *pszDir);
+
+// Attributes
+	SET_CODE	GetSetCode() const { return m_nSetCode; }
+	int		GetJobCount() const { return static_cast<int>(m_arrPrefix.size()); }
+
+// Operations
+	bool	Plan(SET_CODE nSetCode, int nPrefixLen, int nPruneImbalance, int nPruneMaxTrans);
+	bool	Work(unsigned int nTimeoutMillis = 0, bool bVerbose = false);
+	bool	Merge(CWinner& winner, int& nFinished);
+
+protected:
+// Constants
+	enum {
+		LOCK_RETRY_MILLIS = 10,		// delay between attempts to acquire incumbent lock
+		LOCK_STALE_SECONDS = 30,	// lock older than this is assumed abandoned
+		LOCK_REFRESH_SECONDS = 10,	// interval at which a running job's lock is refreshed
+	};
+
+// Member data
+	std::string	m_sDir;		// shard directory, with trailing separator
+	SET_CODE	m_nSetCode;	// set code
+	int		m_nPrefixLen;	// length of each prefix
+	int		m_nPruneImbalance;	// imbalance pruning threshold
+	int		m_nPruneMaxTrans;	// maximum transition count pruning threshold
+	CPrefixArray	m_arrPrefix;	// array of prefix jobs
+
+// Helpers
+	std::string	GetPath(const char *pszName) const;
+	std::string	GetJobPath(int iJob, const char *pszExt) const;
+	bool	ReadManifest();
+	bool	WriteManifest() const;
+	static	bool	FileExists(const std::string& sPath);
+	static	bool	CreateExclusive(const std::string& sPath);
+	static	bool	IsLockStale(const std::string& sPath);
+	static	void	RefreshLock(const std::string& sPath);
+	bool	ClaimJob(int iJob) const;
+	bool	LockIncumbent() const;
+	void	UnlockIncumbent() const;
+	bool	ReadIncumbent(CWinner& winner) const;
+	bool	UpdateIncumbent(const CWinner& winner) const;
+};
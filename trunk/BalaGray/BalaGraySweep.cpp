@@ -0,0 +1,156 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGraySweep.cpp : parallel parameter sweep over solver configurations.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGraySweep.h"
+
+CBalaGraySweep::CBalaGraySweep()
+{
+	m_nThreads = 0;
+	m_nNodeLimit = 0;
+}
+
+void CBalaGraySweep::MakeGrid(const CIntArray& arrPruneImbalance, const CIntArray& arrPruneMaxTrans,
+	const CIntArray& arrDiscrepancyStep, const CIntArray& arrBeamWidth, CConfigArray& arrConfig)
+{
+	// make every combination of the given option values; beam width varies fastest
+	arrConfig.clear();
+	for (int nPruneImbalance : arrPruneImbalance) {
+		for (int nPruneMaxTrans : arrPruneMaxTrans) {
+			for (int nDiscrepancyStep : arrDiscrepancyStep) {
+				for (int nBeamWidth : arrBeamWidth) {
+					if (nDiscrepancyStep && nBeamWidth)	// if both search modes; beam search would override
+						continue;
+					CONFIG	config = {nPruneImbalance, nPruneMaxTrans, nDiscrepancyStep, nBeamWidth};
+					arrConfig.push_back(config);
+				}
+			}
+		}
+	}
+}
+
+bool CBalaGraySweep::Run()
+{
+	int	nSets = static_cast<int>(m_arrSet.size());
+	int	nConfigs = static_cast<int>(m_arrConfig.size());
+	if (!nSets || !nConfigs) {
+		printf("nothing to sweep\n");
+		return false;
+	}
+	m_arrResult.assign(nSets * nConfigs, RESULT());
+	std::vector<CBalaGrayJobQueue::CJobPtr>	arrJob;
+	{
+		CBalaGrayJobQueue	queue(m_nThreads);
+		for (int iSet = 0; iSet < nSets; iSet++) {	// for each set
+			for (int iConfig = 0; iConfig < nConfigs; iConfig++) {	// for each configuration
+				const CONFIG&	config = m_arrConfig[iConfig];
+				CBalaGrayJobQueue::OPTIONS	opts;
+				opts.nPruneImbalance = config.nPruneImbalance;
+				opts.nPruneMaxTrans = config.nPruneMaxTrans;
+				opts.nDiscrepancyStep = config.nDiscrepancyStep;
+				opts.nBeamWidth = config.nBeamWidth;
+				opts.nNodeLimit = m_nNodeLimit;
+				RESULT	*pResult = &m_arrResult[iSet * nConfigs + iConfig];
+				// each completion callback writes only its own result, so no lock is needed
+				arrJob.push_back(queue.Submit(m_arrSet[iSet], opts, nullptr,
+					[pResult](const CBalaGrayJobQueue::CJob& job, const CWinner& winner) {
+						pResult->fSeconds = job.GetElapsedSeconds();
+					}
+				));
+			}
+		}
+		queue.WaitAll();	// ensure all completion callbacks have run
+	}
+	bool	bResult = true;
+	for (int iJob = 0; iJob < static_cast<int>(arrJob.size()); iJob++) {	// for each job
+		RESULT&	result = m_arrResult[iJob];
+		result.winner = arrJob[iJob]->Wait();
+		result.nNodes = arrJob[iJob]->GetNodeCount();
+		if (result.winner.m_arrNum.empty()) {	// if crawl failed, e.g. invalid set
+			printf("%llX: sweep failed\n", static_cast<unsigned long long>(m_arrSet[iJob / nConfigs]));
+			bResult = false;
+		}
+	}
+	return bResult;
+}
+
+bool CBalaGraySweep::IsResultBetter(const RESULT& res1, const RESULT& res2) const
+{
+	// quality comes first, then proof, then cost
+	if (res1.winner.IsBetterThan(res2.winner))
+		return true;
+	if (res2.winner.IsBetterThan(res1.winner))
+		return false;
+	if (res1.winner.m_bIsProven != res2.winner.m_bIsProven)
+		return res1.winner.m_bIsProven;
+	return res1.nNodes < res2.nNodes;
+}
+
+int CBalaGraySweep::FindBestConfig(int iSet) const
+{
+	int	iBest = -1;
+	for (int iConfig = 0; iConfig < static_cast<int>(m_arrConfig.size()); iConfig++) {	// for each configuration
+		if (iBest < 0 || IsResultBetter(GetResult(iSet, iConfig), GetResult(iSet, iBest)))
+			iBest = iConfig;
+	}
+	return iBest;
+}
+
+std::string CBalaGraySweep::FormatOption(int nVal)
+{
+	// thresholds use INT_MAX to mean no threshold
+	return nVal == INT_MAX ? std::string("max") : std::to_string(nVal);
+}
+
+bool CBalaGraySweep::Write(const char *pszPath) const
+{
+	// write results matrix as CSV, one row per set and configuration
+	std::ofstream	fOut(pszPath, std::ios_base::trunc);
+	if (!fOut.good()) {
+		printf("can't create file '%s'\n", pszPath);
+		return false;
+	}
+	int	nScoreCols = CBalaGray::CObjective::GetColumnCount();
+	fOut << "Set,PruneImbalance,PruneMaxTrans,DiscrepancyStep,BeamWidth,Imbalance,MaxTrans";
+	for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+		fOut << ',' << CBalaGray::CObjective::GetColumnName(iCol);
+	}
+	fOut << ",Proven,Nodes,Seconds,Best\n";
+	int	nConfigs = static_cast<int>(m_arrConfig.size());
+	for (int iSet = 0; iSet < static_cast<int>(m_arrSet.size()); iSet++) {	// for each set
+		int	iBest = FindBestConfig(iSet);
+		for (int iConfig = 0; iConfig < nConfigs; iConfig++) {	// for each configuration
+			const CONFIG&	config = m_arrConfig[iConfig];
+			const RESULT&	result = GetResult(iSet, iConfig);
+			fOut << std::hex << std::uppercase << m_arrSet[iSet] << std::dec
+				<< ',' << FormatOption(config.nPruneImbalance)
+				<< ',' << FormatOption(config.nPruneMaxTrans)
+				<< ',' << config.nDiscrepancyStep
+				<< ',' << config.nBeamWidth
+				<< ',' << result.winner.m_nImbalance
+				<< ',' << result.winner.m_nMaxTrans;
+			for (int iCol = 0; iCol < nScoreCols; iCol++) {	// for each of objective policy's columns
+				fOut << ',';
+				CBalaGray::CObjective::WriteColumn(fOut, result.winner, iCol);
+			}
+			fOut << ',' << result.winner.m_bIsProven
+				<< ',' << result.nNodes
+				<< ',' << result.fSeconds
+				<< ',' << (iConfig == iBest)
+				<< '\n';
+		}
+	}
+	return true;
+}
@@ -0,0 +1,78 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+
+*/
+
+// BalaGraySweep.h : parallel parameter sweep over solver configurations.
+//
+// Solves each of a list of sets with each configuration of a grid of solver
+// options, all combinations running in parallel on the job queue. Each run
+// is limited to the same number of nodes rather than the same time, so that
+// results are comparable across machines and core counts. The results form
+// a matrix of quality, i.e. the winner's metrics, against cost, i.e. nodes
+// and seconds, from which the best configuration for each set is chosen.
+
+#pragma once
+
+#include "BalaGrayJobs.h"
+
+class CBalaGraySweep {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::CWinner CWinner;
+	typedef std::vector<int> CIntArray;
+	typedef std::vector<SET_CODE> CSetCodeArray;
+	struct CONFIG {	// one configuration of solver options
+		int		nPruneImbalance;	// prune branch if imbalance exceeds this value
+		int		nPruneMaxTrans;		// prune branch if maximum transition count exceeds this value
+		int		nDiscrepancyStep;	// if non-zero, limited discrepancy search raises its limit by this much per pass
+		int		nBeamWidth;			// if non-zero, beam search keeps this many partial paths per depth
+	};
+	typedef std::vector<CONFIG> CConfigArray;
+	struct RESULT {	// result of solving one set with one configuration
+		CWinner	winner;			// best winner found; proven if crawl finished within node limit
+		uint64_t	nNodes;		// number of nodes crawled
+		double	fSeconds;		// elapsed time in seconds
+	};
+	typedef std::vector<RESULT> CResultArray;
+
+// Construction
+	CBalaGraySweep();
+
+// Attributes
+	void	SetThreadCount(int nThreads) { m_nThreads = nThreads; }	// zero for one per core
+	void	SetNodeLimit(uint64_t nLimit) { m_nNodeLimit = nLimit; }	// zero for none
+	void	SetSets(const CSetCodeArray& arrSet) { m_arrSet = arrSet; }
+	void	SetConfigs(const CConfigArray& arrConfig) { m_arrConfig = arrConfig; }
+	const CSetCodeArray&	GetSets() const { return m_arrSet; }
+	const CConfigArray&	GetConfigs() const { return m_arrConfig; }
+	const RESULT&	GetResult(int iSet, int iConfig) const { return m_arrResult[iSet * m_arrConfig.size() + iConfig]; }
+
+// Operations
+	static	void	MakeGrid(const CIntArray& arrPruneImbalance, const CIntArray& arrPruneMaxTrans,
+		const CIntArray& arrDiscrepancyStep, const CIntArray& arrBeamWidth, CConfigArray& arrConfig);
+	bool	Run();
+	int		FindBestConfig(int iSet) const;
+	bool	Write(const char *pszPath) const;
+	static	std::string	FormatOption(int nVal);
+
+protected:
+// Member data
+	int		m_nThreads;			// number of worker threads, or zero for one per core
+	uint64_t	m_nNodeLimit;	// node limit of each run, or zero for none
+	CSetCodeArray	m_arrSet;	// sets to solve
+	CConfigArray	m_arrConfig;	// configurations to solve them with
+	CResultArray	m_arrResult;	// results, one per set and configuration, in set-major order
+
+// Helpers
+	bool	IsResultBetter(const RESULT& res1, const RESULT& res2) const;
+};
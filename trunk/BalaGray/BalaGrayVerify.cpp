@@ -0,0 +1,258 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	check cyclic adjacency variants
+		02		18oct26	verify winners above crawler's numeral limit
+
+*/
+
+// BalaGrayVerify.cpp : independent batch verifier for winners.
+
+#include "stdafx.h"	// precompiled header
+#include "BalaGrayVerify.h"
+#include "BalaGrayObjective.h"
+#include <assert.h>	// debugging
+#include <algorithm>
+#include <map>
+
+const char *CBalaGrayVerify::GetErrorName(int iFlag)
+{
+	static const char *arrName[VERIFY_FLAGS] = {
+		"set", "states", "gray", "imbalance", "maxtrans", "maxspan", "stddev",
+	};
+	assert(iFlag >= 0 && iFlag < VERIFY_FLAGS);
+	return arrName[iFlag];
+}
+
+void CBalaGrayVerify::WriteErrors(std::ostream& os, const CWinner& winner, const RESULT& result)
+{
+	// list each error, with file's and recomputed values for metric mismatches
+	bool	bFirst = true;
+	for (int iFlag = 0; iFlag < VERIFY_FLAGS; iFlag++) {	// for each error flag
+		int	nFlag = 1 << iFlag;
+		if (!(result.nErrors & nFlag))
+			continue;
+		if (!bFirst)
+			os << ", ";
+		bFirst = false;
+		os << GetErrorName(iFlag);
+		switch (nFlag) {
+		case VF_IMBALANCE:
+			os << " (" << winner.m_nImbalance << " != " << result.nImbalance << ')';
+			break;
+		case VF_MAXTRANS:
+			os << " (" << winner.m_nMaxTrans << " != " << result.nMaxTrans << ')';
+			break;
+		case VF_MAXSPAN:
+			os << " (" << winner.m_nMaxSpan << " != " << result.nMaxSpan << ')';
+			break;
+		case VF_STDDEV:
+			os << " (" << winner.GetDevSum() << " != " << result.nDevSum << ')';
+			break;
+		}
+	}
+}
+
+int CBalaGrayVerify::CheckStates(const CWinner& winner)
+{
+	// Check set description, and that the numerals are each of the set's
+	// states exactly once. For a cyclic adjacency variant, also check that
+	// each changed place steps to its next or previous value; a custom
+	// variant's graph isn't part of its winner, so only Gray is checked.
+	// Returns error flags.
+	int	nAdjacency = CBalaGray::GetAdjacency(winner.m_nSetCode);
+	if (nAdjacency >= CBalaGray::ADJACENCY_MODES)
+		return VF_SET;
+	NUMERAL	arrBase;
+	int	nPlaces = CBalaGray::GetBases(winner.m_nSetCode, arrBase);
+	if (nPlaces < 2 || nPlaces != winner.m_nPlaces)
+		return VF_SET;
+	int	nBaseSum = 0;
+	int	nStates = 1;
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		if (arrBase.b[iPlace] < 2)	// if place can't change
+			return VF_SET;
+		nBaseSum += arrBase.b[iPlace];
+		nStates *= arrBase.b[iPlace];
+		if (nStates > MAX_STATES)	// if too many states for a winner
+			return VF_SET;
+	}
+	if (nBaseSum != winner.m_nBaseSum)
+		return VF_SET;
+	if (static_cast<int>(winner.m_arrNum.size()) != nStates)
+		return VF_STATES;
+	m_arrUsed.assign(nStates, false);
+	for (const NUMERAL& num : winner.m_arrNum) {	// for each numeral
+		int	iState = 0;
+		for (int iPlace = nPlaces - 1; iPlace >= 0; iPlace--) {	// for each place, most significant first
+			if (num.b[iPlace] >= arrBase.b[iPlace])	// if place out of range
+				return VF_STATES;
+			iState = iState * arrBase.b[iPlace] + num.b[iPlace];
+		}
+		for (int iPlace = nPlaces; iPlace < CBalaGray::MAX_PLACES; iPlace++) {	// for each unused place
+			if (num.b[iPlace])	// unused places must be zero
+				return VF_STATES;
+		}
+		if (m_arrUsed[iState])	// if duplicate state
+			return VF_STATES;
+		m_arrUsed[iState] = true;
+	}
+	if (nAdjacency == CBalaGray::ADJ_CYCLIC) {	// if cyclic variant
+		const NUMERAL	*pPrev = &winner.m_arrNum.back();	// start with wraparound
+		for (const NUMERAL& num : winner.m_arrNum) {	// for each numeral
+			for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+				int	nBase = arrBase.b[iPlace];
+				int	nDelta = (num.b[iPlace] - pPrev->b[iPlace] + nBase) % nBase;
+				if (nDelta && nDelta != 1 && nDelta != nBase - 1)	// if place changed by more than one step
+					return VF_GRAY;
+			}
+			pPrev = &num;
+		}
+	}
+	return 0;
+}
+
+void CBalaGrayVerify::VerifyBatch(const CWinnerArray& arrWin, const int *parrIndex, int nLanes, int nPlaces, CResultArray& arrResult)
+{
+	// Verify up to LANES cycles of the same set at once. Unused lanes repeat
+	// the first cycle, so the kernels needn't mask them. Position iPos is the
+	// transition from numeral iPos - 1 to numeral iPos, modulo the numeral
+	// count, so position nNumerals is the wraparound.
+	assert(nLanes > 0 && nLanes <= LANES);
+	int	nNumerals = static_cast<int>(arrWin[parrIndex[0]].m_arrNum.size());
+	m_arrPlane.resize(nNumerals * nPlaces * LANES);
+	m_arrDiff.resize(nNumerals * nPlaces * LANES);
+	for (int iLane = 0; iLane < LANES; iLane++) {	// for each lane
+		const CWinner&	winner = arrWin[parrIndex[iLane < nLanes ? iLane : 0]];
+		for (int iNum = 0; iNum < nNumerals; iNum++) {	// for each numeral
+			for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+				m_arrPlane[(iNum * nPlaces + iPlace) * LANES + iLane] = winner.m_arrNum[iNum].b[iPlace];
+			}
+		}
+	}
+	// first kernel: find changed places, and count changes and transitions
+	LANE_ARRAY	arrGrayErr = {0};
+	LANE_ARRAY	arrTrans[CBalaGray::MAX_PLACES] = {{0}};
+	LANE_ARRAY	arrLastTrans[CBalaGray::MAX_PLACES] = {{0}};
+	for (int iPos = 1; iPos <= nNumerals; iPos++) {	// for each position, including wraparound
+		const PLACE	*pPrev = &m_arrPlane[(iPos - 1) * nPlaces * LANES];
+		const PLACE	*pCur = &m_arrPlane[(iPos % nNumerals) * nPlaces * LANES];
+		uint8_t	*pDiff = &m_arrDiff[(iPos - 1) * nPlaces * LANES];
+		LANE_ARRAY	arrChanges = {0};
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			int	iOffset = iPlace * LANES;
+			for (int iLane = 0; iLane < LANES; iLane++) {	// for each lane
+				int	nDiff = pPrev[iOffset + iLane] != pCur[iOffset + iLane];
+				pDiff[iOffset + iLane] = static_cast<uint8_t>(nDiff);
+				arrChanges[iLane] += nDiff;
+				arrTrans[iPlace][iLane] += nDiff;
+				arrLastTrans[iPlace][iLane] = nDiff ? iPos : arrLastTrans[iPlace][iLane];
+			}
+		}
+		for (int iLane = 0; iLane < LANES; iLane++) {	// for each lane
+			arrGrayErr[iLane] |= arrChanges[iLane] != 1;
+		}
+	}
+	// second kernel: measure spans as cyclic gaps between each place's transitions;
+	// starting from each place's last transition, minus a cycle, closes its first span
+	LANE_ARRAY	arrMaxSpan = {0};
+	LANE_ARRAY	arrDevSum = {0};
+	for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+		LANE_ARRAY	arrPrevTrans;
+		for (int iLane = 0; iLane < LANES; iLane++) {	// for each lane
+			arrPrevTrans[iLane] = arrLastTrans[iPlace][iLane] - nNumerals;
+		}
+		for (int iPos = 1; iPos <= nNumerals; iPos++) {	// for each position, including wraparound
+			const uint8_t	*pDiff = &m_arrDiff[((iPos - 1) * nPlaces + iPlace) * LANES];
+			for (int iLane = 0; iLane < LANES; iLane++) {	// for each lane
+				int	nDiff = pDiff[iLane];
+				int	nSpan = iPos - arrPrevTrans[iLane];
+				int	nDev = nSpan - nPlaces;	// ideal mean span length is place count
+				arrMaxSpan[iLane] = std::max(arrMaxSpan[iLane], nDiff ? nSpan : 0);
+				arrDevSum[iLane] += nDiff ? nDev * nDev : 0;
+				arrPrevTrans[iLane] = nDiff ? iPos : arrPrevTrans[iLane];
+			}
+		}
+	}
+	for (int iLane = 0; iLane < nLanes; iLane++) {	// for each used lane
+		RESULT&	result = arrResult[parrIndex[iLane]];
+		int	nMin = INT_MAX;
+		int	nMax = 0;
+		for (int iPlace = 0; iPlace < nPlaces; iPlace++) {	// for each place
+			nMin = std::min(nMin, static_cast<int>(arrTrans[iPlace][iLane]));
+			nMax = std::max(nMax, static_cast<int>(arrTrans[iPlace][iLane]));
+		}
+		result.nImbalance = nMax - nMin;
+		result.nMaxTrans = nMax;
+		result.nMaxSpan = arrMaxSpan[iLane];
+		result.nDevSum = arrDevSum[iLane];
+		if (arrGrayErr[iLane])	// if not a Gray cycle, metrics are meaningless
+			result.nErrors |= VF_GRAY;
+		else
+			CompareMetrics(arrWin[parrIndex[iLane]], result);
+	}
+}
+
+void CBalaGrayVerify::CompareMetrics(const CWinner& winner, RESULT& result)
+{
+	if (winner.m_nImbalance != result.nImbalance)
+		result.nErrors |= VF_IMBALANCE;
+	if (winner.m_nMaxTrans != result.nMaxTrans)
+		result.nErrors |= VF_MAXTRANS;
+	if (winner.m_nMaxSpan != result.nMaxSpan)
+		result.nErrors |= VF_MAXSPAN;
+	// standard deviation is only computed if objective policy reports it;
+	// compare exact sums, as standard deviation may be rounded in a file
+	if (CBalaGray::CObjective::GetColumnCount() > 1 && winner.GetDevSum() != result.nDevSum)
+		result.nErrors |= VF_STDDEV;
+}
+
+int CBalaGrayVerify::Verify(const CWinnerArray& arrWin, CResultArray& arrResult)
+{
+	// Verify an array of winners, returning the number of invalid winners.
+	// Empty winners, i.e. failed crawls or crawls that found no cycle, e.g.
+	// because they timed out, are neither checked nor counted, and their
+	// results have no errors.
+	int	nWinners = static_cast<int>(arrWin.size());
+	arrResult.assign(nWinners, RESULT());
+	std::map<SET_CODE, CIntArray>	mapBatch;	// indices of winners to verify, grouped by set
+	for (int iWin = 0; iWin < nWinners; iWin++) {	// for each winner
+		const CWinner&	winner = arrWin[iWin];
+		if (IsEmpty(winner))	// if no winner
+			continue;
+		arrResult[iWin].nErrors = CheckStates(winner);
+		if (!arrResult[iWin].nErrors)	// if winner is a permutation of its set's states
+			mapBatch[winner.m_nSetCode].push_back(iWin);
+	}
+	for (const auto& batch : mapBatch) {	// for each set
+		const CIntArray&	arrIndex = batch.second;
+		int	nPlaces = arrWin[arrIndex[0]].m_nPlaces;
+		int	nIndexes = static_cast<int>(arrIndex.size());
+		for (int iStart = 0; iStart < nIndexes; iStart += LANES) {	// for each batch of lanes
+			VerifyBatch(arrWin, &arrIndex[iStart], std::min(nIndexes - iStart, static_cast<int>(LANES)), nPlaces, arrResult);
+		}
+	}
+	int	nInvalid = 0;
+	for (int iWin = 0; iWin < nWinners; iWin++) {	// for each winner
+		if (arrResult[iWin].nErrors)
+			nInvalid++;
+	}
+	return nInvalid;
+}
+
+bool CBalaGrayVerify::Verify(const CWinner& winner, RESULT& result)
+{
+	CWinnerArray	arrWin;
+	arrWin.push_back(winner);
+	CResultArray	arrResult;
+	Verify(arrWin, arrResult);
+	result = arrResult[0];
+	return !result.nErrors;
+}
@@ -0,0 +1,88 @@
+// Copyleft 2023 Chris Korda
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or any later version.
+/*
+        chris korda
+
+		revision history:
+		rev		date	comments
+        00      18oct26	initial version
+		01		18oct26	verify winners above crawler's numeral limit
+
+*/
+
+// BalaGrayVerify.h : independent batch verifier for winners.
+//
+// Checks that a winner's numerals are exactly the states of its set, that
+// they form a Gray cycle including the wraparound, and recomputes its
+// imbalance, maximum transition count, maximum span length and standard
+// deviation without using the crawler's code. Spans are computed as the
+// cyclic gaps between a place's transitions, so the metrics don't depend
+// on where the cycle starts, unlike the crawler, which tracks first spans.
+//
+// Winners of the same set are verified in batches of LANES cycles at once.
+// Each batch is transposed so that a numeral's place for every cycle in the
+// batch is contiguous, and the kernels' inner loops run across cycles, with
+// no branches, so that the compiler can vectorize them.
+
+#pragma once
+
+#include "BalaGray.h"
+#include <ostream>
+
+class CBalaGrayVerify {
+public:
+// Types
+	typedef CBalaGray::SET_CODE SET_CODE;
+	typedef CBalaGray::PLACE PLACE;
+	typedef CBalaGray::NUMERAL NUMERAL;
+	typedef CBalaGray::CWinner CWinner;
+	typedef CBalaGray::CWinnerArray CWinnerArray;
+	enum {	// error flags
+		VF_SET			= 0x01,	// set code is invalid, or inconsistent with place count or range sum
+		VF_STATES		= 0x02,	// numerals aren't exactly the set's states
+		VF_GRAY			= 0x04,	// consecutive numerals, including wraparound, don't differ in exactly one place
+		VF_IMBALANCE	= 0x08,	// imbalance mismatch
+		VF_MAXTRANS		= 0x10,	// maximum transition count mismatch
+		VF_MAXSPAN		= 0x20,	// maximum span length mismatch
+		VF_STDDEV		= 0x40,	// standard deviation mismatch
+		VERIFY_FLAGS = 7
+	};
+	struct RESULT {	// verification result for one winner
+		int		nErrors;	// bitmask of error flags, or zero if winner is valid
+		int		nImbalance;	// recomputed imbalance
+		int		nMaxTrans;	// recomputed maximum transition count
+		int		nMaxSpan;	// recomputed maximum span length
+		int		nDevSum;	// recomputed sum of squared span deviations
+	};
+	typedef std::vector<RESULT> CResultArray;
+
+// Operations
+	int		Verify(const CWinnerArray& arrWin, CResultArray& arrResult);
+	bool	Verify(const CWinner& winner, RESULT& result);
+	static	bool	IsEmpty(const CWinner& winner) { return winner.m_arrNum.empty() || winner.m_nImbalance == INT_MAX; }	// crawler reports no cycle with infinite metrics
+	static	const char	*GetErrorName(int iFlag);
+	static	void	WriteErrors(std::ostream& os, const CWinner& winner, const RESULT& result);
+
+protected:
+// Constants
+	enum {
+		LANES = 16,	// number of cycles verified at once
+		MAX_STATES = 1 << 20,	// limited by memory, not by the crawler, as constructed winners may be larger
+	};
+
+// Types
+	typedef int32_t LANE_ARRAY[LANES];
+	typedef std::vector<int> CIntArray;
+
+// Member data
+	std::vector<PLACE>	m_arrPlane;	// numerals of a batch, indexed by numeral, then place, then lane
+	std::vector<uint8_t>	m_arrDiff;	// whether each place changed at each position, for each lane
+	std::vector<bool>	m_arrUsed;	// which states have been seen, for checking coverage
+
+// Helpers
+	int		CheckStates(const CWinner& winner);
+	void	VerifyBatch(const CWinnerArray& arrWin, const int *parrIndex, int nLanes, int nPlaces, CResultArray& arrResult);
+	static	void	CompareMetrics(const CWinner& winner, RESULT& result);
+};